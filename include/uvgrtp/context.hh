@@ -74,6 +74,34 @@ namespace uvgrtp {
              */
             rtp_error_t destroy_session(uvgrtp::session *session);
 
+            /**
+             * \brief Set the number of threads of the reactor used by streams with RCE_REACTOR
+             *
+             * \details The reactor is shared by all sessions of the context. By default it has
+             * one thread per hardware thread, at most four. Must be called before a stream
+             * with RCE_REACTOR is created
+             *
+             * \param threads Number of threads, 0 for the default
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK                On success
+             * \retval RTP_GENERIC_ERROR     If the reactor is already in use
+             */
+            rtp_error_t set_reactor_threads(unsigned threads);
+
+            /**
+             * \brief Let the application run the streams created with RCE_REACTOR
+             *
+             * \details Streams created with RCE_REACTOR after this call have no threads at all. Each of
+             * them has an epoll instance of its own, see uvgrtp::media_stream::get_poll_fd(), and the application
+             * receives packets with uvgrtp::media_stream::poll_once() and sends RTCP reports and holepunching
+             * keep-alives with uvgrtp::media_stream::process_timers() on a thread of its choosing. Linux only
+             *
+             * \param enabled True to run the streams created after this call from the application
+             */
+            void set_user_driven_reactor(bool enabled);
+
             /// \cond DO_NOT_DOCUMENT
             std::string& get_cname();
             /// \endcond
@@ -21,6 +21,10 @@
 #endif
 
 namespace uvgrtp {
+    /// \cond DO_NOT_DOCUMENT
+    struct pool_buffer;
+    /// \endcond
+
     namespace frame {
 
         enum RTCP_FRAME_TYPE {
@@ -82,9 +86,19 @@ namespace uvgrtp {
             /// \cond DO_NOT_DOCUMENT
             uint8_t *dgram = nullptr;      /* pointer to the UDP datagram (for internal use only) */
             size_t   dgram_size = 0;       /* size of the UDP datagram */
+            pool_buffer *buffer = nullptr; /* receive buffer "payload" points into (RCC_RECEIVE_ZERO_COPY) */
             /// \endcond
         };
 
+        /** \brief One NAL unit of an access unit given to uvgrtp::media_stream::push_frame() as a list
+         *
+         * \details The NAL unit starts with its NAL unit header and has no start code. The NAL units
+         * of an access unit may be in different buffers */
+        struct nal_unit {
+            uint8_t *data = nullptr;
+            size_t len = 0;
+        };
+
         /** \brief Header of for all RTCP packets defined in <a href="https://www.rfc-editor.org/rfc/rfc3550#section-6" target="_blank">RFC 3550 section 6</a> */
         struct rtcp_header {
             /** \brief  This field identifies the version of RTP. The version defined by
@@ -239,11 +253,28 @@ namespace uvgrtp {
 
 
         /* Deallocate RTP frame
+         *
+         * The frame and its payload are kept for reuse by later frames as long as the memory
+         * kept stays within the budget set with set_pool_budget()
          *
          * Return RTP_OK on successs
          * Return RTP_INVALID_VALUE if "frame" is nullptr */
         rtp_error_t dealloc_frame(uvgrtp::frame::rtp_frame *frame);
 
+        /* Counters of the allocator behind alloc_rtp_frame() and dealloc_frame(). The allocator
+         * is shared by all streams of the process */
+        struct pool_stats {
+            uint64_t allocations = 0; /* frames and payloads allocated from the heap */
+            uint64_t reuses = 0;      /* frames and payloads reused from the pool */
+            size_t cached_bytes = 0;  /* bytes of deallocated frames and payloads kept for reuse */
+        };
+
+        /* Set how many bytes of deallocated frames and payloads are kept for reuse.
+         * The default is 16 MB and 0 disables the pooling. Payloads larger than 2 MB are never pooled */
+        void set_pool_budget(size_t bytes);
+
+        pool_stats get_pool_stats();
+
 
         /* Allocate ZRTP frame
          * Parameter "payload_size" defines the length of the frame
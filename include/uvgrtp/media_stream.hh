@@ -3,9 +3,11 @@
 #include "util.hh"
 
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <string>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 
 #ifndef _WIN32
@@ -30,15 +32,26 @@ namespace uvgrtp {
     class socket;
     class socketfactory;
     class rtcp_reader;
+    class reactor;
 
     namespace frame {
         struct rtp_frame;
+        struct nal_unit;
     }
 
     namespace formats {
         class media;
     }
 
+    /// \brief Counters of the receiver ring buffer, see uvgrtp::media_stream::get_ring_stats()
+    struct ring_stats {
+        uint64_t received = 0;       ///< Packets written to the ring
+        uint64_t dropped_newest = 0; ///< Received packets dropped because the ring was full
+        uint64_t dropped_oldest = 0; ///< Unprocessed packets dropped to make room with RTP_RING_DROP_OLDEST
+        uint64_t grown = 0;          ///< How many times the ring has grown with RTP_RING_GROW
+        size_t slots = 0;            ///< Current number of slots in the ring
+    };
+
     /**
      * \brief The media_stream is an entity which represents one RTP stream.
      *
@@ -161,6 +174,52 @@ namespace uvgrtp {
              */
             rtp_error_t push_frame(std::unique_ptr<uint8_t[]> data, size_t data_len, int rtp_flags);
 
+            /**
+             * \brief Send an H26x access unit whose NAL units have already been located
+             *
+             * \details The NAL units are packetized as they are, so uvgRTP does not look for start
+             * codes and does not copy the NAL units into one buffer. This suits encoders that
+             * know where each NAL unit is, possibly in separate output buffers. Small NAL units
+             * are aggregated and large ones fragmented like with the other push_frame() functions.
+             *
+             * uvgRTP does not take ownership of the memory and does not copy it, so RTP_COPY
+             * and RCE_UDP_ZEROCOPY cannot be used.
+             *
+             * \param nals NAL units of the access unit in decoding order, without start codes
+             * \param count Number of NAL units
+             * \param rtp_flags Optional flags, see ::RTP_FLAGS for more details
+             *
+             * \return RTP error code
+             *
+             * \retval  RTP_OK            On success
+             * \retval  RTP_INVALID_VALUE If one of the parameters are invalid
+             * \retval  RTP_NOT_SUPPORTED If the stream is not an H26x stream or RCE_UDP_ZEROCOPY is enabled
+             * \retval  RTP_SEND_ERROR    If uvgRTP failed to send the data to remote
+             * \retval  RTP_GENERIC_ERROR If an unspecified error occurred
+             */
+            rtp_error_t push_frame(const uvgrtp::frame::nal_unit *nals, size_t count, int rtp_flags);
+
+            /**
+             * \brief Send an H26x access unit whose NAL units have already been located, with a custom timestamp
+             *
+             * \details See push_frame(const uvgrtp::frame::nal_unit *, size_t, int) and
+             * push_frame(uint8_t *, size_t, uint32_t, int)
+             *
+             * \param nals NAL units of the access unit in decoding order, without start codes
+             * \param count Number of NAL units
+             * \param ts 32-bit timestamp value for the access unit
+             * \param rtp_flags Optional flags, see ::RTP_FLAGS for more details
+             *
+             * \return RTP error code
+             *
+             * \retval  RTP_OK            On success
+             * \retval  RTP_INVALID_VALUE If one of the parameters are invalid
+             * \retval  RTP_NOT_SUPPORTED If the stream is not an H26x stream or RCE_UDP_ZEROCOPY is enabled
+             * \retval  RTP_SEND_ERROR    If uvgRTP failed to send the data to remote
+             * \retval  RTP_GENERIC_ERROR If an unspecified error occurred
+             */
+            rtp_error_t push_frame(const uvgrtp::frame::nal_unit *nals, size_t count, uint32_t ts, int rtp_flags);
+
             /**
              * \brief Send data to remote participant with a custom timestamp
              *
@@ -317,6 +376,26 @@ namespace uvgrtp {
              */
             uvgrtp::frame::rtp_frame *pull_frame(size_t timeout_ms);
 
+            /**
+             * \brief Poll several frames at once from the media stream object
+             *
+             * \details Waits until at least one frame has been received and then moves all received frames,
+             * at most "max_frames" of them, to the end of "frames". Cheaper than calling pull_frame()
+             * for each frame when frames arrive faster than they are pulled
+             *
+             * \param frames Vector that the frames are appended to
+             * \param max_frames Maximum number of frames to pull
+             * \param timeout_ms How long is a frame waited, in milliseconds
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK                On success, at least one frame was pulled
+             * \retval RTP_TIMEOUT           If a frame was not received within the specified time limit
+             * \retval RTP_INVALID_VALUE     If "max_frames" is 0
+             * \retval RTP_NOT_INITIALIZED   If the media stream has not been initialized
+             */
+            rtp_error_t pull_frames(std::vector<uvgrtp::frame::rtp_frame*>& frames, size_t max_frames, size_t timeout_ms);
+
             /**
              * \brief Asynchronous way of getting frames
              *
@@ -337,6 +416,23 @@ namespace uvgrtp {
              * \retval RTP_INVALID_VALUE If hook is nullptr */
             rtp_error_t install_receive_hook(void *arg, void (*hook)(void *, uvgrtp::frame::rtp_frame *));
 
+            /**
+             * \brief Install a deallocation hook for frames given as raw pointers
+             *
+             * \details Normally the memory given to push_frame() as a raw pointer without RTP_COPY
+             * belongs to the application and can be reused when push_frame() returns. With RCE_UDP_ZEROCOPY
+             * and a deallocation hook, uvgRTP takes the ownership of these frames, sends them without
+             * copying and calls the hook with the frame pointer once the kernel no longer needs the memory.
+             *
+             * \param deallocation_hook Function pointer to the hook that releases the frame memory
+             *
+             * \return RTP error code
+             *
+             * \retval RTP_OK On success
+             * \retval RTP_INVALID_VALUE If hook is nullptr
+             * \retval RTP_NOT_INITIALIZED If the media stream has not been initialized */
+            rtp_error_t install_deallocation_hook(void (*deallocation_hook)(void *));
+
             /**
              * \brief Configure the media stream, see ::RTP_CTX_CONFIGURATION_FLAGS for more details
              *
@@ -387,6 +483,63 @@ namespace uvgrtp {
              */
             uint32_t get_ssrc() const;
 
+            /**
+             * \brief Get the counters of the receiver ring buffer
+             *
+             * \details Tells how many received packets were lost inside uvgRTP because the packets were
+             * received faster than they were processed, see RCC_RING_OVERFLOW_POLICY. With RCE_REUSEPORT_SHARDING,
+             * the counters of all receiving sockets are summed up
+             *
+             * \return Counters of the ring buffer, all zero if the media stream has not been initialized
+             */
+            uvgrtp::ring_stats get_ring_stats() const;
+
+            /**
+             * \brief Get the file descriptor to wait on when the application runs the stream
+             *
+             * \details Only for streams created with RCE_REACTOR after uvgrtp::context::set_user_driven_reactor().
+             * The descriptor is an epoll instance that becomes readable when a socket of the stream has
+             * packets waiting, poll_once() should be called then. It also becomes readable when a timer
+             * has been added, after which process_timers() tells when the timer is due
+             *
+             * \return File descriptor
+             *
+             * \retval >=0 On success
+             * \retval -1  If the stream is not run by the application
+             */
+            int get_poll_fd();
+
+            /**
+             * \brief Receive the packets waiting in the sockets of the stream
+             *
+             * \details Does not block. The packets are processed on the calling thread, so the frames are
+             * given to the receive hook or the frame queue before this returns. Waiting RTCP packets are
+             * read as well. Only for streams run by the application, see get_poll_fd()
+             *
+             * \param max_packets Maximum number of RTP packets to read
+             *
+             * \return Number of RTP packets read
+             *
+             * \retval >=0 On success
+             * \retval -1  If the stream is not run by the application or reading failed
+             */
+            int poll_once(size_t max_packets);
+
+            /**
+             * \brief Run the timers of the stream that are due
+             *
+             * \details Sends the RTCP reports and holepunching keep-alives of the stream on the calling thread.
+             * Only for streams run by the application, see get_poll_fd()
+             *
+             * \param now Current time
+             *
+             * \return Milliseconds until the next timer is due
+             *
+             * \retval >=0 On success
+             * \retval -1  If the stream has no timers or is not run by the application
+             */
+            int process_timers(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
         private:
             /* Initialize the connection by initializing the socket
              * and binding ourselves to specified interface and creating
@@ -443,11 +596,14 @@ namespace uvgrtp {
             /* RTP packet reception flow. Dispatches packets to other components */
             std::shared_ptr<uvgrtp::reception_flow> reception_flow_;
 
+            /* Set with RCE_REACTOR. Has no threads if the application runs the stream */
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+
             /* Media object associated with this media stream. */
             std::unique_ptr<uvgrtp::formats::media> media_;
 
             /* Thread that keeps the holepunched connection open for unidirectional streams */
-            std::unique_ptr<uvgrtp::holepuncher> holepuncher_;
+            std::shared_ptr<uvgrtp::holepuncher> holepuncher_;
 
             std::string cname_;
 
@@ -28,6 +28,7 @@ namespace uvgrtp {
     class socket;
     class socketfactory;
     class rtcp_reader;
+    class reactor;
 
     typedef std::vector<std::pair<size_t, uint8_t*>> buf_vec; // also defined in socket.hh
 
@@ -117,7 +118,7 @@ namespace uvgrtp {
      * 
      * See <a href="https://www.rfc-editor.org/rfc/rfc3550#section-6" target="_blank">RFC 3550 section 6</a> for more details. 
      */
-    class rtcp {
+    class rtcp : public std::enable_shared_from_this<rtcp> {
         public:
             /// \cond DO_NOT_DOCUMENT
             rtcp(std::shared_ptr<uvgrtp::rtp> rtp, std::shared_ptr<std::atomic<std::uint32_t>> ssrc, std::shared_ptr<std::atomic<uint32_t>> remote_ssrc,
@@ -126,10 +127,11 @@ namespace uvgrtp {
                 std::string cname, std::shared_ptr<uvgrtp::socketfactory> sfp, std::shared_ptr<uvgrtp::srtcp> srtcp, int rce_flags);
             ~rtcp();
 
-            /* start the RTCP runner thread
+            /* start the RTCP runner thread. If "reactor" is given, reports are sent from a timer of the
+             * reactor and received packets are read by it instead
              *
              * return RTP_OK on success and RTP_MEMORY_ERROR if the allocation fails */
-            rtp_error_t start();
+            rtp_error_t start(std::shared_ptr<uvgrtp::reactor> reactor = nullptr);
 
             /* End the RTCP session and send RTCP BYE to all participants
              *
@@ -463,6 +465,15 @@ namespace uvgrtp {
 
             static void rtcp_runner(rtcp *rtcp);
 
+            /* Start sending periodic reports from rtcp_runner() or from a timer of the reactor */
+            void start_report_generator();
+
+            /* Send the periodic report number "report_number" and remove the sources that have
+             * timed out. "elapsed_ms" is the time since the previous report
+             *
+             * Return the time until the next report in milliseconds */
+            uint32_t send_periodic_report(uint32_t elapsed_ms, int report_number);
+
             /* when we start the RTCP instance, we don't know what the SSRC of the remote is
              * when an RTP packet is received, we must check if we've already received a packet
              * from this sender and if not, create new entry to receiver_stats_ map */
@@ -663,6 +674,10 @@ namespace uvgrtp {
             std::shared_ptr<uvgrtp::socketfactory> sfp_;
             std::shared_ptr<uvgrtp::rtcp_reader> rtcp_reader_;
 
+            /* set with RCE_REACTOR, periodic reports are then sent from report_timer_ */
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+            uint64_t report_timer_;
+
             bool is_active() const
             {
                 return active_;
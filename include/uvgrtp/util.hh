@@ -267,10 +267,73 @@ enum RTP_CTX_ENABLE_FLAGS {
 
     /** Use a single UDP port for both RTP and RTCP transmission (default RTCP port is +1) **/
     RCE_RTCP_MUX                    = 1 << 21,
-    
+
+    /** Use UDP Generic Segmentation Offload (GSO) when sending fragmented frames. Sender side flag.
+     *
+     * Consecutive packets of equal size are handed to the kernel as one large buffer which
+     * is split into datagrams only after the UDP/IP stack has been traversed. The receiver sees
+     * normal datagrams. Linux only, uvgRTP falls back to normal sending if the kernel rejects GSO */
+    RCE_UDP_GSO                     = 1 << 22,
+
+    /** Use UDP Generic Receive Offload (GRO) when receiving. Receiver side flag.
+     *
+     * The kernel may deliver several datagrams of a flow with one read. uvgRTP splits them
+     * back into RTP packets inside the reception ring buffer without copying. Each ring buffer
+     * slot is enlarged to fit the largest possible UDP payload, and RCC_RING_BUFFER_SIZE is
+     * divided into these larger slots. Linux only */
+    RCE_UDP_GRO                     = 1 << 23,
+
+    /** Send frames with MSG_ZEROCOPY so that the kernel does not copy the payload. Sender side flag.
+     *
+     * uvgRTP keeps the frame until the kernel reports that it has been sent, so the flag only applies
+     * to frames given as unique_ptr, frames pushed with RTP_COPY and raw pointers when a deallocation hook
+     * has been installed with uvgrtp::media_stream::install_deallocation_hook(). The hook is then called
+     * once the frame is no longer needed, which can be after the stream has been destroyed. Memory that
+     * the kernel has not finished sending when the socket is closed is leaked instead of released.
+     * Other frames are copied as usual. H26x aggregation packets
+     * are not used. Pays off for large frames only. Linux only, not used with SRTP */
+    RCE_UDP_ZEROCOPY                = 1 << 24,
+
+    /** Use io_uring instead of poll() and recvmmsg()/sendmmsg() for the media socket.
+     *
+     * Packets are received with a multishot receive straight into the reception ring buffer
+     * and the packets of a frame are sent as a batch of linked sendmsg requests. Falls back to
+     * the default I/O if the kernel does not support io_uring. Not used for receiving with
+     * RCE_UDP_GRO or for sending with RCE_UDP_GSO or RCE_UDP_ZEROCOPY. Linux only */
+    RCE_IO_URING                    = 1 << 25,
+
+    /** Let the kernel do the pacing of RCE_FRAME_RATE and RCE_PACE_FRAGMENT_SENDING. Sender side flag.
+     *
+     * Instead of sleeping in push_frame(), every packet is given a launch time with SO_TXTIME
+     * and the fq qdisc of the outgoing interface sends it at that time. Falls back to sleeping
+     * if SO_TXTIME is not supported or if the interface has some other qdisc, which would send
+     * the packets right away or, like etf, drop them because of a different clock.
+     * Frames sent with RCE_UDP_ZEROCOPY are not paced by the kernel. Linux only */
+    RCE_PACE_TXTIME                 = 1 << 26,
+
+    /** Receive the port of the stream with several SO_REUSEPORT sockets. Receiver side flag.
+     *
+     * Each socket has its own receiver and processing thread. One socket is opened per hardware
+     * thread, at most 8. The kernel gives each packet to the socket chosen by the SSRC of the packet
+     * so the packets of one stream are always processed in order by the same thread. If the kernel
+     * cannot steer by SSRC, it chooses the socket by the address and port of the sender. Pays off when
+     * many streams are multiplexed into one port with RCC_REMOTE_SSRC. Must be given to the stream that
+     * creates the socket of the port. Not used with multicast addresses. Linux only */
+    RCE_REUSEPORT_SHARDING          = 1 << 27,
+
+    /** Serve the sockets and timers of the stream with the shared reactor of the context.
+     *
+     * Instead of having threads of its own for receiving, RTCP and holepunching, the stream is served
+     * by a pool of epoll threads shared by all streams of the context that use this flag. Received
+     * packets are processed on the reactor thread, so the receive hook must not block. The number
+     * of threads is set with context::set_reactor_threads(). After context::set_user_driven_reactor(),
+     * the stream has a reactor of its own that the application runs. Not used with RCE_IO_URING. Linux only */
+    RCE_REACTOR                     = 1 << 28,
+
     /// \cond DO_NOT_DOCUMENT
-    RCE_LAST                        = 1 << 22
-   /// \endcond
+    /* New options are configured with RTP_CTX_CONFIGURATION_FLAGS, only bits 29 and 30 are left */
+    RCE_LAST                        = 1 << 29
+    /// \endcond
 }; // maximum is 1 << 30 for int
 
 
@@ -307,7 +370,7 @@ enum RTP_CTX_CONFIGURATION_FLAGS {
      * Default value is 4 MB
      *
      * For video with high bitrate (100+ fps 4K), it is advisable to set this
-     * to a high number to prevent uvgRTP from overwriting previous packets */
+     * to a high number to prevent uvgRTP from dropping packets, see RCC_RING_OVERFLOW_POLICY */
     RCC_RING_BUFFER_SIZE = 3,
 
     /** How many milliseconds is each frame waited for until it is considered lost.
@@ -389,9 +452,102 @@ enum RTP_CTX_CONFIGURATION_FLAGS {
     */
     RCC_POLL_TIMEOUT       = 13,
 
+    /** Set how many packets the receiver reads from the socket with a single system call
+    *
+    * Default value is 32. On platforms that support recvmmsg(2), uvgRTP fills up to this
+    * many slots of the reception ring buffer at once, which reduces the amount of system calls
+    * at high packet rates. Setting this to 1 reads one packet per system call.
+    */
+    RCC_RECV_BATCH_SIZE    = 14,
+
+    /** Set what the receiver does when its ring buffer is full, see ::RTP_RING_OVERFLOW_POLICY
+    *
+    * Default value is RTP_RING_DROP_NEWEST. The number of dropped packets can be read with
+    * uvgrtp::media_stream::get_ring_stats(). Not used with RCE_IO_URING, where the packets
+    * that do not fit in the ring stay in the socket buffer until there is room.
+    */
+    RCC_RING_OVERFLOW_POLICY = 15,
+
+    /** How large can the receiver ring buffer grow with RTP_RING_GROW
+    *
+    * Default value is four times RCC_RING_BUFFER_SIZE.
+    */
+    RCC_RING_BUFFER_MAX_SIZE = 16,
+
+    /** Set to 1 to process received packets in the thread that reads them from the socket
+    *
+    * Default value is 0, in which case the packets are handed to a separate processing thread.
+    * With 1, the receiver thread parses, decrypts and reassembles the packets and calls the
+    * receive hook itself, which saves a thread handoff per batch. This suits latency-critical
+    * streams of low bitrate. A slow receive hook then delays reading the socket, so the packets
+    * wait in the socket buffer instead of the ring buffer. RCE_REACTOR always works like this.
+    */
+    RCC_RUN_TO_COMPLETION = 17,
+
+    /** Set how many worker threads help to find the NAL units of large H26x frames
+    *
+    * Default value is 0, in which case push_frame() looks for the start codes on the calling
+    * thread. Frames of at least 1 MB are split into chunks that the worker threads and the
+    * calling thread scan in parallel, which shortens the time before the first packet of very
+    * large access units is sent. Ignored by the other formats.
+    */
+    RCC_SCL_THREADS = 18,
+
+    /** Reconstruct fragmented H26x NAL units while their fragments arrive
+    *
+    * Default value is 0, in which case the fragments of a NAL unit are kept until the last one
+    * arrives and are then copied to the reconstructed NAL unit. With 1, the NAL unit is allocated
+    * when its first fragment arrives and each fragment is copied to it and freed as soon as the
+    * fragments before it have been received. This spreads the copying over the reception of the
+    * NAL unit and roughly halves the memory held by large NAL units. If this is changed while
+    * fragments are waiting, the new mode is used once they have been reconstructed or dropped.
+    * Ignored by the other formats.
+    */
+    RCC_H26X_INCREMENTAL_RECONSTRUCTION = 19,
+
+    /** Set to 1 to back the receiver ring buffer with transparent huge pages
+    *
+    * Default value is 0. With 1, ring buffers of at least 2 MB are advised to use huge pages,
+    * which saves TLB misses when the receiver writes packets all over a large ring. The kernel
+    * then commits the memory of the ring in 2 MB pages, so a ring that is mostly unused still
+    * takes its whole size. Has no effect with RCC_RECEIVE_ZERO_COPY or if the system does not
+    * allow transparent huge pages. Linux only.
+    */
+    RCC_RING_HUGE_PAGES = 20,
+
+    /** Set to 1 to hand out received payloads without copying them out of the receive buffer
+    *
+    * Default value is 0. With 1, the payload of a received frame points into the ring buffer slot
+    * the packet was received to. The slot's buffer is not reused before the frame is released with
+    * uvgrtp::frame::dealloc_frame(), so frames may be held as long as needed. If
+    * RCC_RING_BUFFER_MAX_SIZE is set, the buffers of the ring and of the held frames take at most
+    * that many bytes and new packets are dropped until frames are released. Frames reassembled from
+    * several packets and H26x frames with a start code prepended are still copied once. The ring
+    * buffer of the socket is shared by the streams multiplexed into it, and only the streams that
+    * set this leave their payloads in it.
+    */
+    RCC_RECEIVE_ZERO_COPY = 21,
+
+    /** Set to 1 to send all packets of an H26x access unit with one flush
+    *
+    * Default value is 0, in which case uvgRTP flushes the aggregation packet and each remaining
+    * NAL unit separately. With 1, the packets of all NAL units given to one push_frame() call are
+    * collected and sent with batched system calls, the marker bit is only set for the last packet
+    * of the access unit and RCE_PACE_FRAGMENT_SENDING paces the packets over the whole frame.
+    * Ignored by the other formats.
+    */
+    RCC_H26X_SINGLE_FLUSH = 22,
+
     /// \cond DO_NOT_DOCUMENT
     RCC_LAST
     /// \endcond
 };
 
+/// \brief What the receiver does when its ring buffer is full, see RCC_RING_OVERFLOW_POLICY
+enum RTP_RING_OVERFLOW_POLICY {
+    RTP_RING_DROP_NEWEST = 0, ///< Drop the received packets that do not fit in the ring
+    RTP_RING_DROP_OLDEST = 1, ///< Drop the oldest unprocessed packets to make room for the new ones
+    RTP_RING_GROW        = 2  ///< Add slots to the ring up to RCC_RING_BUFFER_MAX_SIZE, then drop the newest packets
+};
+
 extern thread_local rtp_error_t rtp_errno;
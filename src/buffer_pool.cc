@@ -0,0 +1,114 @@
+#include "buffer_pool.hh"
+
+#include "uvgrtp/frame.hh"
+
+#include "debug.hh"
+#include "frame_pool.hh"
+
+#include <new>
+
+uvgrtp::buffer_pool::buffer_pool(size_t buffer_size) :
+    mutex_(),
+    free_(),
+    buffer_size_(buffer_size),
+    allocated_(0),
+    max_buffers_(0)
+{}
+
+uvgrtp::buffer_pool::~buffer_pool()
+{
+    /* buffers still in use hold a reference to the pool, so every buffer is in the free list */
+    for (auto& buffer : free_) {
+        delete[] buffer->data;
+        delete buffer;
+    }
+}
+
+uvgrtp::pool_buffer *uvgrtp::buffer_pool::acquire()
+{
+    uvgrtp::pool_buffer *buffer = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+
+        if (!free_.empty()) {
+            buffer = free_.back();
+            free_.pop_back();
+        }
+        else if (max_buffers_ > 0 && allocated_ >= max_buffers_) {
+            return nullptr;
+        }
+        else {
+            ++allocated_;
+        }
+    }
+
+    if (!buffer) {
+        buffer = new (std::nothrow) uvgrtp::pool_buffer;
+
+        if (!buffer || !(buffer->data = new (std::nothrow) uint8_t[buffer_size_])) {
+            UVG_LOG_ERROR("Failed to allocate a receive buffer");
+            delete buffer;
+
+            std::lock_guard<std::mutex> lg(mutex_);
+            --allocated_;
+            return nullptr;
+        }
+    }
+
+    buffer->refs = 1;
+    buffer->pool = shared_from_this();
+
+    return buffer;
+}
+
+size_t uvgrtp::buffer_pool::get_buffer_size() const
+{
+    return buffer_size_;
+}
+
+void uvgrtp::buffer_pool::set_max_buffers(size_t max_buffers)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    max_buffers_ = max_buffers;
+}
+
+void uvgrtp::buffer_pool::put(uvgrtp::pool_buffer *buffer)
+{
+    std::lock_guard<std::mutex> lg(mutex_);
+    free_.push_back(buffer);
+}
+
+void uvgrtp::hold_buffer(uvgrtp::pool_buffer *buffer)
+{
+    buffer->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void uvgrtp::release_buffer(uvgrtp::pool_buffer *buffer)
+{
+    if (buffer->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    if (buffer->size_class >= 0) {
+        uvgrtp::frame_pool::free_payload(buffer);
+        return;
+    }
+
+    /* the pool may be destroyed when this last reference to it goes out of scope,
+     * which frees the buffer along with the other free ones */
+    std::shared_ptr<uvgrtp::buffer_pool> pool = std::move(buffer->pool);
+    pool->put(buffer);
+}
+
+void uvgrtp::release_payload(uvgrtp::frame::rtp_frame *frame)
+{
+    if (frame->buffer) {
+        uvgrtp::release_buffer(frame->buffer);
+        frame->buffer = nullptr;
+    }
+    else {
+        delete[] frame->payload;
+    }
+
+    frame->payload = nullptr;
+}
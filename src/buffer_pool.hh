@@ -0,0 +1,75 @@
+#pragma once
+
+#include "uvgrtp/util.hh"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace uvgrtp {
+
+    namespace frame {
+        struct rtp_frame;
+    }
+
+    class buffer_pool;
+
+    /* Receive buffer shared by a ring buffer slot and the frames whose payloads point into it,
+     * or a frame payload allocated by frame_pool. The buffer returns to its pool when the last
+     * reference is released */
+    struct pool_buffer {
+        uint8_t *data = nullptr;
+        std::atomic<int> refs{0};
+
+        /* size class of a frame_pool payload, -1 for the buffers of a buffer_pool */
+        int size_class = -1;
+
+        /* set while the buffer is in use so that the pool outlives the frames holding its buffers */
+        std::shared_ptr<buffer_pool> pool;
+    };
+
+    /* Pool of equally sized receive buffers used with RCC_RECEIVE_ZERO_COPY.
+     *
+     * Buffers are only ever allocated, never freed, until the pool itself is destroyed, so a
+     * receiver that keeps up with the sender reuses the same few buffers over and over */
+    class buffer_pool : public std::enable_shared_from_this<buffer_pool> {
+        public:
+            buffer_pool(size_t buffer_size);
+            ~buffer_pool();
+
+            /* Take a buffer from the pool, or allocate a new one if there are none left.
+             * The returned buffer holds one reference
+             *
+             * Return nullptr if all of the allowed buffers are in use or memory allocation fails */
+            uvgrtp::pool_buffer *acquire();
+
+            size_t get_buffer_size() const;
+
+            /* Limit the number of buffers the pool allocates, 0 means no limit */
+            void set_max_buffers(size_t max_buffers);
+
+        private:
+            friend void release_buffer(uvgrtp::pool_buffer *buffer);
+
+            void put(uvgrtp::pool_buffer *buffer);
+
+            std::mutex mutex_;
+            std::vector<uvgrtp::pool_buffer *> free_;
+            size_t buffer_size_;
+            size_t allocated_;
+            size_t max_buffers_;
+    };
+
+    /* Add a reference to "buffer" */
+    void hold_buffer(uvgrtp::pool_buffer *buffer);
+
+    /* Drop a reference to "buffer" and return it to its pool if it was the last one */
+    void release_buffer(uvgrtp::pool_buffer *buffer);
+
+    /* Free the payload of "frame", either by releasing the pooled buffer it points into or by
+     * deallocating it. The payload pointer of "frame" is reset */
+    void release_payload(uvgrtp::frame::rtp_frame *frame);
+}
+
+namespace uvg_rtp = uvgrtp;
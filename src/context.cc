@@ -91,6 +91,16 @@ rtp_error_t uvgrtp::context::destroy_session(uvgrtp::session *session)
     return RTP_OK;
 }
 
+rtp_error_t uvgrtp::context::set_reactor_threads(unsigned threads)
+{
+    return sfp_->set_reactor_threads(threads);
+}
+
+void uvgrtp::context::set_user_driven_reactor(bool enabled)
+{
+    sfp_->set_user_driven_reactor(enabled);
+}
+
 std::string uvgrtp::context::generate_cname() const
 {
     std::string host = uvgrtp::hostname::get_hostname();
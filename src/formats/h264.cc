@@ -1,5 +1,7 @@
 #include "h264.hh"
 
+#include "../buffer_pool.hh"
+#include "../frame_pool.hh"
 #include "../frame_queue.hh"
 #include "../rtp.hh"
 
@@ -40,11 +42,6 @@ uint8_t uvgrtp::formats::h264::get_fu_header_size() const
     return HEADER_SIZE_H264_FU;
 }
 
-uint8_t uvgrtp::formats::h264::get_start_code_range() const
-{
-    return 1; // H264 can have three byte start codes and therefore we must scan one byte at a time
-}
-
 uvgrtp::formats::FRAG_TYPE uvgrtp::formats::h264::get_fragment_type(uvgrtp::frame::rtp_frame* frame) const
 {
     bool first_frag = frame->payload[1] & 0x80;
@@ -176,13 +173,22 @@ uvgrtp::frame::rtp_frame* uvgrtp::formats::h264::allocate_rtp_frame_with_startco
 {
     uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_rtp_frame();
 
+    if (!complete) {
+        return nullptr;
+    }
+
     complete->payload_len = payload_size_without_startcode;
 
     if (add_start_code) {
         complete->payload_len += 3;
     }
 
-    complete->payload = new uint8_t[complete->payload_len];
+    complete->payload = uvgrtp::frame_pool::alloc_payload(complete->payload_len, complete->buffer);
+
+    if (!complete->payload) {
+        (void)uvgrtp::frame::dealloc_frame(complete);
+        return nullptr;
+    }
 
     if (add_start_code && complete->payload_len >= 3) {
         complete->payload[0] = 0;
@@ -196,19 +202,26 @@ uvgrtp::frame::rtp_frame* uvgrtp::formats::h264::allocate_rtp_frame_with_startco
     return complete;
 }
 
-void uvgrtp::formats::h264::prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out)
+rtp_error_t uvgrtp::formats::h264::prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out)
 {
     if (!(rce_flags & RCE_NO_H26X_PREPEND_SC)) {
-        uint8_t* pl = new uint8_t[(*out)->payload_len + 3];
+        uvgrtp::pool_buffer* buffer = nullptr;
+        uint8_t* pl = uvgrtp::frame_pool::alloc_payload((*out)->payload_len + 3, buffer);
+
+        if (!pl) {
+            return RTP_MEMORY_ERROR;
+        }
 
         pl[0] = 0;
         pl[1] = 0;
         pl[2] = 1;
 
         std::memcpy(pl + 3, (*out)->payload, (*out)->payload_len);
-        delete[](*out)->payload;
+        uvgrtp::release_payload(*out);
 
         (*out)->payload = pl;
+        (*out)->buffer = buffer;
         (*out)->payload_len += 3;
     }
+    return RTP_OK;
 }
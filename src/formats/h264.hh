@@ -70,7 +70,6 @@ namespace uvgrtp {
                 virtual uint8_t get_payload_header_size() const;
                 virtual uint8_t get_nal_header_size() const;
                 virtual uint8_t get_fu_header_size() const;
-                virtual uint8_t get_start_code_range() const;
 
                 virtual uvgrtp::formats::FRAG_TYPE get_fragment_type(uvgrtp::frame::rtp_frame* frame) const;
                 virtual uvgrtp::formats::NAL_TYPE  get_nal_type(uvgrtp::frame::rtp_frame* frame) const;
@@ -80,7 +79,7 @@ namespace uvgrtp {
                 virtual uvgrtp::frame::rtp_frame* allocate_rtp_frame_with_startcode(bool add_start_code,
                     uvgrtp::frame::rtp_header& header, size_t payload_size_without_startcode, size_t& fptr);
 
-                virtual void prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out);
+                virtual rtp_error_t prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out);
 
             private:
                 h264_aggregation_packet aggr_pkt_info_;
@@ -43,11 +43,6 @@ uint8_t uvgrtp::formats::h265::get_fu_header_size() const
     return HEADER_SIZE_H265_FU;
 }
 
-uint8_t uvgrtp::formats::h265::get_start_code_range() const
-{
-    return 4;
-}
-
 uvgrtp::formats::NAL_TYPE uvgrtp::formats::h265::get_nal_type(uvgrtp::frame::rtp_frame* frame) const
 {
     // see https://datatracker.ietf.org/doc/html/rfc7798#section-4.4.3
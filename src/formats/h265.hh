@@ -69,7 +69,6 @@ namespace uvgrtp {
                 virtual uint8_t get_payload_header_size() const;
                 virtual uint8_t get_nal_header_size() const;
                 virtual uint8_t get_fu_header_size() const;
-                virtual uint8_t get_start_code_range() const;
                 virtual uvgrtp::formats::FRAG_TYPE get_fragment_type(uvgrtp::frame::rtp_frame* frame) const;
                 virtual uvgrtp::formats::NAL_TYPE  get_nal_type(uvgrtp::frame::rtp_frame* frame) const;
 
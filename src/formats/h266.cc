@@ -44,11 +44,6 @@ uint8_t uvgrtp::formats::h266::get_fu_header_size() const
     return HEADER_SIZE_H266_FU;
 }
 
-uint8_t uvgrtp::formats::h266::get_start_code_range() const
-{
-    return 4;
-}
-
 uvgrtp::formats::NAL_TYPE uvgrtp::formats::h266::get_nal_type(uvgrtp::frame::rtp_frame* frame) const
 {
     // see https://datatracker.ietf.org/doc/html/rfc9328#section-4.3.3
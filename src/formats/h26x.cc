@@ -4,6 +4,8 @@
 
 #include "rtp.hh"
 #include "frame_queue.hh"
+#include "buffer_pool.hh"
+#include "frame_pool.hh"
 #include "debug.hh"
 
 
@@ -26,21 +28,6 @@
 
 #define PTR_DIFF(a, b)  ((ptrdiff_t)((char *)(a) - (char *)(b)))
 
-// see https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
-#define haszero64_le(v) (((v) - 0x0101010101010101) & ~(v) & 0x8080808080808080UL)
-#define haszero32_le(v) (((v) - 0x01010101)         & ~(v) & 0x80808080UL)
-
-#define haszero64_be(v) (((v) - 0x1010101010101010) & ~(v) & 0x0808080808080808UL)
-#define haszero32_be(v) (((v) - 0x10101010)         & ~(v) & 0x08080808UL)
-
-#ifndef __LITTLE_ENDIAN
-#define __LITTLE_ENDIAN 1337
-#endif
-
-#ifndef __BYTE_ORDER
-#define __BYTE_ORDER __LITTLE_ENDIAN
-#endif
-
 constexpr int GARBAGE_COLLECTION_INTERVAL_MS = 100;
 
 // any value less than 30 minutes is ok here, since that is how long it takes to go through all timestamps
@@ -50,52 +37,10 @@ constexpr int TIME_TO_KEEP_TRACK_OF_PREVIOUS_FRAMES_MS = 5000;
 // there is 90 000 timestamps in one second -> 5 sec is 450 000
 constexpr int RECEIVED_FRAMES = 450000;
 
-static inline uint8_t determine_start_prefix_precense(uint32_t value, bool& additional_byte)
-{
-    additional_byte = false;
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-    uint16_t cur_ls = (value >> 16) & 0xffff;
-    uint16_t cur_ms = (value >>  0) & 0xffff;
-
-    // zeros in more significant bytes
-    bool ms4z = (cur_ms                 == 0);
-    bool ms2z = (((cur_ms >> 8) & 0xff) == 0);
-
-    // possible start code end in less significant bytes
-    bool ls2s = ((cur_ls & 0xff)        == 0x01);
-    bool ls4s = (cur_ls                 == 0x0100);
-    
-#else
-    uint16_t cur_ls = (value >>  0) & 0xffff;
-    uint16_t cur_ms = (value >> 16) & 0xffff;
-
-    bool ms4z = ( cur_ms                == 0);
-    bool ms2z = ((cur_ms        & 0xff) == 0);
-    bool ls2s = (((cur_ls >> 8) & 0xff) == 0x01);
-    bool ls4s = (  cur_ls               == 0x0001);
-    
-#endif
-
-    if (ms4z) {
-        /* 0x00000001 */
-        if (ls4s)
-            return 4;
-
-        /* "value" definitely has a start code (0x000001XX), but at this
-         * point we can't know for sure whether it's 3 or 4 bytes long.
-         *
-         * Return 5 to indicate that start length could not be determined
-         * and that caller must check previous dword's last byte for 0x00 */
-        if (ls2s)
-            return 5;
-    } else if (ms2z && ls4s) {
-        /* 0xXX000001 */
-        additional_byte = true;
-        return 4;
-    }
-
-    return 0;
-}
+// how many fragments can wait for reconstruction, must be a power of two.
+// A fragment that is this many sequence numbers older than the newest one is dropped with its access unit
+constexpr size_t FRAGMENT_RING_SIZE = 1 << 14;
+constexpr uint16_t FRAGMENT_RING_MASK = FRAGMENT_RING_SIZE - 1;
 
 uvgrtp::formats::h26x::h26x(std::shared_ptr<uvgrtp::socket> socket, std::shared_ptr<uvgrtp::rtp> rtp, int rce_flags) :
     media(socket, rtp, rce_flags),
@@ -103,12 +48,18 @@ uvgrtp::formats::h26x::h26x(std::shared_ptr<uvgrtp::socket> socket, std::shared_
     access_units_(),
     received_frames_(),
     received_info_(),
-    fragments_(),
+    fragment_ring_(nullptr),
     dropped_ts_(),
     dropped_in_order_(),
     rtp_ctx_(rtp),
     last_garbage_collection_(uvgrtp::clock::hrc::now()),
-    discard_until_key_frame_(true)
+    discard_until_key_frame_(true),
+    scl_workers_(nullptr),
+    scl_locations_(),
+    nals_(),
+    incremental_reconstruction_(false),
+    reconstructing_incrementally_(false),
+    single_flush_(false)
 {}
 
 uvgrtp::formats::h26x::~h26x()
@@ -120,201 +71,30 @@ uvgrtp::formats::h26x::~h26x()
 
     queued_.clear();
 
-    for (auto& fragment : fragments_)
+    if (fragment_ring_)
     {
-        if (fragment.second != nullptr)
+        for (size_t i = 0; i < FRAGMENT_RING_SIZE; ++i)
         {
-            (void)uvgrtp::frame::dealloc_frame(fragment.second);
+            if (fragment_ring_[i].frame != nullptr)
+            {
+                (void)uvgrtp::frame::dealloc_frame(fragment_ring_[i].frame);
+            }
+
+            if (fragment_ring_[i].nal != nullptr)
+            {
+                (void)uvgrtp::frame::dealloc_frame(fragment_ring_[i].nal);
+            }
         }
     }
-
-    fragments_.clear();
 }
 
-/* NOTE: the area 0 - len (ie data[0] - data[len - 1]) must be addressable
- * Do not add offset to "data" ptr before passing it to find_h26x_start_code()! */
 ssize_t uvgrtp::formats::h26x::find_h26x_start_code(
-    uint8_t *data,
+    const uint8_t *data,
     size_t len,
     size_t offset,
     uint8_t& start_len)
 {
-    if (data == nullptr || len < offset || len < 1)
-    {
-        UVG_LOG_WARN("Invalid parameter found for start code lookup");
-        return -1;
-    }
-
-    bool prev_had_zero   = false;
-    bool cur_has_zero    = false;
-    size_t pos           = offset;
-    size_t last_byte_position = len - (len % 8) - 1;
-
-    /* We can get rid of the bounds check when looping through
-     * non-zero 8 byte chunks by setting the last byte to zero.
-     *
-     * This added zero will make the last 8 byte zero check to fail
-     * and when we get out of the loop we can check if we've reached the end */
-    uint8_t temp_last_byte    = data[last_byte_position];
-    data[last_byte_position] = 0;
-
-    uint32_t prev_value32 = UINT32_MAX;
-    uint32_t cur_value32 = UINT32_MAX;
-
-    uint64_t prefetch64 = UINT64_MAX;
-
-    while (pos + 4 <= len) {
-
-        if (!prev_had_zero)
-        {
-            // since we know that start code prefix has zeros, we find the next dword that has zeros
-            while (!cur_has_zero && pos + 8 <= len)
-            {
-                prefetch64 = *(uint64_t*)(data + pos);
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-                cur_has_zero = haszero64_le(prefetch64);
-#else
-                cur_has_zero = haszero64_be(prefetch64);
-#endif
-                if (!cur_has_zero)
-                {
-                    pos += 8;
-                }
-            }
-        }
-
-        if (pos + 4 <= len)
-        {
-            cur_value32 = *(uint32_t*)(data + pos);
-            //uint8_t* curr = (uint8_t*)&cur_value32;
-            //uint8_t* prev = (uint8_t*)&prev_value32;
-            //UVG_LOG_DEBUG("P: %u %u %u %u C: %u %u %u %u", prev[0], prev[1], prev[2], prev[3], curr[0], curr[1], curr[2], curr[3]);
-
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-            cur_has_zero = haszero32_le(cur_value32);
-#else
-            cur_has_zero = haszero32_be(cur_value32);
-#endif
-        }
-
-        if ((prev_had_zero || cur_has_zero) && pos + 4 <= len)
-        {
-            /* Previous dword had zeros but this doesn't. The only way there might be a start code
-             * is if the most significant byte of current dword is 0x01 */
-            if (prev_had_zero) {
-                /* previous dword: 0xXX000000 or 0xXXXX0000 and current dword 0x01XXXXXX */
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-                if (((cur_value32 >> 0) & 0xff) == 0x01 && ((prev_value32 >> 16) & 0xffff) == 0) {
-                    start_len = (((prev_value32 >>  8) & 0xffffff) == 0) ? 4 : 3;
-#else
-                if (((cur_value32 >> 24) & 0xff) == 0x01 && ((prev_value32 >>  0) & 0xffff) == 0) {
-                    start_len = (((prev_value32 >>  0) & 0xffffff) == 0) ? 4 : 3;
-#endif
-                    data[last_byte_position] = temp_last_byte;
-                    return pos + 1;
-                }
-            }
-
-            // find out if the current value as a whole contains start code prefix
-            bool additional_byte =  false;
-            uint8_t ret = determine_start_prefix_precense(cur_value32, additional_byte);
-            start_len = ret;
-            if (ret > 0) {
-                if (ret == 5) {
-                    // ret 5 means we don't know how long the start code is so we check it
-
-                    ret = 3;
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-                    start_len = (((prev_value32 >> 24) & 0xff) == 0) ? 4 : 3;
-#else
-                    start_len = (((prev_value32 >>  0) & 0xff) == 0) ? 4 : 3;
-#endif
-                }
-                if (additional_byte)
-                {
-                    --start_len;
-                }
-                data[last_byte_position] = temp_last_byte;
-                return pos + ret;
-            }
-
-            // see if the start code prefix is split between previous and this dword
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-            uint16_t cur_ls  = (cur_value32 >> 16) & 0xffff; // current less significant word
-            uint16_t cur_ms  = (cur_value32 >>  0) & 0xffff; // current more significant word
-            uint16_t prev_ls = (prev_value32 >> 16) & 0xffff; // previous less significant word
-
-            // previous has 4 zeros
-            bool p4z = (prev_ls                  == 0); 
-
-            // previous has 2 zeros
-            bool p2z = (((prev_ls >> 8) & 0xff)  == 0);
-            
-            // current has 2 bytes of possible start code
-            //bool c2s = (((cur_ms >> 8) & 0xff)              == 0x01);
-
-            // current has 4 bytes of possible start code
-            bool c4s = (cur_ms                              == 0x0100); // current starts with 0001
-
-            // current has 6 bytes of start code
-            bool c6s = (cur_ms == 0x0000 && (cur_ls & 0xff) == 0x01);   // current is 0000 01XX
-
-#else
-            uint16_t cur_ls =  (cur_value32 >>  0) & 0xffff;
-            uint16_t cur_ms =  (cur_value32 >> 16) & 0xffff;
-            uint16_t prev_ls = (prev_value32 >>  0) & 0xffff;
-
-            bool p4z = (prev_ls == 0);
-            bool p2z = ((prev_ls & 0xff)   == 0);
-            //bool c2s = ((cur_ms & 0xff)    == 0x01);
-            bool c4s = (cur_ms == 0x0001);
-            bool c6s = (cur_ms == 0x0000 && ((cur_ls >> 8) & 0xff) == 0x01);
-#endif
-            // all possible start code modes between two bytes
-            if (p4z && c4s) {
-                // previous dword 0xXXXX0000 and current dword is 0x0001XXXX
-                start_len = 4;
-                data[last_byte_position] = temp_last_byte;
-                return pos + 2;
-            } else if (p2z) {
-                // Previous dword was 0xXXXXXX00
-                
-                if (c6s) {
-                    // Current dword is 0x000001XX
-                    start_len = 4;
-                    data[last_byte_position] = temp_last_byte;
-                    return pos + 3;
-                }
-                else if (c4s) {
-                    // Current dword is 0x0001XXXX
-                    start_len = 3;
-                    data[last_byte_position] = temp_last_byte;
-                    return pos + 2;
-                }
-            }
-        }
-
-        pos += get_start_code_range();
-
-        if (get_start_code_range() == 4)
-        {
-            prev_had_zero = cur_has_zero;
-            prev_value32 = cur_value32;
-        }
-        else
-        {
-            prev_value32 = (prev_value32 >> 8 * get_start_code_range()) | (cur_value32 << 8 * (4 - get_start_code_range()));
-
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-            prev_had_zero = haszero32_le(prev_value32);
-#else
-            prev_had_zero = haszero32_be(prev_value32);
-#endif
-        }
-    }
-
-    data[last_byte_position] = temp_last_byte;
-    return -1;
+    return uvgrtp::formats::start_code::find(data, len, offset, start_len);
 }
 
 rtp_error_t uvgrtp::formats::h26x::frame_getter(uvgrtp::frame::rtp_frame** frame)
@@ -345,7 +125,8 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
     size_t payload_size = rtp_ctx_->get_payload_size();
 
     // find all the locations of NAL units using Start Code Lookup (SCL)
-    std::vector<nal_info> nals;
+    std::vector<nal_info>& nals = nals_;
+    nals.clear();
     bool should_aggregate = false;
 
     rtp_format_t fmt = rtp_ctx_->get_payload();
@@ -357,6 +138,7 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
         nal.size = data_len;
         nal.aggregate = false;
         nal.was_aggregated = false;
+        nal.data = data;
 
         nals.push_back(nal);
     }
@@ -370,7 +152,57 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
         return RTP_INVALID_VALUE;
     }
 
-    bool do_not_aggr = (rtp_flags & RTP_H26X_DO_NOT_AGGR);
+    return send_nal_units(addr, addr6, nals, should_aggregate, rtp_flags, ssrc);
+}
+
+rtp_error_t uvgrtp::formats::h26x::push_nal_units(sockaddr_in& addr, sockaddr_in6& addr6,
+    const uvgrtp::frame::nal_unit *units, size_t count, int rtp_flags, uint32_t ssrc)
+{
+    rtp_error_t ret = RTP_OK;
+
+    if (!units || !count)
+        return RTP_INVALID_VALUE;
+
+    // the frame queue could only keep one of the buffers until the kernel has sent them
+    if (rce_flags_ & RCE_UDP_ZEROCOPY) {
+        UVG_LOG_ERROR("A list of NAL units cannot be sent with RCE_UDP_ZEROCOPY");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    std::vector<nal_info>& nals = nals_;
+    nals.clear();
+    nals.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!units[i].data || !units[i].len)
+            return RTP_INVALID_VALUE;
+
+        nal_info nal;
+        nal.size = units[i].len;
+        nal.data = units[i].data;
+
+        nals.push_back(nal);
+    }
+
+    if ((ret = fqueue_->init_transaction(units[0].data)) != RTP_OK) {
+        UVG_LOG_ERROR("Invalid frame queue or failed to initialize transaction!");
+        return ret;
+    }
+
+    bool should_aggregate = mark_aggregates(nals, rtp_ctx_->get_payload_size());
+
+    return send_nal_units(addr, addr6, nals, should_aggregate, rtp_flags, ssrc);
+}
+
+rtp_error_t uvgrtp::formats::h26x::send_nal_units(sockaddr_in& addr, sockaddr_in6& addr6,
+    std::vector<nal_info>& nals, bool should_aggregate, int rtp_flags, uint32_t ssrc)
+{
+    rtp_error_t ret = RTP_OK;
+    size_t payload_size = rtp_ctx_->get_payload_size();
+
+    // aggregation packets point to headers outside of the frame which cannot be kept for zero-copy sending
+    bool do_not_aggr = (rtp_flags & RTP_H26X_DO_NOT_AGGR) || (rce_flags_ & RCE_UDP_ZEROCOPY);
+    bool single_flush = single_flush_;
 
     if (should_aggregate && !do_not_aggr) // an aggregate packet is possible
     {
@@ -383,7 +215,7 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
             if (nal.aggregate)
             {
                 nal.was_aggregated = true;
-                if ((ret = add_aggregate_packet(data + nal.offset, nal.size)) != RTP_OK)
+                if ((ret = add_aggregate_packet(nal.data, nal.size)) != RTP_OK)
                 {
                     clear_aggregation_info();
                     fqueue_->deinit_transaction();
@@ -396,16 +228,24 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
         }
 
         (void)finalize_aggregation_pkt();
-        // actually send the packets
-        ret = fqueue_->flush_queue(addr, addr6, ssrc);
-        clear_aggregation_info();
+
+        if (!single_flush)
+        {
+            // actually send the packets
+            ret = fqueue_->flush_queue(addr, addr6, ssrc);
+            clear_aggregation_info();
+        }
     }
 
     for (auto& nal : nals) // non-aggregatable NAL units
     {
         if (do_not_aggr || !nal.was_aggregated || !should_aggregate)
         {
-            if ((ret = fqueue_->init_transaction(data + nal.offset, true)) != RTP_OK) {
+            if (single_flush) {
+                // the packets of the access unit are collected to the transaction created above
+                fqueue_->next_media_unit();
+            }
+            else if ((ret = fqueue_->init_transaction(nal.data, true)) != RTP_OK) {
                 UVG_LOG_ERROR("Invalid frame queue or failed to initialize transaction!");
                 return ret;
             }
@@ -413,11 +253,11 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
             // add anything extra to the packet and we can just compare the NAL size with the payload size allowed
             if (nal.size <= payload_size) // send as a single NAL unit packet
             {
-                ret = single_nal_unit(data + nal.offset, nal.size);
+                ret = single_nal_unit(nal.data, nal.size);
             }
             else // send divided based on payload_size
             {
-                ret = fu_division(&data[nal.offset], nal.size, payload_size);
+                ret = fu_division(nal.data, nal.size, payload_size);
             }
 
             if (ret != RTP_OK)
@@ -426,12 +266,62 @@ rtp_error_t uvgrtp::formats::h26x::push_media_frame(sockaddr_in& addr, sockaddr_
                 fqueue_->deinit_transaction();
                 return ret;
             }
-            ret = fqueue_->flush_queue(addr, addr6, ssrc);
+
+            if (!single_flush)
+            {
+                ret = fqueue_->flush_queue(addr, addr6, ssrc);
+            }
         }
     }
+
+    if (single_flush)
+    {
+        // the aggregation packet refers to aggregation info so it can be cleared only after sending
+        ret = fqueue_->flush_queue(addr, addr6, ssrc);
+        clear_aggregation_info();
+    }
     return ret;
 }
 
+void uvgrtp::formats::h26x::set_scl_threads(size_t threads)
+{
+    std::lock_guard<std::mutex> lg(scl_mutex_);
+
+    if (threads == (scl_workers_ ? scl_workers_->threads() : 0))
+        return;
+
+    scl_workers_.reset();
+
+    if (threads > 0)
+        scl_workers_.reset(new uvgrtp::formats::start_code::workers(threads));
+}
+
+size_t uvgrtp::formats::h26x::get_scl_threads() const
+{
+    std::lock_guard<std::mutex> lg(scl_mutex_);
+    return scl_workers_ ? scl_workers_->threads() : 0;
+}
+
+void uvgrtp::formats::h26x::set_incremental_reconstruction(bool enabled)
+{
+    incremental_reconstruction_ = enabled;
+}
+
+bool uvgrtp::formats::h26x::get_incremental_reconstruction() const
+{
+    return incremental_reconstruction_;
+}
+
+void uvgrtp::formats::h26x::set_single_flush(bool enabled)
+{
+    single_flush_ = enabled;
+}
+
+bool uvgrtp::formats::h26x::get_single_flush() const
+{
+    return single_flush_;
+}
+
 rtp_error_t uvgrtp::formats::h26x::add_aggregate_packet(uint8_t* data, size_t data_len)
 {
     // the default implementation is to just use single NAL units and don't do the aggregate packet
@@ -524,13 +414,22 @@ uvgrtp::frame::rtp_frame* uvgrtp::formats::h26x::allocate_rtp_frame_with_startco
 {
     uvgrtp::frame::rtp_frame* complete = uvgrtp::frame::alloc_rtp_frame();
 
+    if (!complete) {
+        return nullptr;
+    }
+
     complete->payload_len = payload_size_without_startcode;
 
     if (add_start_code) {
         complete->payload_len += 4;
     } 
     
-    complete->payload = new uint8_t[complete->payload_len];
+    complete->payload = uvgrtp::frame_pool::alloc_payload(complete->payload_len, complete->buffer);
+
+    if (!complete->payload) {
+        (void)uvgrtp::frame::dealloc_frame(complete);
+        return nullptr;
+    }
 
     if (add_start_code && complete->payload_len >= 4) {
         complete->payload[0] = 0;
@@ -545,14 +444,19 @@ uvgrtp::frame::rtp_frame* uvgrtp::formats::h26x::allocate_rtp_frame_with_startco
     return complete;
 }
 
-void uvgrtp::formats::h26x::prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out)
+rtp_error_t uvgrtp::formats::h26x::prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out)
 {
     rtp_format_t fmt = rtp_ctx_->get_payload();
     if (fmt == RTP_FORMAT_ATLAS) {
-        return;
+        return RTP_OK;
     }
     if (!(rce_flags & RCE_NO_H26X_PREPEND_SC)) {
-        uint8_t* pl = new uint8_t[(*out)->payload_len + 4];
+        uvgrtp::pool_buffer* buffer = nullptr;
+        uint8_t* pl = uvgrtp::frame_pool::alloc_payload((*out)->payload_len + 4, buffer);
+
+        if (!pl) {
+            return RTP_MEMORY_ERROR;
+        }
 
         pl[0] = 0;
         pl[1] = 0;
@@ -560,11 +464,13 @@ void uvgrtp::formats::h26x::prepend_start_code(int rce_flags, uvgrtp::frame::rtp
         pl[3] = 1;
 
         std::memcpy(pl + 4, (*out)->payload, (*out)->payload_len);
-        delete[](*out)->payload;
+        uvgrtp::release_payload(*out);
 
         (*out)->payload = pl;
+        (*out)->buffer = buffer;
         (*out)->payload_len += 4;
     }
+    return RTP_OK;
 }
 
 size_t uvgrtp::formats::h26x::drop_access_unit(uint32_t ts)
@@ -584,10 +490,25 @@ size_t uvgrtp::formats::h26x::drop_access_unit(uint32_t ts)
         ts, s_seq, e_seq, frames_[ts].received_packet_seqs.size(), calculate_expected_fus(ts));
     */
 
-    for (auto& fragment_seq : access_units_[ts].incomplete_packet_seqs)
+    access_unit_info& au = access_units_[ts];
+
+    if (au.pending > 0)
     {
-        total_cleaned += fragments_[fragment_seq]->payload_len + sizeof(uvgrtp::frame::rtp_frame);
-        free_fragment(fragment_seq);
+        /* Only the slots between the first and the last fragment of the access unit can hold its fragments.
+         * An access unit spanning more sequence numbers than the ring has slots is looked up from all of them */
+        size_t span = (size_t)uint16_t(au.last_seq - au.first_seq) + 1;
+        bool whole_ring = span > FRAGMENT_RING_SIZE;
+
+        for (size_t i = 0; i < (whole_ring ? FRAGMENT_RING_SIZE : span); ++i)
+        {
+            uint16_t seq = uint16_t(au.first_seq + i);
+            fragment_slot& slot = whole_ring ? fragment_ring_[i] : fragment_ring_[seq & FRAGMENT_RING_MASK];
+            if ((slot.frame != nullptr || slot.nal != nullptr) && slot.ts == ts && (whole_ring || slot.seq == seq))
+            {
+                total_cleaned += (slot.frame ? slot.frame->payload_len : slot.nal_capacity) + sizeof(uvgrtp::frame::rtp_frame);
+                free_fragment(slot.seq);
+            }
+        }
     }
 
     dropped_ts_[ts] = access_units_.at(ts).sframe_time;
@@ -635,6 +556,11 @@ rtp_error_t uvgrtp::formats::h26x::handle_aggregation_packet(uvgrtp::frame::rtp_
         bool prepend_startcode = !(rce_flags & RCE_NO_H26X_PREPEND_SC);
         uvgrtp::frame::rtp_frame* retframe = 
             allocate_rtp_frame_with_startcode(prepend_startcode, (*out)->header, nalus[i].first, fptr);
+
+        if (!retframe) {
+            UVG_LOG_ERROR("Failed to allocate memory for an aggregated NAL unit, dropping it");
+            continue;
+        }
         
         std::memcpy(
             retframe->payload + fptr,
@@ -720,7 +646,12 @@ rtp_error_t uvgrtp::formats::h26x::packet_handler(void* args, int rce_flags, uin
         //completed_ts_[frame->header.timestamp] = std::chrono::high_resolution_clock::now();
 
         // nothing special needs to be done, just possibly add start codes back
-        prepend_start_code(rce_flags, out);
+        if (prepend_start_code(rce_flags, out) != RTP_OK) {
+            UVG_LOG_ERROR("Failed to allocate memory for a start code, dropping the NAL unit");
+            (void)uvgrtp::frame::dealloc_frame(*out);
+            *out = nullptr;
+            return RTP_MEMORY_ERROR;
+        }
         return RTP_PKT_READY;
     }
     else if (frag_type == uvgrtp::formats::FRAG_TYPE::FT_INVALID) {
@@ -743,142 +674,300 @@ rtp_error_t uvgrtp::formats::h26x::packet_handler(void* args, int rce_flags, uin
     
     //UVG_LOG_DEBUG("Received FU, ts: %lu, Seq: %u", fragment_ts, fragment_seq);
 
+    if (!fragment_ring_) {
+        fragment_ring_ = std::unique_ptr<fragment_slot[]>(new fragment_slot[FRAGMENT_RING_SIZE]);
+    }
+
+    if (reconstructing_incrementally_ != incremental_reconstruction_ && !fragments_pending()) {
+        reconstructing_incrementally_ = incremental_reconstruction_;
+    }
+
+    fragment_slot& slot = fragment_ring_[fragment_seq & FRAGMENT_RING_MASK];
+
+    if (slot.frame != nullptr || slot.nal != nullptr) {
+        if (slot.seq == fragment_seq && slot.ts == fragment_ts) {
+            // we have already received this seq
+            UVG_LOG_DEBUG("Detected duplicate fragment, dropping! Fragment ts: %lu, Seq: %u",
+                fragment_ts, fragment_seq);
+            (void)uvgrtp::frame::dealloc_frame(frame); // free fragment memory
+            *out = nullptr;
+            return RTP_GENERIC_ERROR;
+        }
+
+        /* The fragment in this slot has waited for its NAL unit for a whole ring of sequence numbers,
+         * so the rest of its access unit is not going to arrive */
+        uint32_t old_ts = slot.ts;
+        UVG_LOG_WARN("Fragment ring full, dropping access unit. Old fragment seq: %u, ts: %lu, current seq: %u, ts: %lu",
+            slot.seq, old_ts, fragment_seq, fragment_ts);
+
+        drop_access_unit(old_ts);
+
+        if (slot.frame != nullptr || slot.nal != nullptr) {
+            free_fragment(slot.seq);
+        }
+
+        if (old_ts == fragment_ts) {
+            (void)uvgrtp::frame::dealloc_frame(frame);
+            *out = nullptr;
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
     // Initialize new access unit if this is the first packet with this timestamp
     if (access_units_.find(fragment_ts) == access_units_.end()) {
         initialize_new_access_unit(fragment_ts);
         //UVG_LOG_DEBUG("intialized new access unit, ts %u, seq %u", fragment_ts, fragment_seq);
     }
-    else if (access_units_[fragment_ts].received_packet_seqs.find(fragment_seq) !=
-        access_units_[fragment_ts].received_packet_seqs.end()) {
-        // we have already received this seq
-        UVG_LOG_DEBUG("Detected duplicate fragment, dropping! Fragment ts: %lu, Seq: %u",
-            fragment_ts, fragment_seq);
-        (void)uvgrtp::frame::dealloc_frame(frame); // free fragment memory
-        *out = nullptr;
-        return RTP_GENERIC_ERROR;
-    }
 
     const uint8_t sizeof_fu_headers = (uint8_t)get_payload_header_size() + 
                                                get_fu_header_size();
     access_unit_info &au = access_units_[fragment_ts];
-    // keep track of fragments belonging to this frame
-    au.received_packet_seqs.insert(fragment_seq);
-    au.incomplete_packet_seqs.insert(fragment_seq);
-    au.fragments_info[fragment_seq] = {false, false, false};
+
+    if (!au.has_fragments) {
+        au.has_fragments = true;
+        au.first_seq = fragment_seq;
+        au.last_seq = fragment_seq;
+    }
+    else if (int16_t(fragment_seq - au.first_seq) < 0) {
+        au.first_seq = fragment_seq;
+    }
+    else if (int16_t(fragment_seq - au.last_seq) > 0) {
+        au.last_seq = fragment_seq;
+    }
 
     au.total_size += (frame->payload_len - sizeof_fu_headers);
+    ++au.pending;
+
+    // save the fragment for later reconstruction
+    slot.frame = frame;
+    slot.ts = fragment_ts;
+    slot.seq = fragment_seq;
+    slot.other_end = fragment_seq;
+    slot.start = (frag_type == uvgrtp::formats::FRAG_TYPE::FT_START);
+    slot.end = (frag_type == uvgrtp::formats::FRAG_TYPE::FT_END);
 
-    // This may not be necessary, as new duplicate fragments should get dropped already above
-    if (fragments_[fragment_seq] != nullptr) {
-        UVG_LOG_WARN("Found an existing fragment with same sequence number %u! Fragment ts: %lu, current ts: %lu",
-            fragment_seq, fragments_[fragment_seq]->header.timestamp, fragment_ts);
+    if (reconstructing_incrementally_) {
+        rtp_error_t ret = place_fragment(out, slot, rce_flags, nal_type, sizeof_fu_headers);
 
-        free_fragment(fragment_seq);
+        garbage_collect_lost_frames(rtp_ctx_->get_pkt_max_delay());
+        return ret;
     }
 
-    // save the fragment for later reconstruction
-    fragments_[fragment_seq] = frame;
+    /* Join the runs of consecutive fragments on either side of this fragment, unless they belong to
+     * another NAL unit. Only the endpoints of a run are updated, so this does not depend on the length
+     * of the runs. A NAL unit is complete once its run begins with a start and ends with an end fragment */
+    uint16_t first = fragment_seq;
+    uint16_t last = fragment_seq;
 
-    // if this is first or last, save it to help with reconstruction
-    if (frag_type == uvgrtp::formats::FRAG_TYPE::FT_START) {
-        au.fragments_info[fragment_seq].start = true;
+    if (!slot.start) {
+        fragment_slot *prev = find_fragment(uint16_t(fragment_seq - 1), fragment_ts);
+        if (prev && !prev->end) {
+            first = prev->other_end;
+        }
     }
-    else if (frag_type == uvgrtp::formats::FRAG_TYPE::FT_END) {
-        //au.end_seqs.push_back(fragment_seq);
-        au.fragments_info[fragment_seq].end = true;
+
+    if (!slot.end) {
+        fragment_slot *next = find_fragment(uint16_t(fragment_seq + 1), fragment_ts);
+        if (next && !next->start) {
+            last = next->other_end;
+        }
     }
 
-    /* Used to keep track of fragments that can be used for reconstruction.
-    If a NAL unit is reconstructed, these can be removed from incomplete_packet_seqs after the loop below. */
-    std::unordered_map<uint16_t, nal>reconstructed_fragments = {}; 
+    fragment_slot& first_slot = fragment_ring_[first & FRAGMENT_RING_MASK];
+    fragment_slot& last_slot = fragment_ring_[last & FRAGMENT_RING_MASK];
+    first_slot.other_end = last;
+    last_slot.other_end = first;
 
-    // figure out if we have the start sequence number and which seq it is (usually first, but not always)
     rtp_error_t ret = RTP_OK;
-    uint16_t start_seq = 0;
-    bool start_found = false;
-    for (const uint16_t& fragment : au.incomplete_packet_seqs) {
-        if (au.fragments_info[fragment].start)
-        {
-            start_seq = fragment;
-            start_found = true;
-            reconstructed_fragments[fragment] = {}; // If this is start FU, initialize a new map for it
-            reconstructed_fragments.at(start_seq).seqs.insert(start_seq);
-            break;
+
+    if (first_slot.start && last_slot.end) {
+        /* A continuous set of fragments with a start and end has been found. NAL unit can be reconstructed */
+        size_t nal_size = 0; // Find size of the complete reconstructed NAL unit
+        size_t fragment_count = 0;
+        for (uint16_t i = first; ; ++i) {
+            nal_size += (fragment_ring_[i & FRAGMENT_RING_MASK].frame->payload_len - sizeof_fu_headers);
+            ++fragment_count;
+
+            if (i == last) {
+                break;
+            }
+        }
+
+        if (drop_for_missing_reference(fragment_ts, nal_type, rce_flags, first, last)) {
+            *out = nullptr;
+            return RTP_GENERIC_ERROR;
         }
+
+        au.pending -= fragment_count;
+        ret = reconstruction(out, nal_size, rce_flags, first, last, sizeof_fu_headers);
     }
 
-    if (!start_found)
-    {
-        return ret;
+    // make sure uvgRTP does not reserve increasing amounts of memory by deleting old access unit information
+    garbage_collect_lost_frames(rtp_ctx_->get_pkt_max_delay());
+    return ret;
+}
+
+bool uvgrtp::formats::h26x::drop_for_missing_reference(uint32_t ts, uvgrtp::formats::NAL_TYPE nal_type,
+    int rce_flags, uint16_t first, uint16_t last)
+{
+    /* Work in progress feature: here we discard inter frames if their references were not received correctly */
+    bool enable_reference_discarding = (rce_flags & RCE_H26X_DEPENDENCY_ENFORCEMENT);
+    if (discard_until_key_frame_ && enable_reference_discarding) {
+        if (nal_type == uvgrtp::formats::NAL_TYPE::NT_INTER) {
+            UVG_LOG_WARN("Dropping h26x access unit because of missing reference. Timestamp: %lu. Seq: %u - %u",
+                ts, first, last);
+
+            drop_access_unit(ts);
+            return true;
+        }
+        else if (nal_type == uvgrtp::formats::NAL_TYPE::NT_INTRA) {
+
+            // we don't have to discard anymore
+            UVG_LOG_INFO("Found a key frame at ts %lu", ts);
+            discard_until_key_frame_ = false;
+        }
     }
+    return false;
+}
 
-    /* Check all the incomplete fragments of this access unit, by looking for a set of fragments with consecutive
-   sequence numbers that starts with a start fragment and ends in an end fragment. If this is found,
-   a NAL unit can be reconstructed. */
-    uint16_t next_seq = next_seq_num(start_seq);
-    uint16_t current_fragment = nextSeq(start_seq, au.incomplete_packet_seqs);
+rtp_error_t uvgrtp::formats::h26x::place_fragment(uvgrtp::frame::rtp_frame** out, fragment_slot& slot,
+    int rce_flags, uvgrtp::formats::NAL_TYPE nal_type, const uint8_t sizeof_fu_headers)
+{
+    uint32_t ts = slot.ts;
+    access_unit_info& au = access_units_[ts];
 
-    while (current_fragment != start_seq) { // go until we reconstruct or find the start again
+    if (slot.start) {
+        /* Reserve room for the fragments of this NAL unit received so far, append_fragment() grows
+         * the NAL unit if the rest of them do not fit */
+        size_t nal_size = slot.frame->payload_len - sizeof_fu_headers;
 
-        bool is_end = au.fragments_info[current_fragment].end;
+        for (uint16_t seq = uint16_t(slot.seq + 1); !slot.end; ++seq) {
+            fragment_slot* next = find_fragment(seq, ts);
+            if (next == nullptr || next->start) {
+                break;
+            }
 
-        // check that this frament is continuous 
-        if (current_fragment != next_seq) {
-            break;
+            nal_size += next->frame->payload_len - sizeof_fu_headers;
+            if (next->end) {
+                break;
+            }
         }
-        else {
-            reconstructed_fragments.at(start_seq).seqs.insert(current_fragment);
+
+        size_t fptr = 0;
+        bool start_code = !(rce_flags & RCE_NO_H26X_PREPEND_SC);
+        if (rtp_ctx_->get_payload() == RTP_FORMAT_ATLAS) {
+            start_code = false;
+        }
+        uvgrtp::frame::rtp_frame* nal = allocate_rtp_frame_with_startcode(start_code,
+            slot.frame->header, get_nal_header_size() + nal_size, fptr);
+
+        if (!nal) {
+            UVG_LOG_ERROR("Failed to allocate memory for NAL unit reconstruction, dropping access unit %lu", ts);
+            drop_access_unit(ts);
+            *out = nullptr;
+            return RTP_MEMORY_ERROR;
         }
 
-        /* A continuous set of fragments with a start and end has been found. NAL unit can be reconstructed */
-        if (is_end) {
-            size_t nal_size = 0; // Find size of the complete reconstructed NAL unit       
-            for (auto p : reconstructed_fragments.at(start_seq).seqs) {
-                nal_size += (fragments_[p]->payload_len - sizeof_fu_headers);
-                au.fragments_info[p].reconstructed = true;
-            }
+        get_nal_header_from_fu_headers(fptr, slot.frame->payload, nal->payload);
 
-            /* Work in progress feature: here we discard inter frames if their references were not received correctly */
-            bool enable_reference_discarding = (rce_flags & RCE_H26X_DEPENDENCY_ENFORCEMENT);
-            if (discard_until_key_frame_ && enable_reference_discarding) {
-                if (nal_type == uvgrtp::formats::NAL_TYPE::NT_INTER) {
-                    UVG_LOG_WARN("Dropping h26x access unit because of missing reference. Timestamp: %lu. Seq: %u - %u",
-                        fragment_ts, *access_units_[fragment_ts].received_packet_seqs.begin(), 
-                        *access_units_[fragment_ts].received_packet_seqs.rbegin());
+        slot.nal_capacity = nal->payload_len;
+        nal->payload_len = fptr + get_nal_header_size();
+        slot.nal = nal;
+        slot.other_end = slot.seq;
+    }
+    else {
+        fragment_slot* prev = find_partial_nal(uint16_t(slot.seq - 1), ts);
+        if (prev == nullptr) {
+            // wait in the ring until the fragments before this one have been received
+            return RTP_OK;
+        }
 
-                    drop_access_unit(fragment_ts);
-                    return RTP_GENERIC_ERROR;
-                }
-                else if (nal_type == uvgrtp::formats::NAL_TYPE::NT_INTRA) {
+        slot.nal = prev->nal;
+        slot.nal_capacity = prev->nal_capacity;
+        slot.other_end = prev->other_end;
+        prev->nal = nullptr;
+        --au.pending;
+    }
 
-                    // we don't have to discard anymore
-                    UVG_LOG_INFO("Found a key frame at ts %lu", fragment_ts);
-                    discard_until_key_frame_ = false;
-                }
-            }
-            if ((reconstruction(out, nal_size, rce_flags, start_seq, current_fragment, sizeof_fu_headers)) == RTP_PKT_READY) {
-                ret = RTP_PKT_READY;
-            }
-            reconstructed_fragments.at(start_seq).complete = true;
+    /* Copy this fragment and the ones waiting right after it. The partial NAL unit moves along to the
+     * slot of the last copied fragment, where the next fragment finds it */
+    fragment_slot* current = &slot;
+    *out = nullptr;
+
+    while (true) {
+        uvgrtp::frame::rtp_frame* fragment = current->frame;
+        current->frame = nullptr;
+
+        bool appended = append_fragment(*current, fragment, sizeof_fu_headers);
+        (void)uvgrtp::frame::dealloc_frame(fragment);
+
+        if (!appended) {
+            drop_access_unit(ts);
+            return RTP_MEMORY_ERROR;
         }
 
+        if (current->end) {
+            break;
+        }
 
-        next_seq = next_seq_num(next_seq);
-        current_fragment = nextSeq(current_fragment, au.incomplete_packet_seqs);
+        fragment_slot* next = find_fragment(uint16_t(current->seq + 1), ts);
+        if (next == nullptr || next->start) {
+            return RTP_OK;
+        }
+
+        next->nal = current->nal;
+        next->nal_capacity = current->nal_capacity;
+        next->other_end = current->other_end;
+        current->nal = nullptr;
+        --au.pending;
+        current = next;
     }
 
+    uvgrtp::frame::rtp_frame* complete = current->nal;
+    uint16_t first = current->other_end;
+    uint16_t last = current->seq;
+    current->nal = nullptr;
+    --au.pending;
 
-    for (auto& p : reconstructed_fragments) {
-        if (p.second.complete) {
-            for (auto &print : p.second.seqs) {
-                //UVG_LOG_DEBUG("reconstructed from fragment %u", print);
-                au.incomplete_packet_seqs.erase(print);
-            }
+    if (drop_for_missing_reference(ts, nal_type, rce_flags, first, last)) {
+        (void)uvgrtp::frame::dealloc_frame(complete);
+        return RTP_GENERIC_ERROR;
+    }
+
+    *out = complete;
+    return RTP_PKT_READY;
+}
+
+bool uvgrtp::formats::h26x::append_fragment(fragment_slot& slot, uvgrtp::frame::rtp_frame* fragment,
+    const uint8_t sizeof_fu_headers)
+{
+    uvgrtp::frame::rtp_frame* nal = slot.nal;
+    size_t len = fragment->payload_len - sizeof_fu_headers;
+
+    if (nal->payload_len + len > slot.nal_capacity) {
+        // grow geometrically so that a NAL unit is only copied a few times
+        size_t capacity = std::max(nal->payload_len + len, 2 * slot.nal_capacity);
+        uvgrtp::pool_buffer* buffer = nullptr;
+        uint8_t* payload = uvgrtp::frame_pool::alloc_payload(capacity, buffer);
+
+        if (payload == nullptr) {
+            UVG_LOG_ERROR("Failed to allocate %zu bytes for NAL unit reconstruction", capacity);
+            return false;
         }
+
+        size_t written = nal->payload_len;
+        std::memcpy(payload, nal->payload, written);
+        uvgrtp::release_payload(nal);
+
+        nal->payload = payload;
+        nal->buffer = buffer;
+        nal->payload_len = written;
+        slot.nal_capacity = capacity;
     }
-    // make sure uvgRTP does not reserve increasing amounts of memory by deleting old access unit information
-    garbage_collect_lost_frames(rtp_ctx_->get_pkt_max_delay());
-    return ret;
+
+    std::memcpy(&nal->payload[nal->payload_len], &fragment->payload[sizeof_fu_headers], len);
+    nal->payload_len += len;
+    return true;
 }
 
 void uvgrtp::formats::h26x::garbage_collect_lost_frames(size_t timout)
@@ -915,11 +1004,10 @@ void uvgrtp::formats::h26x::garbage_collect_lost_frames(size_t timout)
 
 void uvgrtp::formats::h26x::initialize_new_access_unit(uint32_t ts)
 {
-    access_units_[ts].received_packet_seqs = {};
-    access_units_[ts].fragments_info = {};
-
     access_units_[ts].sframe_time = uvgrtp::clock::hrc::now();
     access_units_[ts].total_size = 0;
+    access_units_[ts].pending = 0;
+    access_units_[ts].has_fragments = false;
 }
 
 uint16_t uvgrtp::formats::h26x::next_seq_num(uint16_t seq)
@@ -933,41 +1021,91 @@ uint16_t uvgrtp::formats::h26x::next_seq_num(uint16_t seq)
     }
 }
 
+uvgrtp::formats::fragment_slot* uvgrtp::formats::h26x::find_fragment(uint16_t seq, uint32_t ts)
+{
+    fragment_slot *slot = &fragment_ring_[seq & FRAGMENT_RING_MASK];
+
+    if (slot->frame == nullptr || slot->seq != seq || slot->ts != ts) {
+        return nullptr;
+    }
+    return slot;
+}
+
+bool uvgrtp::formats::h26x::fragments_pending() const
+{
+    for (auto& au : access_units_) {
+        if (au.second.pending > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uvgrtp::formats::fragment_slot* uvgrtp::formats::h26x::find_partial_nal(uint16_t seq, uint32_t ts)
+{
+    fragment_slot *slot = &fragment_ring_[seq & FRAGMENT_RING_MASK];
+
+    if (slot->nal == nullptr || slot->seq != seq || slot->ts != ts) {
+        return nullptr;
+    }
+    return slot;
+}
+
 void uvgrtp::formats::h26x::free_fragment(uint16_t sequence_number)
 {
-    if (fragments_[sequence_number] == nullptr)
+    fragment_slot *slot = fragment_ring_ ? &fragment_ring_[sequence_number & FRAGMENT_RING_MASK] : nullptr;
+
+    if (slot == nullptr || (slot->frame == nullptr && slot->nal == nullptr) || slot->seq != sequence_number)
     {
         UVG_LOG_ERROR("Tried to free an already freed fragment with seq: %u", sequence_number);
         return;
     }
 
-    (void)uvgrtp::frame::dealloc_frame(fragments_[sequence_number]); // free fragment memory
-    fragments_[sequence_number] = nullptr;
-    fragments_.erase(sequence_number);
+    if (slot->frame != nullptr) {
+        (void)uvgrtp::frame::dealloc_frame(slot->frame); // free fragment memory
+        slot->frame = nullptr;
+    }
+
+    if (slot->nal != nullptr) {
+        (void)uvgrtp::frame::dealloc_frame(slot->nal);
+        slot->nal = nullptr;
+    }
 }
 
 void uvgrtp::formats::h26x::scl(uint8_t* data, size_t data_len, size_t packet_size, 
     std::vector<nal_info>& nals, bool& can_be_aggregated)
 {
-    uint8_t start_len = 0;
-    ssize_t offset = find_h26x_start_code(data, data_len, 0, start_len);
-
-    packet_size -= get_payload_header_size(); // aggregate packet has a payload header
+    std::unique_lock<std::mutex> lk(scl_mutex_);
+
+    if (scl_workers_) {
+        // large frames are scanned in parallel
+        scl_locations_.clear();
+        scl_workers_->find_all(data, data_len, scl_locations_);
+
+        for (auto& location : scl_locations_) {
+            nal_info nal;
+            nal.offset = location.offset;
+            nal.prefix_len = location.start_len;
+            nals.push_back(nal);
+        }
+    }
+    else {
+        uint8_t start_len = 0;
+        ssize_t offset = find_h26x_start_code(data, data_len, 0, start_len);
 
-    while (offset > -1) {
-        nal_info nal;
-        nal.offset = size_t(offset);
-        nal.prefix_len = start_len;
-        nal.size = 0; // set after all NALs have been found
-        nal.aggregate = false; // determined with size calculations
+        while (offset > -1) {
+            nal_info nal;
+            nal.offset = size_t(offset);
+            nal.prefix_len = start_len;
+            nal.size = 0; // set after all NALs have been found
+            nal.aggregate = false; // determined with size calculations
 
 
-        nals.push_back(nal);
-        offset = find_h26x_start_code(data, data_len, offset, start_len);
+            nals.push_back(nal);
+            offset = find_h26x_start_code(data, data_len, offset, start_len);
+        }
     }
-
-    size_t aggregate_size = 0;
-    int aggregatable_packets = 0;
+    lk.unlock();
 
     // calculate the sizes of NAL units
     for (size_t i = 0; i < nals.size(); ++i)
@@ -984,6 +1122,21 @@ void uvgrtp::formats::h26x::scl(uint8_t* data, size_t data_len, size_t packet_si
             nals.at(i).size = data_len - nals[i].offset;
         }
 
+        nals.at(i).data = data + nals[i].offset;
+    }
+
+    can_be_aggregated = mark_aggregates(nals, packet_size);
+}
+
+bool uvgrtp::formats::h26x::mark_aggregates(std::vector<nal_info>& nals, size_t packet_size)
+{
+    size_t aggregate_size = 0;
+    int aggregatable_packets = 0;
+
+    packet_size -= get_payload_header_size(); // aggregate packet has a payload header
+
+    for (size_t i = 0; i < nals.size(); ++i)
+    {
         // each NAL unit added to aggregate packet needs the size added which has to be taken into account
         // when calculating the aggregate packet 
         // (NOTE: This is not enough for MTAP in h264, but I doubt uvgRTP will support it)
@@ -995,13 +1148,14 @@ void uvgrtp::formats::h26x::scl(uint8_t* data, size_t data_len, size_t packet_si
         }
     }
 
-    can_be_aggregated = (aggregatable_packets >= 2);
+    return aggregatable_packets >= 2;
 }
 
 rtp_error_t uvgrtp::formats::h26x::reconstruction(uvgrtp::frame::rtp_frame** out, size_t nal_size, 
     int rce_flags, uint16_t s_seq, uint16_t e_seq, const uint8_t sizeof_fu_headers)
 {
     uvgrtp::frame::rtp_frame* frame = *out;
+    uint32_t ts = frame->header.timestamp;
     //UVG_LOG_DEBUG("Reconstructing frame. Ts: %lu, Seq: %u -> %u", ts, s_seq, e_seq);
 
     // Reconstruction of frame from fragments
@@ -1015,6 +1169,18 @@ rtp_error_t uvgrtp::formats::h26x::reconstruction(uvgrtp::frame::rtp_frame** out
     uvgrtp::frame::rtp_frame* complete = allocate_rtp_frame_with_startcode(start_code,
         frame->header, get_nal_header_size() + nal_size, fptr);
 
+    if (!complete) {
+        UVG_LOG_ERROR("Failed to allocate memory for NAL unit reconstruction, dropping access unit %lu", ts);
+
+        // these fragments no longer count as pending, so drop_access_unit() would not find them
+        for (uint16_t i = s_seq; i != uint16_t(next_seq_num(e_seq)); ++i) {
+            free_fragment(i);
+        }
+        drop_access_unit(ts);
+        *out = nullptr;
+        return RTP_MEMORY_ERROR;
+    }
+
     // construct the NAL header from fragment header of current fragment
     get_nal_header_from_fu_headers(fptr, frame->payload, complete->payload); // NAL header
     fptr += get_nal_header_size();
@@ -1023,20 +1189,22 @@ rtp_error_t uvgrtp::formats::h26x::reconstruction(uvgrtp::frame::rtp_frame** out
     uint16_t next_from_last = uint16_t(next_seq_num(e_seq));
     for (uint16_t i = s_seq; i != next_from_last; ++i)
     {
-        if (fragments_[i] == nullptr)
+        fragment_slot *fragment = find_fragment(i, ts);
+        if (fragment == nullptr)
         {
             UVG_LOG_ERROR("Missing fragment in reconstruction. Seq range: %u - %u. Missing seq %u",
                 s_seq, e_seq, i);
+            (void)uvgrtp::frame::dealloc_frame(complete);
             return RTP_GENERIC_ERROR;
         }
 
         // copy everything expect fu headers (which repeat for every fu)
         std::memcpy(
             &complete->payload[fptr],
-            &fragments_[i]->payload[sizeof_fu_headers],
-            fragments_[i]->payload_len - sizeof_fu_headers
+            &fragment->frame->payload[sizeof_fu_headers],
+            fragment->frame->payload_len - sizeof_fu_headers
         );
-        fptr += fragments_[i]->payload_len - sizeof_fu_headers;
+        fptr += fragment->frame->payload_len - sizeof_fu_headers;
         free_fragment(i);
     }
 
@@ -1044,15 +1212,3 @@ rtp_error_t uvgrtp::formats::h26x::reconstruction(uvgrtp::frame::rtp_frame** out
     return RTP_PKT_READY; // indicate that we have a frame ready
 }
 
-
-uint16_t uvgrtp::formats::h26x::nextSeq(uint16_t currentSeq, std::set<uint16_t>& fragments)
-{
-    auto currentIterator = fragments.find(currentSeq);
-
-    if (*currentIterator == *(fragments.rbegin()))
-    {
-        return *(fragments.begin());
-    }
-
-    return *(++currentIterator);
-}
\ No newline at end of file
@@ -5,10 +5,13 @@
 #include "uvgrtp/frame.hh"
 
 #include "media.hh"
+#include "start_code.hh"
 #include "../socket.hh"
 
+#include <atomic>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_set>
 #ifdef _WIN32
@@ -41,16 +44,23 @@ namespace uvgrtp {
             NT_OTHER = 0xff
         };
 
-        struct frag_info {
-            bool start = false;
-            bool end = false;
-            bool reconstructed = false;
-        };
+        /* A fragment waiting for the rest of its NAL unit in the fragment ring of h26x */
+        struct fragment_slot {
+            uvgrtp::frame::rtp_frame *frame = nullptr;
+            uint32_t ts = 0;
+            uint16_t seq = 0;
+
+            /* The fragments of a NAL unit that have been received in a row form a run. At either end
+             * of a run, this is the sequence number of the other end. Not updated inside a run */
+            uint16_t other_end = 0;
+
+            bool start = false; /* S bit */
+            bool end = false;   /* E bit */
 
-        /* Used for determining if the NAL unit can be reconstructed */
-        struct nal {
-            bool complete = false;
-            std::set<uint16_t> seqs = {};
+            /* With incremental reconstruction, the NAL unit whose fragments have been copied up to and
+             * including "seq". The fragment itself has been freed, so "frame" is nullptr */
+            uvgrtp::frame::rtp_frame *nal = nullptr;
+            size_t nal_capacity = 0;
         };
 
         struct access_unit_info {
@@ -60,12 +70,14 @@ namespace uvgrtp {
             /* total size of all fragments */
             size_t total_size = 0;
 
-            /* Keep track of all sequence numbers for an access unit, as well as the ones that have not been yet used for reconstruction */
-            std::set<uint16_t> received_packet_seqs;
-            std::set<uint16_t> incomplete_packet_seqs;
+            /* number of fragments in the fragment ring that have not been used for reconstruction */
+            size_t pending = 0;
 
-            /* Save frag_info for each fragment in an access unit */
-            std::unordered_map<uint16_t, frag_info> fragments_info;
+            /* The lowest and highest sequence number of the fragments received, so that dropping the
+             * access unit only visits its own slots of the fragment ring */
+            bool has_fragments = false;
+            uint16_t first_seq = 0;
+            uint16_t last_seq = 0;
         };
 
         struct nal_info
@@ -75,6 +87,9 @@ namespace uvgrtp {
             size_t size = 0;
             bool aggregate = false;
             bool was_aggregated = false;
+
+            /* first byte of the NAL unit header, "offset" is relative to the frame found by SCL */
+            uint8_t *data = nullptr;
         };
 
         class h26x : public media {
@@ -82,12 +97,12 @@ namespace uvgrtp {
                 h26x(std::shared_ptr<uvgrtp::socket> socket, std::shared_ptr<uvgrtp::rtp> rtp, int rce_flags);
                 virtual ~h26x();
 
-                /* Find H26x start code from "data"
+                /* Find H26x start code from "data", see start_code::find()
                  * This process is the same for H26{4,5,6}
                  *
-                 * Return the offset of the start code on success
+                 * Return the offset of the first byte after the start code on success
                  * Return -1 if no start code was found */
-                ssize_t find_h26x_start_code(uint8_t *data, size_t len, size_t offset, uint8_t& start_len);
+                ssize_t find_h26x_start_code(const uint8_t *data, size_t len, size_t offset, uint8_t& start_len);
 
                 /* Top-level push_frame() called by the Media class
                  * Sets up the frame queue for the send operation
@@ -96,6 +111,27 @@ namespace uvgrtp {
                  * Return RTP_INVALID_VALUE if one of the parameters is invalid */
                 rtp_error_t push_media_frame(sockaddr_in& addr, sockaddr_in6& addr6, uint8_t *data, size_t data_len, int rtp_flags, uint32_t ssrc);
 
+                /* Send the NAL units of an access unit located by the application, see media::push_nal_units()
+                 *
+                 * Return RTP_OK on success
+                 * Return RTP_INVALID_VALUE if one of the parameters is invalid
+                 * Return RTP_NOT_SUPPORTED if RCE_UDP_ZEROCOPY is enabled */
+                rtp_error_t push_nal_units(sockaddr_in& addr, sockaddr_in6& addr6, const uvgrtp::frame::nal_unit *units,
+                    size_t count, int rtp_flags, uint32_t ssrc);
+
+                /* Start or stop the threads that scan large frames in parallel, 0 stops them */
+                void set_scl_threads(size_t threads);
+                size_t get_scl_threads() const;
+
+                /* The packet handler switches to the new mode once no fragments are waiting in the ring,
+                 * fragments placed by one mode cannot be reconstructed by the other */
+                void set_incremental_reconstruction(bool enabled);
+                bool get_incremental_reconstruction() const;
+
+                /* Takes effect from the next push_frame() */
+                void set_single_flush(bool enabled);
+                bool get_single_flush() const;
+
                 /* If the packet handler must return more than one frame, it can install a frame getter
                  * that is called by the auxiliary handler caller if packet_handler() returns RTP_MULTIPLE_PKTS_READY
                  *
@@ -152,16 +188,17 @@ namespace uvgrtp {
                 virtual uint8_t get_payload_header_size() const = 0;
                 virtual uint8_t get_nal_header_size() const = 0;
                 virtual uint8_t get_fu_header_size() const = 0;
-                virtual uint8_t get_start_code_range() const = 0;
                 virtual uvgrtp::formats::FRAG_TYPE get_fragment_type(uvgrtp::frame::rtp_frame* frame) const = 0;
                 virtual uvgrtp::formats::NAL_TYPE  get_nal_type(uvgrtp::frame::rtp_frame* frame) const = 0;
 
                 virtual void get_nal_header_from_fu_headers(size_t fptr, uint8_t* frame_payload, uint8_t* complete_payload) = 0;
 
+                /* Return nullptr if memory cannot be allocated */
                 virtual uvgrtp::frame::rtp_frame* allocate_rtp_frame_with_startcode(bool add_start_code,
                     uvgrtp::frame::rtp_header& header, size_t payload_size_without_startcode, size_t& fptr);
 
-                virtual void prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out);
+                /* Return RTP_MEMORY_ERROR if memory cannot be allocated, "out" is left untouched */
+                virtual rtp_error_t prepend_start_code(int rce_flags, uvgrtp::frame::rtp_frame** out);
 
         private:
             size_t drop_access_unit(uint32_t ts);
@@ -169,19 +206,59 @@ namespace uvgrtp {
             inline uint16_t next_seq_num(uint16_t seq);
             inline void initialize_new_access_unit(uint32_t ts);
 
+            /* Return the slot of the fragment "seq" of access unit "ts" or nullptr if it is not in the ring */
+            inline fragment_slot *find_fragment(uint16_t seq, uint32_t ts);
+
+            /* Return the slot of the partially reconstructed NAL unit of access unit "ts" whose last
+             * copied fragment is "seq" or nullptr if there is none */
+            inline fragment_slot *find_partial_nal(uint16_t seq, uint32_t ts);
+
+            /* Free the fragment or the partially reconstructed NAL unit in the slot of "sequence_number" */
             void free_fragment(uint16_t sequence_number);
 
+            /* Return true if an access unit has fragments or partial NAL units in the fragment ring */
+            bool fragments_pending() const;
+
             void scl(uint8_t* data, size_t data_len, size_t packet_size, 
                 std::vector<nal_info>& nals, bool& can_be_aggregated);
 
+            /* Mark the NAL units that fit in an aggregation packet with "packet_size" bytes of payload
+             *
+             * Return true if an aggregation packet can be used */
+            bool mark_aggregates(std::vector<nal_info>& nals, size_t packet_size);
+
+            /* Packetize and send "nals" with the transaction that has been initialized for them */
+            rtp_error_t send_nal_units(sockaddr_in& addr, sockaddr_in6& addr6, std::vector<nal_info>& nals,
+                bool should_aggregate, int rtp_flags, uint32_t ssrc);
+
             void garbage_collect_lost_frames(size_t timout);
 
             rtp_error_t reconstruction(uvgrtp::frame::rtp_frame** out, size_t nal_size,
                 int rce_flags, uint16_t s_seq, uint16_t e_seq, const uint8_t sizeof_fu_headers);
 
-            bool is_duplicate_frame(uint32_t timestamp, uint16_t seq_num);
+            /* Drop the access unit "ts" if the NAL unit "first" - "last" is an inter frame that arrived after
+             * a lost reference, see RCE_H26X_DEPENDENCY_ENFORCEMENT
+             *
+             * Return true if the access unit was dropped */
+            bool drop_for_missing_reference(uint32_t ts, uvgrtp::formats::NAL_TYPE nal_type, int rce_flags,
+                uint16_t first, uint16_t last);
+
+            /* Handle the fragment in "slot" with incremental reconstruction, see RCC_H26X_INCREMENTAL_RECONSTRUCTION.
+             * The fragment is appended to its NAL unit if the fragments before it have been received,
+             * followed by any fragments that were waiting for it in the ring
+             *
+             * Return RTP_PKT_READY if the NAL unit is complete, it is written to "out"
+             * Return RTP_OK if the NAL unit is still missing fragments
+             * Return RTP_GENERIC_ERROR if the access unit was dropped */
+            rtp_error_t place_fragment(uvgrtp::frame::rtp_frame** out, fragment_slot& slot, int rce_flags,
+                uvgrtp::formats::NAL_TYPE nal_type, const uint8_t sizeof_fu_headers);
+
+            /* Copy the payload of "fragment" to the end of the partial NAL unit in "slot", growing it if needed
+             *
+             * Return false if memory allocation fails */
+            bool append_fragment(fragment_slot& slot, uvgrtp::frame::rtp_frame* fragment, const uint8_t sizeof_fu_headers);
 
-            uint16_t nextSeq(uint16_t currentSeq, std::set<uint16_t>& fragments);
+            bool is_duplicate_frame(uint32_t timestamp, uint16_t seq_num);
 
             std::deque<uvgrtp::frame::rtp_frame*> queued_;
             std::unordered_map<uint32_t, access_unit_info> access_units_;
@@ -194,8 +271,8 @@ namespace uvgrtp {
             std::deque<pkt_stats> received_frames_;
             std::unordered_map<uint32_t, std::vector<uint16_t>> received_info_;
 
-            // Holds all possible fragments with sequence number
-            std::unordered_map<uint16_t, uvgrtp::frame::rtp_frame*> fragments_;
+            // Fragments waiting for reconstruction, indexed by their sequence number modulo the ring size
+            std::unique_ptr<fragment_slot[]> fragment_ring_;
 
             // keep track of old, dropped access units so we don't accept invalid fragments
             std::unordered_map<uint32_t, uvgrtp::clock::hrc::hrc_t> dropped_ts_;
@@ -208,6 +285,21 @@ namespace uvgrtp {
             uvgrtp::clock::hrc::hrc_t last_garbage_collection_;
 
             bool discard_until_key_frame_ = true;
+
+            /* Held while the workers scan a frame so that they are not stopped under push_frame() */
+            mutable std::mutex scl_mutex_;
+            std::unique_ptr<uvgrtp::formats::start_code::workers> scl_workers_;
+            std::vector<uvgrtp::formats::start_code::location> scl_locations_;
+
+            /* NAL units of the frame being sent. Cleared for each frame so that its memory is reused */
+            std::vector<nal_info> nals_;
+
+            // the mode set by the application and the one the packet handler is using
+            std::atomic<bool> incremental_reconstruction_;
+            bool reconstructing_incrementally_;
+
+            // RCC_H26X_SINGLE_FLUSH
+            std::atomic<bool> single_flush_;
         };
     }
 }
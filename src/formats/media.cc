@@ -27,7 +27,14 @@ rtp_error_t uvgrtp::formats::media::push_frame(sockaddr_in& addr, sockaddr_in6&
     if (!data || !data_len)
         return RTP_INVALID_VALUE;
 
-    return push_media_frame(addr, addr6, data, data_len, rtp_flags, ssrc);
+    if (!(rce_flags_ & RCE_UDP_ZEROCOPY))
+        return push_media_frame(addr, addr6, data, data_len, rtp_flags, ssrc);
+
+    fqueue_->hold_frame(data);
+    rtp_error_t ret = push_media_frame(addr, addr6, data, data_len, rtp_flags, ssrc);
+    fqueue_->release_frame();
+
+    return ret;
 }
 
 rtp_error_t uvgrtp::formats::media::push_frame(sockaddr_in& addr, sockaddr_in6& addr6,
@@ -36,7 +43,25 @@ rtp_error_t uvgrtp::formats::media::push_frame(sockaddr_in& addr, sockaddr_in6&
     if (!data || !data_len)
         return RTP_INVALID_VALUE;
 
-    return push_media_frame(addr, addr6, data.get(), data_len, rtp_flags, ssrc);
+    if (!(rce_flags_ & RCE_UDP_ZEROCOPY))
+        return push_media_frame(addr, addr6, data.get(), data_len, rtp_flags, ssrc);
+
+    // frame queue keeps the frame until the kernel has sent it
+    uint8_t *ptr = data.get();
+    fqueue_->hold_frame(std::move(data));
+    rtp_error_t ret = push_media_frame(addr, addr6, ptr, data_len, rtp_flags, ssrc);
+    fqueue_->release_frame();
+
+    return ret;
+}
+
+rtp_error_t uvgrtp::formats::media::push_nal_units(sockaddr_in& addr, sockaddr_in6& addr6,
+    const uvgrtp::frame::nal_unit *units, size_t count, int rtp_flags, uint32_t ssrc)
+{
+    (void)addr, (void)addr6, (void)units, (void)count, (void)rtp_flags, (void)ssrc;
+
+    UVG_LOG_ERROR("Only H26x streams can send lists of NAL units");
+    return RTP_NOT_SUPPORTED;
 }
 
 rtp_error_t uvgrtp::formats::media::push_media_frame(sockaddr_in& addr, sockaddr_in6& addr6,
@@ -195,4 +220,39 @@ rtp_error_t uvgrtp::formats::media::packet_handler(void* arg, int rce_flags, uin
 void uvgrtp::formats::media::set_fps(ssize_t numerator, ssize_t denominator)
 {
     fqueue_->set_fps(numerator, denominator);
+}
+
+void uvgrtp::formats::media::set_scl_threads(size_t threads)
+{
+    (void)threads;
+}
+
+size_t uvgrtp::formats::media::get_scl_threads() const
+{
+    return 0;
+}
+
+void uvgrtp::formats::media::set_incremental_reconstruction(bool enabled)
+{
+    (void)enabled;
+}
+
+bool uvgrtp::formats::media::get_incremental_reconstruction() const
+{
+    return false;
+}
+
+void uvgrtp::formats::media::set_single_flush(bool enabled)
+{
+    (void)enabled;
+}
+
+bool uvgrtp::formats::media::get_single_flush() const
+{
+    return false;
+}
+
+void uvgrtp::formats::media::install_dealloc_hook(void (*dealloc_hook)(void *))
+{
+    fqueue_->install_dealloc_hook(dealloc_hook);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@ namespace uvgrtp {
 
     namespace frame {
         struct rtp_frame;
+        struct nal_unit;
     }
 
     namespace formats {
@@ -57,6 +58,11 @@ namespace uvgrtp {
                 rtp_error_t push_frame(sockaddr_in& addr, sockaddr_in6& addr6, uint8_t *data, size_t data_len, int rtp_flags, uint32_t ssrc);
                 rtp_error_t push_frame(sockaddr_in& addr, sockaddr_in6& addr6, std::unique_ptr<uint8_t[]> data, size_t data_len, int rtp_flags, uint32_t ssrc);
 
+                /* Send an access unit given as a list of NAL units without start codes. Only the H26x
+                 * formats packetize NAL units, the others return RTP_NOT_SUPPORTED */
+                virtual rtp_error_t push_nal_units(sockaddr_in& addr, sockaddr_in6& addr6, const uvgrtp::frame::nal_unit *units,
+                    size_t count, int rtp_flags, uint32_t ssrc);
+
                 /* Media-specific packet handler. The default handler, depending on what "rce_flags_" contains,
                  * may only return the received RTP packet or it may merge multiple packets together before
                  * returning a complete frame to the user.
@@ -74,6 +80,24 @@ namespace uvgrtp {
 
                 void set_fps(ssize_t enumarator, ssize_t denominator);
 
+                /* Set how many worker threads help the start code lookup of large frames, see RCC_SCL_THREADS.
+                 * Only the H26x formats look for start codes, others ignore this */
+                virtual void set_scl_threads(size_t threads);
+                virtual size_t get_scl_threads() const;
+
+                /* Enable or disable incremental NAL unit reconstruction, see RCC_H26X_INCREMENTAL_RECONSTRUCTION.
+                 * Only the H26x formats reconstruct fragmented NAL units, others ignore this */
+                virtual void set_incremental_reconstruction(bool enabled);
+                virtual bool get_incremental_reconstruction() const;
+
+                /* Enable or disable sending each access unit with one flush, see RCC_H26X_SINGLE_FLUSH.
+                 * Only the H26x formats send access units of several NAL units, others ignore this */
+                virtual void set_single_flush(bool enabled);
+                virtual bool get_single_flush() const;
+
+                /* Deallocation hook for frames given as raw pointers, see frame_queue::install_dealloc_hook() */
+                void install_dealloc_hook(void (*dealloc_hook)(void *));
+
             protected:
                 virtual rtp_error_t push_media_frame(sockaddr_in& addr, sockaddr_in6& addr6, uint8_t *data, size_t data_len, int rtp_flags, uint32_t ssrc);
 
@@ -0,0 +1,441 @@
+#include "start_code.hh"
+
+#include "../debug.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define UVGRTP_SCL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* MSVC lets any function use the intrinsics, GCC and Clang need to be told
+ * which functions may use instructions beyond the baseline of the build */
+#if defined(UVGRTP_SCL_X86) && !defined(_MSC_VER)
+#define SCL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SCL_TARGET(isa)
+#endif
+
+/* frames smaller than this are scanned on the calling thread */
+constexpr size_t PARALLEL_MIN_SIZE = 1024 * 1024;
+
+/* a frame is split into two chunks per scanning thread, but none smaller than this */
+constexpr size_t MIN_CHUNK_SIZE    = 256 * 1024;
+
+// see https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord
+#define haszero64(v) (((v) - 0x0101010101010101ULL) & ~(v) & 0x8080808080808080ULL)
+
+typedef ssize_t (*scan_func)(const uint8_t *data, size_t len, size_t pos);
+
+static inline int lowest_bit(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+#if defined(_M_X64)
+    _BitScanForward64(&index, mask);
+#else
+    if (!_BitScanForward(&index, (unsigned long)mask)) {
+        _BitScanForward(&index, (unsigned long)(mask >> 32));
+        index += 32;
+    }
+#endif
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/* All scanners return the position of the first 0x00 of the first 0x000001 that begins at
+ * or after "pos" and is followed by at least one byte, or -1 if there is none */
+static ssize_t scan_scalar(const uint8_t *data, size_t len, size_t pos)
+{
+    while (pos + 3 < len) {
+
+        /* a start code cannot begin inside 8 bytes that have no zeros */
+        if (pos + 8 <= len) {
+            uint64_t value;
+            memcpy(&value, data + pos, sizeof(value));
+
+            if (!haszero64(value)) {
+                pos += 8;
+                continue;
+            }
+        }
+
+        /* The third byte decides how far we can skip: 0x01 rules out the start codes
+         * beginning at the next two bytes, anything larger rules out all three */
+        if (data[pos + 2] > 1) {
+            pos += 3;
+        } else if (data[pos + 2] == 0) {
+            pos += 1;
+        } else {
+            if (data[pos] == 0 && data[pos + 1] == 0)
+                return (ssize_t)pos;
+
+            pos += 3;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef UVGRTP_SCL_X86
+
+/* The vector scanners test "width" start positions per iteration by comparing the bytes at
+ * pos, pos + 1 and pos + 2 in parallel. A block is scanned only if all of its start codes would
+ * be followed by a byte, the rest is left to the scalar scanner */
+
+SCL_TARGET("sse2")
+static ssize_t scan_sse2(const uint8_t *data, size_t len, size_t pos)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi8(1);
+
+    while (pos + 16 + 3 <= len) {
+        __m128i first  = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i second = _mm_loadu_si128((const __m128i *)(data + pos + 1));
+        __m128i third  = _mm_loadu_si128((const __m128i *)(data + pos + 2));
+
+        __m128i zeros = _mm_cmpeq_epi8(_mm_or_si128(first, second), zero);
+        __m128i ones  = _mm_cmpeq_epi8(third, one);
+        int mask      = _mm_movemask_epi8(_mm_and_si128(zeros, ones));
+
+        if (mask)
+            return (ssize_t)(pos + lowest_bit((uint64_t)(uint32_t)mask));
+
+        pos += 16;
+    }
+
+    return scan_scalar(data, len, pos);
+}
+
+SCL_TARGET("avx2")
+static ssize_t scan_avx2(const uint8_t *data, size_t len, size_t pos)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi8(1);
+
+    while (pos + 32 + 3 <= len) {
+        __m256i first  = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i second = _mm256_loadu_si256((const __m256i *)(data + pos + 1));
+        __m256i third  = _mm256_loadu_si256((const __m256i *)(data + pos + 2));
+
+        __m256i zeros = _mm256_cmpeq_epi8(_mm256_or_si256(first, second), zero);
+        __m256i ones  = _mm256_cmpeq_epi8(third, one);
+        int mask      = _mm256_movemask_epi8(_mm256_and_si256(zeros, ones));
+
+        if (mask)
+            return (ssize_t)(pos + lowest_bit((uint64_t)(uint32_t)mask));
+
+        pos += 32;
+    }
+
+    return scan_sse2(data, len, pos);
+}
+
+SCL_TARGET("avx512f,avx512bw")
+static ssize_t scan_avx512(const uint8_t *data, size_t len, size_t pos)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one  = _mm512_set1_epi8(1);
+
+    while (pos + 64 + 3 <= len) {
+        __m512i first  = _mm512_loadu_si512((const void *)(data + pos));
+        __m512i second = _mm512_loadu_si512((const void *)(data + pos + 1));
+        __m512i third  = _mm512_loadu_si512((const void *)(data + pos + 2));
+
+        __mmask64 zeros = _mm512_cmpeq_epi8_mask(_mm512_or_si512(first, second), zero);
+        __mmask64 mask  = _mm512_mask_cmpeq_epi8_mask(zeros, third, one);
+
+        if (mask)
+            return (ssize_t)(pos + lowest_bit((uint64_t)mask));
+
+        pos += 64;
+    }
+
+    return scan_avx2(data, len, pos);
+}
+
+#ifdef _MSC_VER
+static bool cpu_supports(uvgrtp::formats::SCL_SCANNER scanner)
+{
+    int info[4];
+
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse2    = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    if (scanner == uvgrtp::formats::SCL_SCANNER::SSE2)
+        return sse2;
+
+    if (!osxsave || max_leaf < 7)
+        return false;
+
+    /* the operating system must save the vector registers on context switches */
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+
+    if (scanner == uvgrtp::formats::SCL_SCANNER::AVX2)
+        return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+
+    /* AVX-512F and AVX-512BW */
+    return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+}
+#else
+static bool cpu_supports(uvgrtp::formats::SCL_SCANNER scanner)
+{
+    __builtin_cpu_init();
+
+    switch (scanner) {
+        case uvgrtp::formats::SCL_SCANNER::SSE2:
+            return __builtin_cpu_supports("sse2");
+
+        case uvgrtp::formats::SCL_SCANNER::AVX2:
+            return __builtin_cpu_supports("avx2");
+
+        case uvgrtp::formats::SCL_SCANNER::AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+
+        default:
+            return false;
+    }
+}
+#endif
+
+#endif /* UVGRTP_SCL_X86 */
+
+static scan_func get_scanner(uvgrtp::formats::SCL_SCANNER scanner)
+{
+    switch (scanner) {
+#ifdef UVGRTP_SCL_X86
+        case uvgrtp::formats::SCL_SCANNER::SSE2:
+            return scan_sse2;
+
+        case uvgrtp::formats::SCL_SCANNER::AVX2:
+            return scan_avx2;
+
+        case uvgrtp::formats::SCL_SCANNER::AVX512:
+            return scan_avx512;
+#endif
+        default:
+            return scan_scalar;
+    }
+}
+
+static uvgrtp::formats::SCL_SCANNER select_scanner()
+{
+    const uvgrtp::formats::SCL_SCANNER preferred[] = {
+        uvgrtp::formats::SCL_SCANNER::AVX512,
+        uvgrtp::formats::SCL_SCANNER::AVX2,
+        uvgrtp::formats::SCL_SCANNER::SSE2
+    };
+
+    for (auto scanner : preferred) {
+        if (uvgrtp::formats::start_code::supported(scanner))
+            return scanner;
+    }
+
+    return uvgrtp::formats::SCL_SCANNER::SCALAR;
+}
+
+static uvgrtp::formats::SCL_SCANNER selected_scanner()
+{
+    static const uvgrtp::formats::SCL_SCANNER scanner = select_scanner();
+    return scanner;
+}
+
+static ssize_t find_with(scan_func scan, const uint8_t *data, size_t len, size_t offset, uint8_t& start_len)
+{
+    if (data == nullptr || len < offset || len < 1)
+    {
+        UVG_LOG_WARN("Invalid parameter found for start code lookup");
+        return -1;
+    }
+
+    ssize_t pos = scan(data, len, offset);
+
+    if (pos < 0)
+        return -1;
+
+    start_len = ((size_t)pos > offset && data[pos - 1] == 0) ? 4 : 3;
+    return pos + 3;
+}
+
+ssize_t uvgrtp::formats::start_code::find(const uint8_t *data, size_t len, size_t offset, uint8_t& start_len)
+{
+    return find_with(get_scanner(selected_scanner()), data, len, offset, start_len);
+}
+
+ssize_t uvgrtp::formats::start_code::find(SCL_SCANNER scanner, const uint8_t *data, size_t len,
+    size_t offset, uint8_t& start_len)
+{
+    return find_with(get_scanner(scanner), data, len, offset, start_len);
+}
+
+bool uvgrtp::formats::start_code::supported(SCL_SCANNER scanner)
+{
+    if (scanner == SCL_SCANNER::SCALAR)
+        return true;
+
+#ifdef UVGRTP_SCL_X86
+    return cpu_supports(scanner);
+#else
+    return false;
+#endif
+}
+
+uvgrtp::formats::SCL_SCANNER uvgrtp::formats::start_code::selected()
+{
+    return selected_scanner();
+}
+
+struct uvgrtp::formats::start_code::workers::chunk {
+    const uint8_t *data = nullptr;
+    size_t len = 0;
+    size_t begin = 0;
+    size_t end = 0;
+
+    /* positions of the first 0x00 of each start code beginning in [begin, end) */
+    std::vector<size_t> positions;
+    size_t *remaining = nullptr;
+};
+
+uvgrtp::formats::start_code::workers::workers(size_t threads) :
+    threads_(),
+    mutex_(),
+    work_cond_(),
+    done_cond_(),
+    queue_(),
+    stop_(false)
+{
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&uvgrtp::formats::start_code::workers::worker, this);
+    }
+}
+
+uvgrtp::formats::start_code::workers::~workers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cond_.notify_all();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t uvgrtp::formats::start_code::workers::threads() const
+{
+    return threads_.size();
+}
+
+void uvgrtp::formats::start_code::workers::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        work_cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+
+        if (queue_.empty())
+            return;
+
+        chunk *task = queue_.front();
+        queue_.pop_front();
+        scan(task, lock);
+    }
+}
+
+void uvgrtp::formats::start_code::workers::scan(chunk *task, std::unique_lock<std::mutex>& lock)
+{
+    lock.unlock();
+
+    /* a start code beginning before "end" has its first byte after it before end + 3 */
+    size_t limit = std::min(task->end + 3, task->len);
+    uint8_t start_len = 0;
+    ssize_t offset = find(task->data, limit, task->begin, start_len);
+
+    while (offset > -1) {
+        task->positions.push_back((size_t)offset - 3);
+        offset = find(task->data, limit, (size_t)offset, start_len);
+    }
+
+    lock.lock();
+
+    if (--*task->remaining == 0)
+        done_cond_.notify_all();
+}
+
+void uvgrtp::formats::start_code::workers::find_all(const uint8_t *data, size_t len, std::vector<location>& out)
+{
+    size_t chunk_size = std::max(len / (2 * (threads_.size() + 1)), MIN_CHUNK_SIZE);
+
+    if (threads_.empty() || len < PARALLEL_MIN_SIZE || chunk_size >= len) {
+        uint8_t start_len = 0;
+        ssize_t offset = find(data, len, 0, start_len);
+
+        while (offset > -1) {
+            out.push_back({ (size_t)offset, start_len });
+            offset = find(data, len, (size_t)offset, start_len);
+        }
+        return;
+    }
+
+    std::vector<chunk> chunks((len + chunk_size - 1) / chunk_size);
+    size_t remaining = chunks.size();
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].data = data;
+        chunks[i].len = len;
+        chunks[i].begin = i * chunk_size;
+        chunks[i].end = std::min(len, (i + 1) * chunk_size);
+        chunks[i].remaining = &remaining;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        queue_.push_back(&chunks[i]);
+    }
+    work_cond_.notify_all();
+
+    /* the calling thread scans the first chunk and then helps with the rest */
+    scan(&chunks[0], lock);
+
+    while (remaining > 0) {
+        auto it = std::find_if(queue_.begin(), queue_.end(), [&](chunk *task) { return task->remaining == &remaining; });
+
+        if (it == queue_.end()) {
+            done_cond_.wait(lock, [&] { return remaining == 0; });
+            break;
+        }
+
+        chunk *task = *it;
+        queue_.erase(it);
+        scan(task, lock);
+    }
+
+    lock.unlock();
+
+    /* find() only counts a zero byte before a start code as part of it if the zero comes after the
+     * previous start code, which the chunks did not know */
+    size_t search_offset = 0;
+
+    for (auto& task : chunks) {
+        for (size_t position : task.positions) {
+            uint8_t start_len = (position > search_offset && data[position - 1] == 0) ? 4 : 3;
+
+            search_offset = position + 3;
+            out.push_back({ search_offset, start_len });
+        }
+    }
+}
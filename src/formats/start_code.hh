@@ -0,0 +1,87 @@
+#pragma once
+
+#include "uvgrtp/util.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace uvgrtp {
+    namespace formats {
+
+        /* Implementations of the H26x start code lookup. The fastest one the CPU supports is
+         * selected on first use, the others are available for testing */
+        enum class SCL_SCANNER {
+            SCALAR = 0, /* 8 bytes at a time, available everywhere */
+            SSE2   = 1, /* 16 bytes at a time */
+            AVX2   = 2, /* 32 bytes at a time */
+            AVX512 = 3  /* 64 bytes at a time, needs AVX-512BW */
+        };
+
+        namespace start_code {
+
+            /* Find the first start code (0x000001 or 0x00000001) that begins at or after "offset"
+             * and is followed by at least one byte. "data" is only read, so it may point to
+             * read-only memory
+             *
+             * Return the offset of the first byte after the start code and write the length of
+             * the start code to "start_len". Zero bytes before "offset" are not counted
+             * Return -1 if there is no start code */
+            ssize_t find(const uint8_t *data, size_t len, size_t offset, uint8_t& start_len);
+
+            /* Same as find() but with a specific implementation, which must be supported */
+            ssize_t find(SCL_SCANNER scanner, const uint8_t *data, size_t len, size_t offset, uint8_t& start_len);
+
+            /* Return true if this build and the CPU support "scanner" */
+            bool supported(SCL_SCANNER scanner);
+
+            /* Return the implementation used by find() */
+            SCL_SCANNER selected();
+
+            struct location {
+                size_t offset = 0;    /* first byte after the start code */
+                uint8_t start_len = 0;
+            };
+
+            /* Worker threads that help find the start codes of large frames, see RCC_SCL_THREADS.
+             *
+             * A large frame is split into chunks that the workers and the calling thread scan in
+             * parallel. Each chunk reports the start codes that begin inside it, so a start code
+             * crossing a chunk boundary is found by the chunk where it begins */
+            class workers {
+                public:
+                    workers(size_t threads);
+                    ~workers();
+
+                    size_t threads() const;
+
+                    /* Find all start codes of "data". The result is the same as calling find() from
+                     * offset 0 and then from the offset of each found start code */
+                    void find_all(const uint8_t *data, size_t len, std::vector<location>& out);
+
+                private:
+                    struct chunk;
+
+                    void worker();
+
+                    /* scan "task", "lock" is released while scanning */
+                    void scan(chunk *task, std::unique_lock<std::mutex>& lock);
+
+                    std::vector<std::thread> threads_;
+
+                    std::mutex mutex_;
+                    std::condition_variable work_cond_;
+                    std::condition_variable done_cond_;
+                    std::deque<chunk *> queue_;
+                    bool stop_;
+            };
+        }
+    }
+}
+
+namespace uvg_rtp = uvgrtp;
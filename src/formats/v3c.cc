@@ -52,11 +52,6 @@ uint8_t uvgrtp::formats::v3c::get_fu_header_size() const
     return HEADER_SIZE_V3C_FU;
 }
 
-uint8_t uvgrtp::formats::v3c::get_start_code_range() const
-{
-    return 4;
-}
-
 uvgrtp::formats::NAL_TYPE uvgrtp::formats::v3c::get_nal_type(uvgrtp::frame::rtp_frame* frame) const
 {
     //uint8_t nal_type = frame->payload[2] & 0x3f;
@@ -2,6 +2,8 @@
 
 #include "uvgrtp/util.hh"
 
+#include "buffer_pool.hh"
+#include "frame_pool.hh"
 #include "debug.hh"
 
 #include <cstring>
@@ -9,7 +11,12 @@
 
 uvgrtp::frame::rtp_frame *uvgrtp::frame::alloc_rtp_frame()
 {
-    uvgrtp::frame::rtp_frame *frame = new uvgrtp::frame::rtp_frame;
+    uvgrtp::frame::rtp_frame *frame = uvgrtp::frame_pool::alloc_frame();
+
+    if (frame == nullptr) {
+        rtp_errno = RTP_MEMORY_ERROR;
+        return nullptr;
+    }
 
     frame->header.version   = 0;
     frame->header.padding   = 0;
@@ -33,7 +40,11 @@ uvgrtp::frame::rtp_frame *uvgrtp::frame::alloc_rtp_frame(size_t payload_len)
     if ((frame = uvgrtp::frame::alloc_rtp_frame()) == nullptr)
         return nullptr;
 
-    frame->payload     = new uint8_t[payload_len];
+    if ((frame->payload = uvgrtp::frame_pool::alloc_payload(payload_len, frame->buffer)) == nullptr) {
+        uvgrtp::frame_pool::free_frame(frame);
+        rtp_errno = RTP_MEMORY_ERROR;
+        return nullptr;
+    }
     frame->payload_len = payload_len;
 
     return frame;
@@ -52,12 +63,12 @@ rtp_error_t uvgrtp::frame::dealloc_frame(uvgrtp::frame::rtp_frame *frame)
         delete frame->ext;
     }
 
-    else if (frame->payload)
-        delete[] frame->payload;
+    if (frame->payload)
+        uvgrtp::release_payload(frame);
 
     //UVG_LOG_DEBUG("Deallocating frame, type %u", frame->type);
 
-    delete frame;
+    uvgrtp::frame_pool::free_frame(frame);
     return RTP_OK;
 }
 
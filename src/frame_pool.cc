@@ -0,0 +1,250 @@
+#include "frame_pool.hh"
+
+#include "uvgrtp/frame.hh"
+
+#include "buffer_pool.hh"
+#include "debug.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/* payloads of 64 bytes to 2 MB are pooled */
+constexpr int MIN_CLASS_SHIFT = 6;
+constexpr int SIZE_CLASSES    = 16;
+
+/* the free list of rtp_frame structs comes after the payload size classes */
+constexpr int FRAME_LIST = SIZE_CLASSES;
+constexpr int FREE_LISTS = SIZE_CLASSES + 1;
+
+/* A thread keeps about this many bytes of each list (but at least one block)
+ * before it hands half of them over to the shared cache */
+constexpr size_t THREAD_CACHE_BYTES = 256 * 1024;
+
+constexpr size_t DEFAULT_POOL_BUDGET = 16 * 1024 * 1024;
+
+struct shared_cache {
+    std::mutex mutex;
+    std::vector<void *> lists[FREE_LISTS];
+};
+
+struct thread_cache {
+    ~thread_cache();
+
+    std::vector<void *> lists[FREE_LISTS];
+};
+
+static std::atomic<size_t> budget(DEFAULT_POOL_BUDGET);
+static std::atomic<size_t> cached_bytes(0);
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> reuses(0);
+
+static thread_local thread_cache local_cache;
+
+/* set when "local_cache" has been destroyed at thread exit. Frames released after that,
+ * for example by destructors of static objects, are freed right away */
+static thread_local bool local_cache_gone = false;
+
+/* never destroyed so that threads exiting late can still hand their caches over */
+static shared_cache& get_shared_cache()
+{
+    static shared_cache *cache = new shared_cache;
+    return *cache;
+}
+
+static size_t block_size(int list)
+{
+    if (list == FRAME_LIST)
+        return sizeof(uvgrtp::frame::rtp_frame);
+
+    return (size_t)1 << (list + MIN_CLASS_SHIFT);
+}
+
+static size_t thread_cache_limit(int list)
+{
+    return std::max((size_t)1, THREAD_CACHE_BYTES / block_size(list));
+}
+
+/* Return -1 if "size" is larger than the largest size class */
+static int size_class(size_t size)
+{
+    int list = 0;
+
+    while (list < SIZE_CLASSES && block_size(list) < size)
+        ++list;
+
+    return list < SIZE_CLASSES ? list : -1;
+}
+
+static void destroy_block(int list, void *block)
+{
+    if (list == FRAME_LIST) {
+        delete (uvgrtp::frame::rtp_frame *)block;
+        return;
+    }
+
+    uvgrtp::pool_buffer *buffer = (uvgrtp::pool_buffer *)block;
+    delete[] buffer->data;
+    delete buffer;
+}
+
+thread_cache::~thread_cache()
+{
+    shared_cache& shared = get_shared_cache();
+    std::lock_guard<std::mutex> lg(shared.mutex);
+
+    for (int i = 0; i < FREE_LISTS; ++i)
+        shared.lists[i].insert(shared.lists[i].end(), lists[i].begin(), lists[i].end());
+
+    local_cache_gone = true;
+}
+
+/* The lists of the thread cache get all the room they need at once so that moving blocks
+ * between the caches does not allocate */
+static std::vector<void *>& get_local_list(int list)
+{
+    std::vector<void *>& blocks = local_cache.lists[list];
+
+    if (blocks.capacity() == 0)
+        blocks.reserve(thread_cache_limit(list) + 1);
+
+    return blocks;
+}
+
+/* Return nullptr if there are no cached blocks in "list" */
+static void *take_block(int list)
+{
+    if (local_cache_gone)
+        return nullptr;
+
+    std::vector<void *>& blocks = get_local_list(list);
+
+    if (blocks.empty()) {
+        shared_cache& shared = get_shared_cache();
+        std::lock_guard<std::mutex> lg(shared.mutex);
+
+        std::vector<void *>& from = shared.lists[list];
+        size_t count = std::min(from.size(), (thread_cache_limit(list) + 1) / 2);
+
+        blocks.insert(blocks.end(), from.end() - count, from.end());
+        from.resize(from.size() - count);
+    }
+
+    if (blocks.empty())
+        return nullptr;
+
+    void *block = blocks.back();
+    blocks.pop_back();
+
+    cached_bytes -= block_size(list);
+    ++reuses;
+
+    return block;
+}
+
+static void give_block(int list, void *block)
+{
+    size_t size = block_size(list);
+
+    if (local_cache_gone || cached_bytes.fetch_add(size) + size > budget) {
+        cached_bytes -= size;
+        destroy_block(list, block);
+        return;
+    }
+
+    std::vector<void *>& blocks = get_local_list(list);
+    blocks.push_back(block);
+
+    if (blocks.size() > thread_cache_limit(list)) {
+        /* the oldest half goes to the shared cache so that the thread allocating
+         * the frames gets back the ones released by the user's thread */
+        size_t count = blocks.size() / 2;
+
+        shared_cache& shared = get_shared_cache();
+        std::lock_guard<std::mutex> lg(shared.mutex);
+
+        shared.lists[list].insert(shared.lists[list].end(), blocks.begin(), blocks.begin() + count);
+        blocks.erase(blocks.begin(), blocks.begin() + count);
+    }
+}
+
+uvgrtp::frame::rtp_frame *uvgrtp::frame_pool::alloc_frame()
+{
+    if (void *block = take_block(FRAME_LIST)) {
+        uvgrtp::frame::rtp_frame *frame = (uvgrtp::frame::rtp_frame *)block;
+        *frame = uvgrtp::frame::rtp_frame();
+        return frame;
+    }
+
+    ++allocations;
+    return new (std::nothrow) uvgrtp::frame::rtp_frame;
+}
+
+void uvgrtp::frame_pool::free_frame(uvgrtp::frame::rtp_frame *frame)
+{
+    give_block(FRAME_LIST, frame);
+}
+
+uint8_t *uvgrtp::frame_pool::alloc_payload(size_t size, uvgrtp::pool_buffer *& buffer)
+{
+    int list = size_class(size);
+
+    if (list < 0) {
+        buffer = nullptr;
+        return new (std::nothrow) uint8_t[size];
+    }
+
+    buffer = (uvgrtp::pool_buffer *)take_block(list);
+
+    if (!buffer) {
+        buffer = new (std::nothrow) uvgrtp::pool_buffer;
+
+        if (!buffer || !(buffer->data = new (std::nothrow) uint8_t[block_size(list)])) {
+            UVG_LOG_ERROR("Failed to allocate a frame payload of %zu bytes", size);
+            delete buffer;
+            buffer = nullptr;
+            return nullptr;
+        }
+
+        buffer->size_class = list;
+        ++allocations;
+    }
+
+    buffer->refs = 1;
+    return buffer->data;
+}
+
+void uvgrtp::frame_pool::free_payload(uvgrtp::pool_buffer *buffer)
+{
+    give_block(buffer->size_class, buffer);
+}
+
+void uvgrtp::frame::set_pool_budget(size_t bytes)
+{
+    budget = bytes;
+
+    /* the thread caches are left as they are, they drain as their frames are reused */
+    shared_cache& shared = get_shared_cache();
+    std::lock_guard<std::mutex> lg(shared.mutex);
+
+    for (int i = 0; i < FREE_LISTS && cached_bytes > bytes; ++i) {
+        while (!shared.lists[i].empty() && cached_bytes > bytes) {
+            destroy_block(i, shared.lists[i].back());
+            shared.lists[i].pop_back();
+            cached_bytes -= block_size(i);
+        }
+    }
+}
+
+uvgrtp::frame::pool_stats uvgrtp::frame::get_pool_stats()
+{
+    uvgrtp::frame::pool_stats stats;
+
+    stats.allocations  = allocations;
+    stats.reuses       = reuses;
+    stats.cached_bytes = cached_bytes;
+
+    return stats;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "uvgrtp/util.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace uvgrtp {
+
+    namespace frame {
+        struct rtp_frame;
+    }
+
+    struct pool_buffer;
+
+    /* Process-wide allocator of the rtp_frame structs and payloads behind frame::alloc_rtp_frame()
+     * and frame::dealloc_frame().
+     *
+     * Released frames and payloads are kept for reuse, first in a small cache of the releasing thread
+     * and then in a cache shared by all threads, as long as the cached memory stays within the budget
+     * set with frame::set_pool_budget(). Payload sizes are rounded up to a power of two and payloads
+     * larger than the largest size class are allocated and freed as is */
+    namespace frame_pool {
+
+        /* Return nullptr if memory allocation fails */
+        uvgrtp::frame::rtp_frame *alloc_frame();
+        void free_frame(uvgrtp::frame::rtp_frame *frame);
+
+        /* Allocate a payload of "size" bytes. "buffer" is set to the pooled buffer of the payload,
+         * or to nullptr if the payload is too large to be pooled, and must be stored to the
+         * "buffer" field of the frame that gets the payload
+         *
+         * Return the payload on success
+         * Return nullptr if memory allocation fails */
+        uint8_t *alloc_payload(size_t size, uvgrtp::pool_buffer *& buffer);
+
+        /* Return a payload buffer allocated by alloc_payload() to the pool. Called by
+         * release_buffer() when the last reference to the buffer is dropped */
+        void free_payload(uvgrtp::pool_buffer *buffer);
+    }
+}
+
+namespace uvg_rtp = uvgrtp;
@@ -24,12 +24,21 @@
 #include <cstring>
 #endif
 
+static_assert(sizeof(uvgrtp::formats::h264_headers) <= MAX_MEDIA_HEADERS_SIZE, "h264 headers don't fit in frame queue");
+static_assert(sizeof(uvgrtp::formats::h265_headers) <= MAX_MEDIA_HEADERS_SIZE, "h265 headers don't fit in frame queue");
+static_assert(sizeof(uvgrtp::formats::h266_headers) <= MAX_MEDIA_HEADERS_SIZE, "h266 headers don't fit in frame queue");
+static_assert(sizeof(uvgrtp::formats::v3c_headers)  <= MAX_MEDIA_HEADERS_SIZE, "v3c headers don't fit in frame queue");
 
 uvgrtp::frame_queue::frame_queue(std::shared_ptr<uvgrtp::socket> socket, std::shared_ptr<uvgrtp::rtp> rtp, int rce_flags):
     active_(nullptr),
+    transaction_(nullptr),
+    zerocopy_transactions_(),
+    free_transactions_(),
+    held_smart_(nullptr),
+    held_raw_(nullptr),
+    frame_held_(false),
+    held_zerocopy_(false),
     dealloc_hook_(nullptr),
-    max_mcount_(MAX_MSG_COUNT),
-    max_ccount_(MAX_CHUNK_COUNT* max_mcount_),
     rtp_(rtp), 
     socket_(socket),
     rce_flags_(rce_flags),
@@ -45,6 +54,20 @@ uvgrtp::frame_queue::~frame_queue()
     {
         (void)deinit_transaction();
     }
+
+    release_frame();
+    reap_zerocopy_transactions();
+
+    /* the kernel may still read the packets of these transactions, the socket keeps them until it is done */
+    for (auto& transaction : zerocopy_transactions_)
+    {
+        uint32_t zerocopy_id = transaction->zerocopy_id;
+        std::shared_ptr<transaction_t> retained(std::move(transaction));
+
+        socket_->retain_zerocopy(zerocopy_id, [retained]() {
+            release_transaction_data(retained.get());
+        });
+    }
 }
 
 rtp_error_t uvgrtp::frame_queue::init_transaction(bool use_old_rtp_ts)
@@ -54,50 +77,31 @@ rtp_error_t uvgrtp::frame_queue::init_transaction(bool use_old_rtp_ts)
         (void)deinit_transaction();
     }
 
-    active_      = new transaction_t;
-
-#ifndef _WIN32
-    active_->headers     = new struct mmsghdr[max_mcount_];
-    active_->chunks      = new struct iovec[max_ccount_];
-#else
-    active_->headers     = nullptr;
-    active_->chunks      = nullptr;
-#endif
-    active_->rtp_headers = new uvgrtp::frame::rtp_header[max_mcount_];
-
-    switch (rtp_->get_payload()) {
-        case RTP_FORMAT_H264:
-            active_->media_headers = new uvgrtp::formats::h264_headers;
-            break;
-
-        case RTP_FORMAT_H265:
-            active_->media_headers = new uvgrtp::formats::h265_headers;
-            break;
-
-        case RTP_FORMAT_H266:
-            active_->media_headers = new uvgrtp::formats::h266_headers;
-            break;
-
-        case RTP_FORMAT_ATLAS:
-            active_->media_headers = new uvgrtp::formats::v3c_headers;
-            break;
+    reap_zerocopy_transactions();
 
-        default:
-            break;
+    if (!transaction_)
+    {
+        if (!free_transactions_.empty())
+        {
+            transaction_ = std::move(free_transactions_.back());
+            free_transactions_.pop_back();
+        }
+        else
+        {
+            transaction_ = std::unique_ptr<transaction_t>(new transaction_t);
+        }
     }
 
-    active_->hdr_ptr     = 0;
+    active_ = transaction_.get();
+
     active_->rtphdr_ptr  = 0;
     active_->rtpauth_ptr = 0;
+    active_->media_hdr_ptr = 0;
 
     active_->data_raw     = nullptr;
     active_->data_smart   = nullptr;
-    active_->dealloc_hook = dealloc_hook_;
-
-    if (rce_flags_ & RCE_SRTP_AUTHENTICATE_RTP)
-        active_->rtp_auth_tags = new uint8_t[10 * max_mcount_];
-    else
-        active_->rtp_auth_tags = nullptr;
+    active_->dealloc_hook = nullptr;
+    active_->zerocopy     = false;
 
     rtp_->fill_header((uint8_t *)&active_->rtp_common, use_old_rtp_ts);
     active_->buffers.clear();
@@ -144,50 +148,118 @@ rtp_error_t uvgrtp::frame_queue::deinit_transaction()
         return RTP_INVALID_VALUE;
     }
 
-    if (active_->headers)
-        delete[] active_->headers;
+    /* Keep the packet buffers for the next transaction. Moving a buf_vec keeps its memory */
+    for (auto& packet : active_->packets) {
+        active_->spare_packets.push_back(std::move(packet));
+    }
+    active_->packets.clear();
+    active_->buffers.clear();
+
+    if (active_->zerocopy)
+    {
+        /* the kernel may still read the headers and the payload, a new transaction is taken for the next frame */
+        zerocopy_transactions_.push_back(std::move(transaction_));
+    }
+    else
+    {
+        release_transaction_data(active_);
+    }
+
+    active_ = nullptr;
+
+    return RTP_OK;
+}
+
+void uvgrtp::frame_queue::release_transaction_data(transaction_t *transaction)
+{
+    if (transaction->dealloc_hook && transaction->data_raw)
+        transaction->dealloc_hook(transaction->data_raw);
+
+    transaction->data_smart   = nullptr;
+    transaction->data_raw     = nullptr;
+    transaction->dealloc_hook = nullptr;
+}
+
+void uvgrtp::frame_queue::reap_zerocopy_transactions()
+{
+    if (zerocopy_transactions_.empty())
+        return;
+
+    uint32_t completed = socket_->get_zerocopy_completed();
+
+    /* the ids wrap around */
+    while (!zerocopy_transactions_.empty() &&
+           (int32_t)(completed - zerocopy_transactions_.front()->zerocopy_id) >= 0)
+    {
+        std::unique_ptr<transaction_t> transaction = std::move(zerocopy_transactions_.front());
+        zerocopy_transactions_.pop_front();
+
+        release_transaction_data(transaction.get());
+        transaction->zerocopy = false;
+        free_transactions_.push_back(std::move(transaction));
+    }
+}
+
+void uvgrtp::frame_queue::hold_frame(std::unique_ptr<uint8_t[]> data)
+{
+    release_frame();
+
+    held_smart_  = std::move(data);
+    frame_held_  = true;
+}
 
-    if (active_->chunks)
-        delete[] active_->chunks;
+void uvgrtp::frame_queue::hold_frame(uint8_t *data)
+{
+    release_frame();
 
-    if (active_->rtp_headers)
-        delete[] active_->rtp_headers;
+    /* without a deallocation hook, the application may reuse the memory as soon as push_frame() returns */
+    if (!dealloc_hook_)
+        return;
 
-    if (active_->rtp_auth_tags)
-        delete[] active_->rtp_auth_tags;
+    held_raw_   = data;
+    frame_held_ = true;
+}
 
-    active_->headers = nullptr;
-    active_->chunks = nullptr;
-    active_->rtp_headers = nullptr;
-    active_->rtp_auth_tags = nullptr;
+void uvgrtp::frame_queue::release_frame()
+{
+    if (!frame_held_)
+        return;
 
-    if (active_->media_headers)
+    /* Sends complete in order so if the last zero-copy transaction of the frame has not been reaped yet,
+     * it is the newest one. It releases the frame once the kernel is done with the whole frame */
+    if (held_zerocopy_ && !zerocopy_transactions_.empty())
     {
-        switch (rtp_->get_payload()) {
-        case RTP_FORMAT_H264:
-            delete (uvgrtp::formats::h264_headers*)active_->media_headers;
-            active_->media_headers = nullptr;
-            break;
-
-        case RTP_FORMAT_H265:
-            delete (uvgrtp::formats::h265_headers*)active_->media_headers;
-            active_->media_headers = nullptr;
-            break;
-
-        case RTP_FORMAT_H266:
-            delete (uvgrtp::formats::h266_headers*)active_->media_headers;
-            active_->media_headers = nullptr;
-            break;
-
-        default:
-            break;
+        transaction_t *last = zerocopy_transactions_.back().get();
+
+        last->data_smart = std::move(held_smart_);
+        if (held_raw_)
+        {
+            last->data_raw     = held_raw_;
+            last->dealloc_hook = dealloc_hook_;
         }
     }
+    else
+    {
+        held_smart_ = nullptr;
+        if (held_raw_ && dealloc_hook_)
+            dealloc_hook_(held_raw_);
+    }
 
-    delete active_;
-    active_ = nullptr;
+    held_raw_      = nullptr;
+    frame_held_    = false;
+    held_zerocopy_ = false;
+}
 
-    return RTP_OK;
+uvgrtp::buf_vec uvgrtp::frame_queue::get_packet_buffer()
+{
+    if (active_->spare_packets.empty())
+        return uvgrtp::buf_vec();
+
+    uvgrtp::buf_vec packet = std::move(active_->spare_packets.back());
+    active_->spare_packets.pop_back();
+    packet.clear();
+
+    return packet;
 }
 
 rtp_error_t uvgrtp::frame_queue::enqueue_message(uint8_t *message, size_t message_len, bool set_m_bit)
@@ -200,19 +272,18 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(uint8_t *message, size_t messag
 
     /* Create buffer vector where the full packet is constructed
      * and which is then pushed to "active_"'s pkt_vec structure */
-    uvgrtp::buf_vec tmp;
+    uvgrtp::buf_vec tmp = get_packet_buffer();
 
     /* update the RTP header at "rtpheaders_ptr_" */
     update_rtp_header();
 
+    uvgrtp::frame::rtp_header *header = active_->rtp_headers.at(active_->rtphdr_ptr++);
+
     if (set_m_bit)
-        ((uint8_t *)&active_->rtp_headers[active_->rtphdr_ptr])[1] |= (1 << 7);
+        ((uint8_t *)header)[1] |= (1 << 7);
 
     /* Push RTP header first and then push all payload buffers */
-    tmp.push_back({
-        sizeof(active_->rtp_headers[active_->rtphdr_ptr]),
-        (uint8_t *)&active_->rtp_headers[active_->rtphdr_ptr++]
-    });
+    tmp.push_back({ sizeof(*header), (uint8_t *)header });
 
     tmp.push_back({ message_len, message });
 
@@ -238,11 +309,11 @@ rtp_error_t uvgrtp::frame_queue::enqueue_message(buf_vec& buffers)
 
     /* Create buffer vector where the full packet is constructed
      * and which is then pushed to "active_"'s pkt_vec structure */
-    uvgrtp::buf_vec tmp;
+    uvgrtp::buf_vec tmp = get_packet_buffer();
 
     /* Push RTP header first and then push all payload buffers */
-    tmp.push_back({     sizeof(active_->rtp_headers[active_->rtphdr_ptr]), 
-                   (uint8_t *)&active_->rtp_headers[active_->rtphdr_ptr++]});
+    uvgrtp::frame::rtp_header *header = active_->rtp_headers.at(active_->rtphdr_ptr++);
+    tmp.push_back({ sizeof(*header), (uint8_t *)header });
 
     /* If SRTP with proper encryption is used and there are more than one buffer,
      * frame queue must be a copy of the input and ... */
@@ -285,10 +356,16 @@ rtp_error_t uvgrtp::frame_queue::flush_queue(sockaddr_in& addr, sockaddr_in6& ad
 
     /* set the marker bit of the last packet to 1 */
     if (active_->packets.size() > 1)
-        ((uint8_t *)&active_->rtp_headers[active_->rtphdr_ptr - 1])[1] |= (1 << 7);
+        ((uint8_t *)active_->rtp_headers.at(active_->rtphdr_ptr - 1))[1] |= (1 << 7);
     
     std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
 
+    bool zerocopy = frame_held_ && (rce_flags_ & RCE_UDP_ZEROCOPY) && socket_->zerocopy_enabled();
+
+    /* with SO_TXTIME the kernel holds the packets until it is time to send them */
+    bool txtime = (rce_flags_ & RCE_PACE_TXTIME) && socket_->txtime_enabled() && !zerocopy;
+    std::chrono::nanoseconds send_delay(0);
+
     if ((rce_flags_ & RCE_FRAME_RATE) && fps_)
     {
         std::chrono::nanoseconds wait_time = this_frame_time() - now;
@@ -315,8 +392,19 @@ rtp_error_t uvgrtp::frame_queue::flush_queue(sockaddr_in& addr, sockaddr_in6& ad
         }
         else
         {
+            if (txtime)
+            {
+                // only sleep if the frame is so early that the kernel could drop it
+                std::chrono::nanoseconds max_lead = std::chrono::milliseconds(TXTIME_MAX_LEAD_MS);
+                if (wait_time > max_lead)
+                {
+                    std::this_thread::sleep_for(wait_time - max_lead);
+                    wait_time = max_lead;
+                }
+                send_delay = wait_time;
+            }
             // we cap the sleep/latency at frame interval
-            if (wait_time > frame_interval_)
+            else if (wait_time > frame_interval_)
             {
                 UVG_LOG_DEBUG("Limiting fps wait times to frame interval");
                 std::this_thread::sleep_for(frame_interval_);
@@ -339,21 +427,59 @@ rtp_error_t uvgrtp::frame_queue::flush_queue(sockaddr_in& addr, sockaddr_in6& ad
         // allocate 80% of frame interval for pacing, rest for other processing
         std::chrono::nanoseconds packet_interval = 8*frame_interval_/(10*active_->packets.size());
 
-        for (size_t i = 0; i < active_->packets.size(); ++i)
+        if (txtime)
         {
-            std::chrono::high_resolution_clock::time_point next_packet = now + i * packet_interval;
-
-            // sleep until next packet time
-            std::this_thread::sleep_for(next_packet - std::chrono::high_resolution_clock::now());
+            // the whole frame is handed to the kernel at once, each packet with its own launch time
+            uint64_t launch_time = uvgrtp::socket::get_txtime_now() + send_delay.count();
 
-            //  send pkt vects
-            if (socket_->sendto(ssrc, addr, addr6, active_->packets[i], 0) != RTP_OK) {
-                UVG_LOG_ERROR("Failed to send packet: %li", errno);
+            if (socket_->sendto_txtime(ssrc, addr, addr6, active_->packets, launch_time, packet_interval.count()) != RTP_OK) {
+                UVG_LOG_ERROR("Failed to flush the message queue: %li", errno);
                 (void)deinit_transaction();
                 return RTP_SEND_ERROR;
             }
         }
+        else
+        {
+            for (size_t i = 0; i < active_->packets.size(); ++i)
+            {
+                std::chrono::high_resolution_clock::time_point next_packet = now + i * packet_interval;
+
+                // sleep until next packet time
+                std::this_thread::sleep_for(next_packet - std::chrono::high_resolution_clock::now());
 
+                //  send pkt vects
+                if (socket_->sendto(ssrc, addr, addr6, active_->packets[i], 0) != RTP_OK) {
+                    UVG_LOG_ERROR("Failed to send packet: %li", errno);
+                    (void)deinit_transaction();
+                    return RTP_SEND_ERROR;
+                }
+            }
+        }
+    }
+    else if (zerocopy)
+    {
+        uint32_t zerocopy_id = 0;
+        rtp_error_t ret = socket_->sendto_zerocopy(ssrc, addr, addr6, active_->packets, zerocopy_id);
+
+        active_->zerocopy    = true;
+        active_->zerocopy_id = zerocopy_id;
+        held_zerocopy_       = true;
+
+        if (ret != RTP_OK) {
+            UVG_LOG_ERROR("Failed to flush the message queue: %li", errno);
+            (void)deinit_transaction();
+            return RTP_SEND_ERROR;
+        }
+    }
+    else if (txtime && send_delay.count() > 0)
+    {
+        uint64_t launch_time = uvgrtp::socket::get_txtime_now() + send_delay.count();
+
+        if (socket_->sendto_txtime(ssrc, addr, addr6, active_->packets, launch_time, 0) != RTP_OK) {
+            UVG_LOG_ERROR("Failed to flush the message queue: %li", errno);
+            (void)deinit_transaction();
+            return RTP_SEND_ERROR;
+        }
     }
     else if (socket_->sendto(ssrc, addr, addr6, active_->packets, 0) != RTP_OK) {
         UVG_LOG_ERROR("Failed to flush the message queue: %li", errno);
@@ -373,8 +499,10 @@ inline std::chrono::high_resolution_clock::time_point uvgrtp::frame_queue::this_
 
 void uvgrtp::frame_queue::update_rtp_header()
 {
-    memcpy(&active_->rtp_headers[active_->rtphdr_ptr], &active_->rtp_common, sizeof(active_->rtp_common));
-    rtp_->update_sequence((uint8_t *)(&active_->rtp_headers[active_->rtphdr_ptr]));
+    uvgrtp::frame::rtp_header *header = active_->rtp_headers.at(active_->rtphdr_ptr);
+
+    memcpy(header, &active_->rtp_common, sizeof(active_->rtp_common));
+    rtp_->update_sequence((uint8_t *)header);
 }
 
 uvgrtp::buf_vec* uvgrtp::frame_queue::get_buffer_vector()
@@ -390,7 +518,15 @@ uvgrtp::buf_vec* uvgrtp::frame_queue::get_buffer_vector()
 
 void *uvgrtp::frame_queue::get_media_headers()
 {
-    return active_->media_headers;
+    return active_->media_headers.at(active_->media_hdr_ptr)->data;
+}
+
+void uvgrtp::frame_queue::next_media_unit()
+{
+    if (!active_->packets.empty())
+        ++active_->media_hdr_ptr;
+
+    active_->buffers.clear();
 }
 
 uint8_t *uvgrtp::frame_queue::get_active_dataptr()
@@ -416,11 +552,11 @@ void uvgrtp::frame_queue::enqueue_finalize(uvgrtp::buf_vec& tmp)
     if (rce_flags_ & RCE_SRTP_AUTHENTICATE_RTP) {
         tmp.push_back({
             UVG_AUTH_TAG_LENGTH,
-            (uint8_t*)&active_->rtp_auth_tags[10 * active_->rtpauth_ptr++]
+            active_->rtp_auth_tags.at(active_->rtpauth_ptr++)->data
             });
     }
 
-    active_->packets.push_back(tmp);
+    active_->packets.push_back(std::move(tmp));
     rtp_->inc_sequence();
     rtp_->inc_sent_pkts();
 }
@@ -4,8 +4,10 @@
 #include "uvgrtp/util.hh"
 
 #include "socket.hh"
+#include "srtp/base.hh"
 
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -19,13 +21,47 @@
 #endif
 
 // TODO: get these from socket?
-const int MAX_MSG_COUNT   = 5000;
 const int MAX_QUEUED_MSGS =  10;
-const int MAX_CHUNK_COUNT =   4;
+
+/* With RCE_PACE_TXTIME, how far ahead of time a frame can be handed to the kernel before push_frame() sleeps.
+ * The fq qdisc drops packets whose launch time is beyond its horizon (10 s by default) */
+const int TXTIME_MAX_LEAD_MS = 500;
+
+/* Number of packets whose RTP headers and authentication tags fit in one storage block */
+const size_t PACKET_STORAGE_BLOCK_SIZE = 256;
+
+/* Space reserved for the media-specific headers of one NAL unit, see src/formats/h265.hh for example */
+const size_t MAX_MEDIA_HEADERS_SIZE = 16;
 
 namespace uvgrtp {
     class rtp;
 
+    /* Growable storage for per-packet data of a transaction. Memory is allocated in blocks
+     * so that pointers to earlier elements stay valid while the storage grows. The blocks are
+     * kept when the transaction is released so later transactions don't allocate anything */
+    template <typename T>
+    class packet_storage {
+        public:
+            T *at(size_t index)
+            {
+                while (index >= blocks_.size() * PACKET_STORAGE_BLOCK_SIZE) {
+                    blocks_.emplace_back(new T[PACKET_STORAGE_BLOCK_SIZE]);
+                }
+                return &blocks_[index / PACKET_STORAGE_BLOCK_SIZE][index % PACKET_STORAGE_BLOCK_SIZE];
+            }
+
+        private:
+            std::vector<std::unique_ptr<T[]>> blocks_;
+    };
+
+    struct rtp_auth_tag {
+        uint8_t data[UVG_AUTH_TAG_LENGTH];
+    };
+
+    struct media_headers_t {
+        uint8_t data[MAX_MEDIA_HEADERS_SIZE];
+    };
+
     typedef struct transaction {
 
         /* To provide true scatter/gather I/O, each transaction has a buf_vec
@@ -39,43 +75,41 @@ namespace uvgrtp {
          * each buf_vec structure is pushed to pkt_vec */
         uvgrtp::pkt_vec packets;
 
+        /* buf_vecs of earlier transactions, reused so that building packets doesn't allocate */
+        uvgrtp::pkt_vec spare_packets;
+
         /* All packets of a transaction share the common RTP header only differing in sequence number.
          * Keeping a separate common RTP header and then just copying this is cleaner than initializing
          * RTP header for each packet */
         uvgrtp::frame::rtp_header rtp_common;
-        uvgrtp::frame::rtp_header *rtp_headers = nullptr;
+        uvgrtp::packet_storage<uvgrtp::frame::rtp_header> rtp_headers;
 
-#ifndef _WIN32
-        struct mmsghdr *headers = nullptr;
-        struct iovec   *chunks = nullptr;
-#else
-        char *headers = nullptr;
-        char *chunks = nullptr;
-#endif
-
-        /* Media may need space for additional buffers,
-         * this pointer is initialized with uvgrtp::MEDIA_TYPE::media_headers
-         * when the transaction is initialized for the first time
-         *
-         * See src/formats/hevc.hh for example */
-        void *media_headers = nullptr;
+        /* Media may need space for additional buffers (f.ex. uvgrtp::formats::h265_headers).
+         * A transaction that carries several NAL units needs a separate set for each of them
+         * because the queued packets point to these headers until the transaction is flushed */
+        uvgrtp::packet_storage<uvgrtp::media_headers_t> media_headers;
 
-        /* Pointer to RTP authentication (if enabled) */
-        uint8_t *rtp_auth_tags = nullptr;
+        /* RTP authentication tags (if enabled) */
+        uvgrtp::packet_storage<uvgrtp::rtp_auth_tag> rtp_auth_tags;
 
-        size_t hdr_ptr = 0;
         size_t rtphdr_ptr = 0;
         size_t rtpauth_ptr = 0;
+        size_t media_hdr_ptr = 0;
 
         /* The flag "RTP_COPY" means that uvgRTP has a made a copy of the original chunk 
          * and it can be safely freed */
         std::unique_ptr<uint8_t[]> data_smart;
         uint8_t *data_raw = nullptr;
 
-        /* If the application code provided us a deallocation hook, this points to it.
-         * When SCD finishes processing a transaction, it will call this hook with "data_raw" pointer */
+        /* If the transaction owns a frame given as a raw pointer, this points to the deallocation hook
+         * of the application. The hook is called with "data_raw" when the transaction is released */
         void (*dealloc_hook)(void *) = nullptr;
 
+        /* The packets were sent with MSG_ZEROCOPY (RCE_UDP_ZEROCOPY). The transaction and the memory
+         * its packets point to must be kept until the socket has completed "zerocopy_id" */
+        bool zerocopy = false;
+        uint32_t zerocopy_id = 0;
+
     } transaction_t;
 
     class frame_queue {
@@ -87,7 +121,7 @@ namespace uvgrtp {
             rtp_error_t init_transaction(uint8_t *data, bool old_rtp_ts = false);
             rtp_error_t init_transaction(std::unique_ptr<uint8_t[]> data, bool old_rtp_ts = false);
 
-            /* Releases all memory associated with transaction
+            /* Releases the active transaction. Its memory is kept for the next transaction
              *
              * Return RTP_OK on success
              * Return RTP_INVALID_VALUE if "key" doesn't point to valid transaction */
@@ -122,13 +156,18 @@ namespace uvgrtp {
              * buf_vec is the place to store these extra headers (see src/formats/hevc.cc) */
             uvgrtp::buf_vec* get_buffer_vector();
 
-            /* Each media may allocate extra buffers for the transaction struct if need be
-             *
+            /* Each media may use extra buffers of the transaction for its headers.
+             * The returned space is MAX_MEDIA_HEADERS_SIZE bytes and belongs to the current NAL unit
              *
-             * Return pointer to media headers if they're set
-             * Return nullptr if they're not set */
+             * Return pointer to media headers of the active transaction */
             void *get_media_headers();
 
+            /* Start a new NAL unit within the active transaction so that several NAL units
+             * can be sent with a single flush. The buffer vector is emptied and, if packets have
+             * already been queued, a new set of media headers is taken into use so that the
+             * headers of the earlier packets stay intact */
+            void next_media_unit();
+
             /* Update the active task's current packet's sequence number */
             void update_rtp_header();
 
@@ -152,6 +191,17 @@ namespace uvgrtp {
              * significant memory leaks */
             void install_dealloc_hook(void (*dealloc_hook)(void *));
 
+            /* With RCE_UDP_ZEROCOPY, only frames whose memory uvgRTP may keep until the kernel
+             * has sent them are sent without copying. hold_frame() hands the frame over before it
+             * is pushed. Frames given as raw pointers are only held if a deallocation hook has been
+             * installed.
+             *
+             * release_frame() must be called once the frame has been pushed. The frame is released
+             * right away or, if it was sent with zero-copy, once the kernel no longer needs it */
+            void hold_frame(std::unique_ptr<uint8_t[]> data);
+            void hold_frame(uint8_t *data);
+            void release_frame();
+
             void set_fps(ssize_t numerator, ssize_t denominator)
             {
                 fps_ = numerator > 0 && denominator > 0;
@@ -167,18 +217,38 @@ namespace uvgrtp {
 
             void enqueue_finalize(uvgrtp::buf_vec& tmp);
 
+            /* Get an empty buf_vec for a new packet, reusing the memory of earlier packets if possible */
+            uvgrtp::buf_vec get_packet_buffer();
+
+            /* Free the frame memory owned by a transaction */
+            static void release_transaction_data(transaction_t *transaction);
+
+            /* Recycle the zero-copy transactions the kernel has completed */
+            void reap_zerocopy_transactions();
+
             inline std::chrono::high_resolution_clock::time_point this_frame_time();
 
             inline void update_sync_point();
 
             transaction_t *active_;
 
+            /* The transaction and its memory are recycled for every frame */
+            std::unique_ptr<transaction_t> transaction_;
+
+            /* Transactions sent with MSG_ZEROCOPY that the kernel may still read, oldest first.
+             * Completed transactions are moved to "free_transactions_" for reuse */
+            std::deque<std::unique_ptr<transaction_t>> zerocopy_transactions_;
+            std::vector<std::unique_ptr<transaction_t>> free_transactions_;
+
+            /* The frame that is being pushed if it was handed over with hold_frame() */
+            std::unique_ptr<uint8_t[]> held_smart_;
+            uint8_t *held_raw_;
+            bool frame_held_;
+            bool held_zerocopy_;
+
             /* Deallocation hook is stored here and copied to transaction upon initialization */
             void (*dealloc_hook_)(void *);
 
-            ssize_t max_mcount_; /* number of messages per transactions */
-            ssize_t max_ccount_; /* number of chunks per message */
-
             std::shared_ptr<uvgrtp::rtp> rtp_;
             std::shared_ptr<uvgrtp::socket> socket_;
 
@@ -20,5 +20,11 @@ namespace uvgrtp {
     constexpr uint16_t MAX_IPV6_MEDIA_PAYLOAD = MAX_IPV6_PAYLOAD - RTP_HDR_SIZE;
 
     constexpr int PKT_MAX_DELAY_MS = 500;
+
+    // upper limit for RCC_RECV_BATCH_SIZE, same as the send side system call clustering
+    constexpr int MAX_RECV_BATCH_SIZE = 1024;
+
+    // upper limit for RCC_SCL_THREADS
+    constexpr int MAX_SCL_THREADS = 64;
 }
 
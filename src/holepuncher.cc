@@ -3,17 +3,22 @@
 #include "uvgrtp/clock.hh"
 
 #include "socket.hh"
+#include "reactor.hh"
 #include "debug.hh"
 
 
 #define THRESHOLD 2000
+#define CHECK_INTERVAL 500
 
 uvgrtp::holepuncher::holepuncher(std::shared_ptr<uvgrtp::socket> socket):
     socket_(socket),
     last_dgram_sent_(0),
     remote_sockaddr_({}),
     remote_sockaddr_ip6_({}),
-    active_(false)
+    active_(false),
+    runner_(nullptr),
+    reactor_(nullptr),
+    timer_(0)
 {}
 
 uvgrtp::holepuncher::~holepuncher()
@@ -21,9 +26,23 @@ uvgrtp::holepuncher::~holepuncher()
     stop();
 }
 
-rtp_error_t uvgrtp::holepuncher::start()
+rtp_error_t uvgrtp::holepuncher::start(std::shared_ptr<uvgrtp::reactor> reactor)
 {
     active_ = true;
+
+    if (reactor) {
+        timer_ = reactor->add_timer(CHECK_INTERVAL, [this]() {
+            send_keepalive();
+            return CHECK_INTERVAL;
+        }, weak_from_this());
+
+        if (timer_ != 0) {
+            reactor_ = reactor;
+            return RTP_OK;
+        }
+        UVG_LOG_WARN("Failed to add the holepuncher to the reactor, using a thread of its own");
+    }
+
     runner_ = std::unique_ptr<std::thread> (new std::thread(&uvgrtp::holepuncher::keepalive, this));
     return RTP_OK;
 }
@@ -31,6 +50,11 @@ rtp_error_t uvgrtp::holepuncher::start()
 rtp_error_t uvgrtp::holepuncher::stop()
 {
     active_ = false;
+    if (reactor_) {
+        reactor_->remove_timer(timer_);
+        reactor_ = nullptr;
+    }
+
     if (runner_ && runner_->joinable())
     {
         runner_->join();
@@ -61,15 +85,19 @@ void uvgrtp::holepuncher::keepalive()
      * Another method (section 4.3) is multiplexing RTCP and RTP packets into a single socket, which keeps the connection
      * alive at all times with RTCP packets. This will be implemented into uvgRTP in the future. */
     while (active_) {
-        if (uvgrtp::clock::ntp::diff_now(last_dgram_sent_) < THRESHOLD) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            continue;
-        }
-
-        UVG_LOG_DEBUG("Sending keep-alive");
-        uint8_t payload = 0b11000000;
-        socket_->sendto(remote_sockaddr_, remote_sockaddr_ip6_, &payload, 1, 0);
-        last_dgram_sent_ = uvgrtp::clock::ntp::now();
+        send_keepalive();
+        std::this_thread::sleep_for(std::chrono::milliseconds(CHECK_INTERVAL));
     }
     UVG_LOG_DEBUG("Stopping holepuncher");
 }
+
+void uvgrtp::holepuncher::send_keepalive()
+{
+    if (uvgrtp::clock::ntp::diff_now(last_dgram_sent_) < THRESHOLD)
+        return;
+
+    UVG_LOG_DEBUG("Sending keep-alive");
+    uint8_t payload = 0b11000000;
+    socket_->sendto(remote_sockaddr_, remote_sockaddr_ip6_, &payload, 1, 0);
+    last_dgram_sent_ = uvgrtp::clock::ntp::now();
+}
@@ -15,17 +15,19 @@
 namespace uvgrtp {
 
     class socket;
+    class reactor;
 
-    class holepuncher {
+    class holepuncher : public std::enable_shared_from_this<holepuncher> {
         public:
             holepuncher(std::shared_ptr<uvgrtp::socket> socket);
             ~holepuncher();
 
-            /* Create new thread object and start the holepuncher
+            /* Start the holepuncher. If "reactor" is given, keep-alives are sent from a timer
+             * of the reactor, otherwise a new thread is created for them
              *
              * Return RTP_OK on success
              * Return RTP_MEMORY_ERROR if allocation fails */
-            rtp_error_t start();
+            rtp_error_t start(std::shared_ptr<uvgrtp::reactor> reactor = nullptr);
 
             /* Stop the holepuncher */
             rtp_error_t stop();
@@ -38,6 +40,9 @@ namespace uvgrtp {
         private:
             void keepalive();
 
+            /* Send a keep-alive if nothing has been sent for a while */
+            void send_keepalive();
+
             std::shared_ptr<uvgrtp::socket> socket_;
             std::atomic<uint64_t> last_dgram_sent_;
             sockaddr_in remote_sockaddr_;
@@ -45,6 +50,9 @@ namespace uvgrtp {
 
             bool active_;
             std::unique_ptr<std::thread> runner_;
+
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+            uint64_t timer_;
     };
 }
 
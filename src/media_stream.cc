@@ -15,6 +15,7 @@
 
 #include "holepuncher.hh"
 #include "reception_flow.hh"
+#include "reactor.hh"
 #include "srtp/srtcp.hh"
 #include "srtp/srtp.hh"
 #include "formats/media.hh"
@@ -55,6 +56,7 @@ uvgrtp::media_stream::media_stream(std::string cname, std::string remote_addr,
     rce_flags_(rce_flags),
     initialized_(false),
     reception_flow_(nullptr),
+    reactor_(nullptr),
     media_(nullptr),
     holepuncher_(nullptr),
     cname_(cname),
@@ -122,7 +124,7 @@ rtp_error_t uvgrtp::media_stream::init_connection()
 
     /* If the given local address is not a multicast address, get the socket */
     if (!multicast) {
-        socket_ = sfp_->get_socket_ptr(2, src_port_);
+        socket_ = sfp_->get_socket_ptr(2, src_port_, rce_flags_);
         if (!socket_) {
             UVG_LOG_DEBUG("No socket found");
             return RTP_GENERIC_ERROR;
@@ -140,7 +142,7 @@ rtp_error_t uvgrtp::media_stream::init_connection()
         else {
             remote_sockaddr_ = uvgrtp::socket::create_sockaddr(AF_INET, remote_address_, dst_port_);
         }
-        holepuncher_ = std::unique_ptr<uvgrtp::holepuncher>(new uvgrtp::holepuncher(socket_));
+        holepuncher_ = std::shared_ptr<uvgrtp::holepuncher>(new uvgrtp::holepuncher(socket_));
         holepuncher_->set_remote_address(remote_sockaddr_, remote_sockaddr_ip6_);
     }
     if (rce_flags_ & RCE_RECEIVE_ONLY) {
@@ -177,6 +179,43 @@ rtp_error_t uvgrtp::media_stream::init_connection()
         return ret;
     }
 
+    /* GSO is only an optimization, packets are sent normally if it is not available */
+    if ((rce_flags_ & RCE_UDP_GSO) && socket_->enable_gso() != RTP_OK)
+    {
+        UVG_LOG_WARN("RCE_UDP_GSO could not be enabled, sending packets without GSO");
+    }
+
+    if (rce_flags_ & RCE_UDP_ZEROCOPY)
+    {
+        if (rce_flags_ & RCE_SRTP)
+        {
+            UVG_LOG_WARN("RCE_UDP_ZEROCOPY cannot be used with SRTP, sending packets normally");
+        }
+        else if (socket_->enable_zerocopy() != RTP_OK)
+        {
+            UVG_LOG_WARN("RCE_UDP_ZEROCOPY could not be enabled, sending packets normally");
+        }
+    }
+
+    if (rce_flags_ & RCE_SYSTEM_CALL_CLUSTERING)
+    {
+        socket_->enable_system_call_clustering();
+    }
+
+    if ((rce_flags_ & RCE_IO_URING) && socket_->enable_io_uring() != RTP_OK)
+    {
+        UVG_LOG_WARN("RCE_IO_URING could not be enabled, sending packets with sendmmsg()");
+    }
+
+    /* the socket may be shared with streams whose packets are paced by the kernel,
+     * so the media of this stream is told to sleep instead */
+    if ((rce_flags_ & RCE_PACE_TXTIME) &&
+        (remote_address_ == "" || socket_->enable_txtime(remote_sockaddr_, remote_sockaddr_ip6_) != RTP_OK))
+    {
+        UVG_LOG_WARN("RCE_PACE_TXTIME could not be enabled, pacing packets by sleeping");
+        rce_flags_ &= ~RCE_PACE_TXTIME;
+    }
+
     return ret;
 }
 
@@ -477,8 +516,14 @@ rtp_error_t uvgrtp::media_stream::start_components()
     if (create_media(fmt_) != RTP_OK)
         return free_resources(RTP_MEMORY_ERROR);
 
+    std::shared_ptr<uvgrtp::reactor> reactor = nullptr;
+    if (rce_flags_ & RCE_REACTOR) {
+        reactor = sfp_->get_reactor();
+        reactor_ = reactor;
+    }
+
     if (rce_flags_ & RCE_HOLEPUNCH_KEEPALIVE) {
-        holepuncher_->start();
+        holepuncher_->start(reactor);
     }
 
     if (rce_flags_ & RCE_RTCP) {
@@ -520,7 +565,7 @@ rtp_error_t uvgrtp::media_stream::start_components()
                 rtcp_reader->map_ssrc_to_rtcp(remote_ssrc_, rtcp_);
                 rtcp_reader->set_socket(rtcp_socket);
             }
-            rtcp_->start();
+            rtcp_->start(reactor);
         }
     }
 
@@ -534,7 +579,7 @@ rtp_error_t uvgrtp::media_stream::start_components()
     }
 
     initialized_ = true;
-    return reception_flow_->start(socket_, rce_flags_);
+    return reception_flow_->start(socket_, rce_flags_, reactor);
 }
 
 rtp_error_t uvgrtp::media_stream::push_frame(uint8_t *data, size_t data_len, int rtp_flags)
@@ -575,6 +620,48 @@ rtp_error_t uvgrtp::media_stream::push_frame(std::unique_ptr<uint8_t[]> data, si
     return ret;
 }
 
+rtp_error_t uvgrtp::media_stream::push_frame(const uvgrtp::frame::nal_unit *nals, size_t count, int rtp_flags)
+{
+    rtp_error_t ret = check_push_preconditions(rtp_flags, false);
+    if (ret == RTP_OK)
+    {
+        if (rtp_flags & RTP_COPY)
+        {
+            UVG_LOG_ERROR("NAL units given as a list are sent without copying");
+            return RTP_INVALID_VALUE;
+        }
+
+        if (rce_flags_ & RCE_HOLEPUNCH_KEEPALIVE)
+            holepuncher_->notify();
+
+        ret = media_->push_nal_units(remote_sockaddr_, remote_sockaddr_ip6_, nals, count, rtp_flags, ssrc_.get()->load());
+    }
+
+    return ret;
+}
+
+rtp_error_t uvgrtp::media_stream::push_frame(const uvgrtp::frame::nal_unit *nals, size_t count, uint32_t ts, int rtp_flags)
+{
+    rtp_error_t ret = check_push_preconditions(rtp_flags, false);
+    if (ret == RTP_OK)
+    {
+        if (rtp_flags & RTP_COPY)
+        {
+            UVG_LOG_ERROR("NAL units given as a list are sent without copying");
+            return RTP_INVALID_VALUE;
+        }
+
+        if (rce_flags_ & RCE_HOLEPUNCH_KEEPALIVE)
+            holepuncher_->notify();
+
+        rtp_->set_timestamp(ts);
+        ret = media_->push_nal_units(remote_sockaddr_, remote_sockaddr_ip6_, nals, count, rtp_flags, ssrc_.get()->load());
+        rtp_->set_timestamp(INVALID_TS);
+    }
+
+    return ret;
+}
+
 rtp_error_t uvgrtp::media_stream::push_frame(uint8_t *data, size_t data_len, uint32_t ts, int rtp_flags)
 {
     rtp_error_t ret = check_push_preconditions(rtp_flags, false);
@@ -698,12 +785,7 @@ uvgrtp::frame::rtp_frame *uvgrtp::media_stream::pull_frame()
     if (!check_pull_preconditions()) {
         return nullptr;
     }
-    // If the remote_ssrc is set, only pull frames that come from this ssrc
-    if (remote_ssrc_.get()->load() != ssrc_.get()->load() + 1) {
-        return reception_flow_->pull_frame(remote_ssrc_);
-    }
-    return reception_flow_->pull_frame();
-
+    return reception_flow_->pull_frame(-1, remote_ssrc_);
 }
 
 uvgrtp::frame::rtp_frame *uvgrtp::media_stream::pull_frame(size_t timeout_ms)
@@ -711,12 +793,23 @@ uvgrtp::frame::rtp_frame *uvgrtp::media_stream::pull_frame(size_t timeout_ms)
     if (!check_pull_preconditions()) {
         return nullptr;
     }
-    // If the remote_ssrc is set, only pull frames that come from this ssrc
-    if (remote_ssrc_.get()->load() != ssrc_.get()->load() + 1) {
-        return reception_flow_->pull_frame(timeout_ms, remote_ssrc_);
+    return reception_flow_->pull_frame(timeout_ms, remote_ssrc_);
+}
+
+rtp_error_t uvgrtp::media_stream::pull_frames(std::vector<uvgrtp::frame::rtp_frame*>& frames, size_t max_frames, size_t timeout_ms)
+{
+    if (!check_pull_preconditions()) {
+        return RTP_NOT_INITIALIZED;
     }
-    return reception_flow_->pull_frame(timeout_ms);
 
+    if (max_frames == 0) {
+        return RTP_INVALID_VALUE;
+    }
+
+    if (reception_flow_->pull_frames(frames, max_frames, timeout_ms, remote_ssrc_) == 0) {
+        return RTP_TIMEOUT;
+    }
+    return RTP_OK;
 }
 
 bool uvgrtp::media_stream::check_pull_preconditions()
@@ -782,6 +875,21 @@ rtp_error_t uvgrtp::media_stream::install_receive_hook(void *arg, void (*hook)(v
     return reception_flow_->install_receive_hook(arg, hook, remote_ssrc_.get()->load());
 }
 
+rtp_error_t uvgrtp::media_stream::install_deallocation_hook(void (*deallocation_hook)(void *))
+{
+    if (!initialized_) {
+        UVG_LOG_ERROR("RTP context has not been initialized fully, cannot continue!");
+        return RTP_NOT_INITIALIZED;
+    }
+
+    if (!deallocation_hook) {
+        return RTP_INVALID_VALUE;
+    }
+
+    media_->install_dealloc_hook(deallocation_hook);
+    return RTP_OK;
+}
+
 rtp_error_t uvgrtp::media_stream::configure_ctx(int rcc_flag, ssize_t value)
 {
     rtp_error_t ret = RTP_OK;
@@ -791,6 +899,9 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int rcc_flag, ssize_t value)
             return RTP_INVALID_VALUE;
 
         *ssrc_ = (uint32_t)value;
+        if (socket_) {
+            socket_->update_handlers();
+        }
         return ret;
     }
     else if (rcc_flag == RCC_REMOTE_SSRC) {
@@ -832,6 +943,11 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int rcc_flag, ssize_t value)
             int buf_size = (int)value;
             rcv_buf_size_ = buf_size;
             ret = socket_->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, sizeof(int));
+
+            // with RCE_REUSEPORT_SHARDING the other sockets of the group receive packets as well
+            if (ret == RTP_OK && reception_flow_) {
+                reception_flow_->set_socket_rcv_buffer_size(buf_size);
+            }
             break;
         }
         case RCC_RING_BUFFER_SIZE: {
@@ -848,6 +964,74 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int rcc_flag, ssize_t value)
             rtp_->set_pkt_max_delay(value);
             break;
         }
+        case RCC_RECV_BATCH_SIZE: {
+            if (value <= 0 || value > MAX_RECV_BATCH_SIZE)
+                return RTP_INVALID_VALUE;
+
+            reception_flow_->set_recv_batch_size((int)value);
+            break;
+        }
+        case RCC_RING_OVERFLOW_POLICY: {
+            if (value != RTP_RING_DROP_NEWEST && value != RTP_RING_DROP_OLDEST && value != RTP_RING_GROW)
+                return RTP_INVALID_VALUE;
+
+            reception_flow_->set_overflow_policy((int)value);
+            break;
+        }
+        case RCC_RING_BUFFER_MAX_SIZE: {
+            if (value <= 0)
+                return RTP_INVALID_VALUE;
+
+            reception_flow_->set_max_buffer_size(value);
+            break;
+        }
+        case RCC_RUN_TO_COMPLETION: {
+            if (value != 0 && value != 1)
+                return RTP_INVALID_VALUE;
+
+            reception_flow_->set_run_to_completion(value == 1);
+            break;
+        }
+        case RCC_RING_HUGE_PAGES: {
+            if (value != 0 && value != 1)
+                return RTP_INVALID_VALUE;
+
+            reception_flow_->set_huge_pages(value == 1);
+            break;
+        }
+        case RCC_RECEIVE_ZERO_COPY: {
+            if (value != 0 && value != 1)
+                return RTP_INVALID_VALUE;
+
+            rtp_->set_receive_zero_copy(value == 1);
+            reception_flow_->set_receive_zero_copy(value == 1);
+            break;
+        }
+        case RCC_SCL_THREADS: {
+            if (value < 0 || value > MAX_SCL_THREADS)
+                return RTP_INVALID_VALUE;
+
+            media_->set_scl_threads((size_t)value);
+            break;
+        }
+        case RCC_H26X_INCREMENTAL_RECONSTRUCTION: {
+            if (value < 0 || value > 1)
+                return RTP_INVALID_VALUE;
+
+            media_->set_incremental_reconstruction(value == 1);
+            break;
+        }
+        case RCC_H26X_SINGLE_FLUSH: {
+            if (value < 0 || value > 1)
+                return RTP_INVALID_VALUE;
+
+            // the packets of an access unit are sent with batched system calls
+            if (value == 1) {
+                socket_->enable_system_call_clustering();
+            }
+            media_->set_single_flush(value == 1);
+            break;
+        }
         case RCC_DYN_PAYLOAD_TYPE: {
             if (value <= 0 || (ssize_t)UINT8_MAX < value)
                 return RTP_INVALID_VALUE;
@@ -921,6 +1105,9 @@ rtp_error_t uvgrtp::media_stream::configure_ctx(int rcc_flag, ssize_t value)
                 return RTP_INVALID_VALUE;
 
             *ssrc_ = (uint32_t)value;
+            if (socket_) {
+                socket_->update_handlers();
+            }
             break;
         }
         case RCC_REMOTE_SSRC: {
@@ -987,6 +1174,33 @@ int uvgrtp::media_stream::get_configuration_value(int rcc_flag)
         case RCC_POLL_TIMEOUT: {
             return reception_flow_->get_poll_timeout_ms();
         }
+        case RCC_RECV_BATCH_SIZE: {
+            return reception_flow_->get_recv_batch_size();
+        }
+        case RCC_RING_OVERFLOW_POLICY: {
+            return reception_flow_->get_overflow_policy();
+        }
+        case RCC_RING_BUFFER_MAX_SIZE: {
+            return (int)reception_flow_->get_max_buffer_size();
+        }
+        case RCC_RUN_TO_COMPLETION: {
+            return reception_flow_->get_run_to_completion() ? 1 : 0;
+        }
+        case RCC_RING_HUGE_PAGES: {
+            return reception_flow_->get_huge_pages() ? 1 : 0;
+        }
+        case RCC_RECEIVE_ZERO_COPY: {
+            return rtp_->get_receive_zero_copy() ? 1 : 0;
+        }
+        case RCC_SCL_THREADS: {
+            return (int)media_->get_scl_threads();
+        }
+        case RCC_H26X_INCREMENTAL_RECONSTRUCTION: {
+            return media_->get_incremental_reconstruction() ? 1 : 0;
+        }
+        case RCC_H26X_SINGLE_FLUSH: {
+            return media_->get_single_flush() ? 1 : 0;
+        }
         default:
             ret = -1;
     }
@@ -1003,6 +1217,51 @@ uvgrtp::rtcp *uvgrtp::media_stream::get_rtcp()
     return rtcp_.get();
 }
 
+uvgrtp::ring_stats uvgrtp::media_stream::get_ring_stats() const
+{
+    uvgrtp::ring_stats stats;
+
+    if (initialized_ && reception_flow_) {
+        reception_flow_->get_ring_stats(stats);
+    }
+
+    return stats;
+}
+
+int uvgrtp::media_stream::get_poll_fd()
+{
+    if (!initialized_ || !reactor_ || reactor_->get_threads() != 0) {
+        return -1;
+    }
+
+    return reactor_->get_fd();
+}
+
+int uvgrtp::media_stream::poll_once(size_t max_packets)
+{
+    if (!initialized_ || !reactor_ || reactor_->get_threads() != 0) {
+        return -1;
+    }
+
+    int packets = reception_flow_->poll_once(max_packets, rce_flags_);
+
+    // the other sockets of the stream, such as the one of RTCP
+    if (packets < 0 || reactor_->poll(0) < 0) {
+        return -1;
+    }
+
+    return packets;
+}
+
+int uvgrtp::media_stream::process_timers(std::chrono::steady_clock::time_point now)
+{
+    if (!initialized_ || !reactor_ || reactor_->get_threads() != 0) {
+        return -1;
+    }
+
+    return reactor_->process_timers(now);
+}
+
 uint32_t uvgrtp::media_stream::get_ssrc() const
 {
     if (!initialized_ || rtp_ == nullptr) {
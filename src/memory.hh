@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 static inline void hex_dump(uint8_t* buf, size_t len)
 {
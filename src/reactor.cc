@@ -0,0 +1,470 @@
+#include "reactor.hh"
+
+#include "debug.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+constexpr int MAX_EVENTS = 64;
+
+struct uvgrtp::reactor::loop {
+    /* "owned" tells if an owner was given, an expired owner means that the callback is not called anymore */
+    struct socket {
+        std::shared_ptr<std::function<void()>> callback;
+        std::weak_ptr<void> owner;
+        bool owned;
+    };
+
+    struct timer {
+        std::chrono::steady_clock::time_point due;
+        std::shared_ptr<std::function<int()>> callback;
+        std::weak_ptr<void> owner;
+        bool owned;
+    };
+
+    int epoll_fd = -1;
+    int event_fd = -1;
+    std::thread thread;
+
+    /* Held while a callback runs so that removing a socket or a timer waits for its callback
+     * to return. Recursive because callbacks may remove themselves */
+    std::recursive_mutex mutex;
+
+    std::unordered_map<int, socket> sockets;
+    std::map<uint64_t, timer> timers;
+
+    /* Removals requested by the threads of other loops, which must not wait for "mutex".
+     * The thread of this loop applies them before it calls the next callback */
+    std::mutex pending_mutex;
+    std::atomic<bool> has_pending{false};
+    std::vector<int> pending_sockets;
+    std::vector<uint64_t> pending_timers;
+};
+
+// the loop run by the calling thread, if it is a reactor thread
+static thread_local const void *current_loop = nullptr;
+
+uvgrtp::reactor::reactor(unsigned threads) :
+    threads_(threads),
+    loops_(),
+    start_mutex_(),
+    started_(false),
+    should_stop_(false),
+    next_loop_(0),
+    next_timer_id_(1),
+    owners_mutex_(),
+    socket_owners_(),
+    timer_owners_()
+{}
+
+uvgrtp::reactor::~reactor()
+{
+    should_stop_ = true;
+
+    for (auto& l : loops_) {
+        wake(l.get());
+
+        if (l->thread.joinable())
+            l->thread.join();
+
+#ifdef __linux__
+        if (l->event_fd >= 0)
+            close(l->event_fd);
+
+        if (l->epoll_fd >= 0)
+            close(l->epoll_fd);
+#endif
+    }
+}
+
+unsigned uvgrtp::reactor::get_threads() const
+{
+    return threads_;
+}
+
+rtp_error_t uvgrtp::reactor::start()
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> lg(start_mutex_);
+
+    if (started_)
+        return loops_.empty() ? RTP_GENERIC_ERROR : RTP_OK;
+
+    started_ = true;
+
+    std::vector<std::unique_ptr<loop>> loops;
+
+    // a reactor without threads has one loop that the application runs
+    for (unsigned i = 0; i < std::max(threads_, 1u); ++i) {
+        std::unique_ptr<loop> l(new loop());
+
+        l->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        l->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLIN;
+        ev.data.fd = l->event_fd;
+
+        if (l->epoll_fd < 0 || l->event_fd < 0 ||
+            epoll_ctl(l->epoll_fd, EPOLL_CTL_ADD, l->event_fd, &ev) < 0) {
+            UVG_LOG_ERROR("Failed to create the reactor: %s", strerror(errno));
+
+            if (l->event_fd >= 0)
+                close(l->event_fd);
+
+            if (l->epoll_fd >= 0)
+                close(l->epoll_fd);
+
+            for (auto& created : loops) {
+                close(created->event_fd);
+                close(created->epoll_fd);
+            }
+            return RTP_GENERIC_ERROR;
+        }
+
+        loops.push_back(std::move(l));
+    }
+
+    loops_ = std::move(loops);
+
+    if (threads_ == 0) {
+        UVG_LOG_INFO("Created a reactor that is run by the application");
+        return RTP_OK;
+    }
+
+    for (auto& l : loops_)
+        l->thread = std::thread(&uvgrtp::reactor::run, this, l.get());
+
+    UVG_LOG_INFO("Started the reactor with %u threads", threads_);
+    return RTP_OK;
+#else
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+void uvgrtp::reactor::remove_pending(loop *l)
+{
+    if (!l->has_pending)
+        return;
+
+    std::lock_guard<std::mutex> lg(l->pending_mutex);
+
+    for (int fd : l->pending_sockets)
+        l->sockets.erase(fd);
+
+    for (uint64_t id : l->pending_timers)
+        l->timers.erase(id);
+
+    l->pending_sockets.clear();
+    l->pending_timers.clear();
+    l->has_pending = false;
+}
+
+bool uvgrtp::reactor::on_other_loop(loop *l) const
+{
+    return current_loop != nullptr && current_loop != l;
+}
+
+void uvgrtp::reactor::wake(loop *l)
+{
+#ifdef __linux__
+    uint64_t one = 1;
+
+    if (l->event_fd >= 0)
+        (void)!write(l->event_fd, &one, sizeof(one));
+#else
+    (void)l;
+#endif
+}
+
+rtp_error_t uvgrtp::reactor::add_socket(int fd, std::function<void()> callback, std::weak_ptr<void> owner)
+{
+#ifdef __linux__
+    rtp_error_t ret = start();
+
+    if (ret != RTP_OK)
+        return ret;
+
+    loop *l = loops_[next_loop_++ % loops_.size()].get();
+    {
+        std::lock_guard<std::recursive_mutex> lg(l->mutex);
+
+        // an earlier socket with the same descriptor may still wait for its removal
+        remove_pending(l);
+        bool owned = !owner.expired();
+        l->sockets[fd] = { std::make_shared<std::function<void()>>(std::move(callback)), std::move(owner), owned };
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(l->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            UVG_LOG_ERROR("Failed to add a socket to the reactor: %s", strerror(errno));
+            l->sockets.erase(fd);
+            return RTP_GENERIC_ERROR;
+        }
+    }
+
+    std::lock_guard<std::mutex> lg(owners_mutex_);
+    socket_owners_[fd] = l;
+
+    return RTP_OK;
+#else
+    (void)fd;
+    (void)callback;
+    (void)owner;
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+void uvgrtp::reactor::remove_socket(int fd)
+{
+#ifdef __linux__
+    loop *l = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(owners_mutex_);
+        auto it = socket_owners_.find(fd);
+
+        if (it == socket_owners_.end())
+            return;
+
+        l = it->second;
+        socket_owners_.erase(it);
+    }
+
+    /* the thread of "l" may be waiting in a callback for the mutex of our loop */
+    if (on_other_loop(l)) {
+        (void)epoll_ctl(l->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+        std::lock_guard<std::mutex> lg(l->pending_mutex);
+        l->pending_sockets.push_back(fd);
+        l->has_pending = true;
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lg(l->mutex);
+    (void)epoll_ctl(l->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    l->sockets.erase(fd);
+#else
+    (void)fd;
+#endif
+}
+
+uint64_t uvgrtp::reactor::add_timer(int delay_ms, std::function<int()> callback, std::weak_ptr<void> owner)
+{
+#ifdef __linux__
+    if (start() != RTP_OK)
+        return 0;
+
+    uint64_t id = next_timer_id_++;
+    loop *l     = loops_[next_loop_++ % loops_.size()].get();
+    {
+        std::lock_guard<std::mutex> lg(owners_mutex_);
+        timer_owners_[id] = l;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lg(l->mutex);
+        bool owned = !owner.expired();
+        l->timers[id] = {
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(delay_ms, 0)),
+            std::make_shared<std::function<int()>>(std::move(callback)),
+            std::move(owner),
+            owned
+        };
+    }
+
+    /* the thread may be waiting for longer than the delay of the new timer */
+    wake(l);
+    return id;
+#else
+    (void)delay_ms;
+    (void)callback;
+    (void)owner;
+    return 0;
+#endif
+}
+
+void uvgrtp::reactor::remove_timer(uint64_t id)
+{
+    loop *l = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(owners_mutex_);
+        auto it = timer_owners_.find(id);
+
+        if (it == timer_owners_.end())
+            return;
+
+        l = it->second;
+        timer_owners_.erase(it);
+    }
+
+    if (on_other_loop(l)) {
+        std::lock_guard<std::mutex> lg(l->pending_mutex);
+        l->pending_timers.push_back(id);
+        l->has_pending = true;
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lg(l->mutex);
+    l->timers.erase(id);
+}
+
+int uvgrtp::reactor::get_fd()
+{
+    if (threads_ != 0 || start() != RTP_OK)
+        return -1;
+
+    return loops_[0]->epoll_fd;
+}
+
+int uvgrtp::reactor::poll(int timeout_ms)
+{
+    if (threads_ != 0 || start() != RTP_OK)
+        return -1;
+
+    return dispatch_sockets(loops_[0].get(), timeout_ms);
+}
+
+int uvgrtp::reactor::process_timers(std::chrono::steady_clock::time_point now)
+{
+    if (threads_ != 0 || start() != RTP_OK)
+        return -1;
+
+    return dispatch_timers(loops_[0].get(), now);
+}
+
+void uvgrtp::reactor::run(loop *l)
+{
+    current_loop = l;
+
+    while (!should_stop_) {
+        int timeout = next_timer(l, std::chrono::steady_clock::now());
+
+        if (dispatch_sockets(l, timeout) < 0)
+            break;
+
+        (void)dispatch_timers(l, std::chrono::steady_clock::now());
+    }
+}
+
+int uvgrtp::reactor::dispatch_sockets(loop *l, int timeout_ms)
+{
+#ifdef __linux__
+    struct epoll_event events[MAX_EVENTS];
+    int ready = epoll_wait(l->epoll_fd, events, MAX_EVENTS, timeout_ms);
+
+    if (ready < 0) {
+        if (errno == EINTR)
+            return 0;
+
+        UVG_LOG_ERROR("epoll_wait(2) failed: %s", strerror(errno));
+        return -1;
+    }
+
+    int called = 0;
+
+    for (int i = 0; i < ready; ++i) {
+        int fd = events[i].data.fd;
+
+        if (fd == l->event_fd) {
+            uint64_t value = 0;
+            (void)!read(l->event_fd, &value, sizeof(value));
+            continue;
+        }
+
+        std::lock_guard<std::recursive_mutex> lg(l->mutex);
+        remove_pending(l);
+        auto it = l->sockets.find(fd);
+
+        /* removed after epoll_wait() returned */
+        if (it == l->sockets.end())
+            continue;
+
+        /* released after the call, which may destroy the owner on this thread */
+        std::shared_ptr<void> owner = it->second.owner.lock();
+
+        if (it->second.owned && !owner)
+            continue;
+
+        auto callback = it->second.callback;
+        (*callback)();
+        ++called;
+    }
+
+    return called;
+#else
+    (void)l;
+    (void)timeout_ms;
+    return -1;
+#endif
+}
+
+int uvgrtp::reactor::dispatch_timers(loop *l, std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard<std::recursive_mutex> lg(l->mutex);
+
+    std::vector<uint64_t> due;
+    for (auto& t : l->timers) {
+        if (t.second.due <= now)
+            due.push_back(t.first);
+    }
+
+    for (uint64_t id : due) {
+        remove_pending(l);
+        auto it = l->timers.find(id);
+
+        if (it == l->timers.end())
+            continue;
+
+        std::shared_ptr<void> owner = it->second.owner.lock();
+        int next = -1;
+
+        if (!it->second.owned || owner) {
+            auto callback = it->second.callback;
+            next          = (*callback)();
+        }
+
+        /* the callback may have removed the timer */
+        if ((it = l->timers.find(id)) == l->timers.end())
+            continue;
+
+        if (next < 0) {
+            l->timers.erase(it);
+
+            std::lock_guard<std::mutex> owners_lg(owners_mutex_);
+            timer_owners_.erase(id);
+        } else {
+            it->second.due = now + std::chrono::milliseconds(next);
+        }
+    }
+
+    return next_timer(l, now);
+}
+
+int uvgrtp::reactor::next_timer(loop *l, std::chrono::steady_clock::time_point now)
+{
+    std::lock_guard<std::recursive_mutex> lg(l->mutex);
+    int timeout = -1;
+
+    for (auto& t : l->timers) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(t.second.due - now).count();
+        wait      = std::max(wait, (decltype(wait))0);
+
+        if (timeout < 0 || wait < timeout)
+            timeout = (int)wait;
+    }
+
+    return timeout;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "uvgrtp/util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace uvgrtp {
+
+    /* Shared I/O reactor of a context, used by the streams created with RCE_REACTOR.
+     *
+     * A fixed pool of threads, each waiting on an epoll instance of its own, serves the sockets
+     * and timers of all these streams. A socket or a timer is served by the same thread for its
+     * whole lifetime so its callbacks never run at the same time and stay in order.
+     * The threads are started when the first socket or timer is added. Linux only
+     *
+     * A reactor with zero threads is driven by the application instead: it has one epoll
+     * instance and the callbacks run on the thread calling poll() and process_timers() */
+    class reactor {
+        public:
+            reactor(unsigned threads);
+            ~reactor();
+
+            /* Call "callback" from a reactor thread whenever "fd" has data to read.
+             * The callback must not block, data that it leaves unread causes a new call
+             *
+             * If "owner" is given, it is locked for the duration of each call and the callback is
+             * not called anymore once the owner has been destroyed. The object that the callback
+             * uses should be the owner, see remove_socket()
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support the reactor
+             * Return RTP_GENERIC_ERROR if the socket could not be added */
+            rtp_error_t add_socket(int fd, std::function<void()> callback,
+                std::weak_ptr<void> owner = std::weak_ptr<void>());
+
+            /* Stop serving "fd". Once this returns, the callback is not running and is never
+             * called again.
+             *
+             * Waiting for a callback of another reactor thread could deadlock, so from a callback of
+             * a thread other than the one serving "fd", the removal is left to the serving thread:
+             * the callback may still be running or about to run when this returns, but is not
+             * called after that. The owner given to add_socket() stays alive until such a call
+             * has returned, so it can be released right after this returns */
+            void remove_socket(int fd);
+
+            /* Call "callback" from a reactor thread after "delay_ms". The callback returns the delay
+             * to its next call in milliseconds or a negative value to stop the timer.
+             * "owner" is kept alive during the calls the same way as with add_socket()
+             *
+             * Return the id of the timer on success
+             * Return 0 if the platform does not support the reactor */
+            uint64_t add_timer(int delay_ms, std::function<int()> callback,
+                std::weak_ptr<void> owner = std::weak_ptr<void>());
+
+            /* Stop the timer "id". Once this returns, the callback is not running and is never
+             * called again. From a callback of another reactor thread, the removal is left to the
+             * thread serving the timer the same way as with remove_socket() */
+            void remove_timer(uint64_t id);
+
+            unsigned get_threads() const;
+
+            /* Get the epoll instance of a reactor without threads. It is readable when an added
+             * socket has data to read or when a timer has been added
+             *
+             * Return the file descriptor on success
+             * Return -1 if the reactor has threads or could not be created */
+            int get_fd();
+
+            /* Wait at most "timeout_ms" for the sockets of a reactor without threads and call the
+             * callback of each readable socket once
+             *
+             * Return the number of callbacks called
+             * Return -1 if the reactor has threads or waiting failed */
+            int poll(int timeout_ms);
+
+            /* Call the callbacks of the timers of a reactor without threads that are due at "now"
+             *
+             * Return the number of milliseconds until the next timer is due
+             * Return -1 if there are no timers or the reactor has threads */
+            int process_timers(std::chrono::steady_clock::time_point now);
+
+        private:
+            struct loop;
+
+            /* Create the epoll instances and start the threads if not already done */
+            rtp_error_t start();
+
+            /* Event loop of one reactor thread */
+            void run(loop *l);
+
+            /* Wait at most "timeout_ms" for the sockets of "l" and call their callbacks
+             *
+             * Return the number of callbacks called or -1 on error */
+            int dispatch_sockets(loop *l, int timeout_ms);
+
+            /* Call the timers of "l" that are due at "now"
+             *
+             * Return the number of milliseconds until the next timer or -1 if there are none */
+            int dispatch_timers(loop *l, std::chrono::steady_clock::time_point now);
+
+            /* Milliseconds until the first timer of "l" is due, -1 if there are no timers */
+            int next_timer(loop *l, std::chrono::steady_clock::time_point now);
+
+            /* Wake the thread of "l" so that it sees a new timer */
+            void wake(loop *l);
+
+            /* Apply the removals other threads have left to "l". The mutex of "l" must be held */
+            void remove_pending(loop *l);
+
+            /* Return true if the caller is a reactor thread other than the one of "l" */
+            bool on_other_loop(loop *l) const;
+
+            unsigned threads_;
+            std::vector<std::unique_ptr<loop>> loops_;
+
+            std::mutex start_mutex_;
+            bool started_;
+            std::atomic<bool> should_stop_;
+
+            // loops_ are used in turns
+            std::atomic<unsigned> next_loop_;
+            std::atomic<uint64_t> next_timer_id_;
+
+            // the loop that serves each socket and timer
+            std::mutex owners_mutex_;
+            std::unordered_map<int, loop *> socket_owners_;
+            std::unordered_map<uint64_t, loop *> timer_owners_;
+    };
+}
+
+namespace uvg_rtp = uvgrtp;
@@ -4,19 +4,28 @@
 #include "uvgrtp/frame.hh"
 
 #include "socket.hh"
+#include "uring.hh"
+#include "reactor.hh"
+#include "buffer_pool.hh"
+#include "memory.hh"
 #include "debug.hh"
 #include "random.hh"
 #include "uvgrtp/rtcp.hh"
+#include "uvgrtp/media_stream.hh"
 
 #include "global.hh"
 
 #include <chrono>
+#include <algorithm>
+#include <iterator>
 
 #ifndef _WIN32
 #include <errno.h>
 #include <poll.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #else
+#include <malloc.h>
 #define MSG_DONTWAIT 0
 #endif
 
@@ -29,27 +38,165 @@
 #endif
 
 constexpr size_t DEFAULT_INITIAL_BUFFER_SIZE = 4194304;
+constexpr int DEFAULT_RECV_BATCH_SIZE = 32;
+
+// every ring buffer slot starts on its own cache line
+constexpr size_t RING_SLOT_ALIGNMENT = 64;
+
+// with RCC_RING_HUGE_PAGES, ring buffers at least this large are backed by transparent huge pages
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// requests of make_room() to the processing thread
+constexpr int RING_NO_REQUEST   = 0;
+constexpr int RING_DROP_OLDEST  = 1;
+constexpr int RING_GROW         = 2;
+constexpr int RING_SERVING      = 3;
+
+/* Allocate the packet data of a whole ring buffer. The memory is page aligned
+ *
+ * Return nullptr on failure */
+static uint8_t* alloc_slab(size_t size, bool huge_pages)
+{
+#ifdef _WIN32
+    (void)huge_pages;
+    return (uint8_t*)_aligned_malloc(size, RING_SLOT_ALIGNMENT);
+#else
+    void* slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (slab == MAP_FAILED) {
+        return nullptr;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && size >= HUGE_PAGE_SIZE) {
+        (void)madvise(slab, size, MADV_HUGEPAGE);
+    }
+#else
+    (void)huge_pages;
+#endif
+
+    return (uint8_t*)slab;
+#endif
+}
+
+static void free_slab(uint8_t* slab, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    _aligned_free(slab);
+#else
+    munmap(slab, size);
+#endif
+}
+
+/* Did the RTP handler leave the payload of "frame" in the received packet instead of copying it */
+static bool payload_in_packet(const uvgrtp::frame::rtp_frame* frame, const uint8_t* packet, size_t size)
+{
+    uintptr_t payload = (uintptr_t)frame->payload;
+    return payload >= (uintptr_t)packet && payload <= (uintptr_t)packet + size;
+}
+
+/* Number of datagrams in a ring buffer slot of "size" bytes. With UDP GRO, there may be several of them */
+static uint64_t packets_in_slot(int size, int gso_size)
+{
+    if (gso_size <= 0 || gso_size >= size) {
+        return 1;
+    }
+    return (uint64_t)((size + gso_size - 1) / gso_size);
+}
+
+// frames waiting in the frame queue of a remote source before the oldest ones are dropped
+constexpr size_t MAX_QUEUED_FRAMES = 1024;
+
+// number of sockets receiving a port with RCE_REUSEPORT_SHARDING
+constexpr unsigned MIN_RECEIVE_SHARDS = 2;
+constexpr unsigned MAX_RECEIVE_SHARDS = 8;
+
+#ifdef UVGRTP_HAVE_IO_URING
+/* the multishot receive of receiver_uring() and the group of its provided buffers */
+constexpr uint64_t URING_RECV_ID = 1;
+constexpr uint16_t URING_BUFFER_GROUP = 0;
+constexpr unsigned URING_RECV_ENTRIES = 8;
+
+/* Cancel the multishot receive and wait until the kernel no longer writes to the provided buffers.
+ * Packets that arrive meanwhile are dropped */
+static void cancel_receive(uvgrtp::uring& ring, int timeout_ms)
+{
+    bool armed = (ring.cancel(URING_RECV_ID) == RTP_OK);
+    struct io_uring_cqe cqe;
+
+    while (armed && ring.wait(timeout_ms) != RTP_GENERIC_ERROR) {
+        while (ring.next_completion(cqe)) {
+            if (cqe.user_data == URING_RECV_ID && !(cqe.flags & IORING_CQE_F_MORE)) {
+                armed = false;
+            }
+            // the receive had already ended
+            else if (cqe.user_data != URING_RECV_ID && cqe.res == -ENOENT) {
+                armed = false;
+            }
+        }
+    }
+}
+#endif
+
+uvgrtp::receive_queue::~receive_queue()
+{
+    for (auto& frame : frames)
+    {
+        (void)uvgrtp::frame::dealloc_frame(frame);
+    }
+}
 
 uvgrtp::reception_flow::reception_flow(bool ipv6) :
-    frames_({}),
     hooks_({}),
     should_stop_(true),
     receiver_(nullptr),
     user_hook_arg_(nullptr),
     user_hook_(nullptr),
     packet_handlers_({}),
+    dispatch_table_(std::make_shared<dispatch_table>()),
     poll_timeout_ms_(100),
+    recv_batch_size_(DEFAULT_RECV_BATCH_SIZE),
     ring_buffer_(),
+    ring_slab_(nullptr),
+    ring_slab_size_(0),
+    ring_stride_(0),
+    ring_owners_(),
+    uring_(nullptr),
+    ring_changed_(true),
     ring_read_index_(-1), // invalid first index that will increase to a valid one
     last_ring_write_index_(-1),
+    run_to_completion_(false),
     socket_(),
     buffer_size_kbytes_(DEFAULT_INITIAL_BUFFER_SIZE),
     payload_size_(MAX_IPV4_PAYLOAD),
+    gro_(false),
+    huge_pages_(false),
+    receive_zero_copy_(false),
     active_(false),
-    ipv6_(ipv6)
-{
-    create_ring_buffer();
-}
+    ipv6_(ipv6),
+    shards_(),
+    owner_(this),
+    stopped_shards_(),
+    batch_bufs_(),
+    batch_lens_(),
+    batch_segments_(),
+    reactor_(nullptr),
+    buffer_pool_(nullptr),
+    overflow_policy_(RTP_RING_DROP_NEWEST),
+    max_buffer_size_(0),
+    rcv_buf_size_(0),
+    ring_request_(RING_NO_REQUEST),
+    ring_request_mutex_(),
+    ring_request_cond_(),
+    drop_buffer_(),
+    ring_slots_(0),
+    received_packets_(0),
+    dropped_newest_(0),
+    dropped_oldest_(0),
+    ring_grows_(0),
+    out_of_buffers_(false)
+{}
 
 uvgrtp::reception_flow::~reception_flow()
 {
@@ -60,52 +207,188 @@ uvgrtp::reception_flow::~reception_flow()
 
 void uvgrtp::reception_flow::clear_frames()
 {
-    frames_mtx_.lock();
-    for (auto& frame : frames_)
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    for (auto& handlers : packet_handlers_)
     {
-        (void)uvgrtp::frame::dealloc_frame(frame);
-    }
+        if (!handlers.second.frames)
+            continue;
 
-    frames_.clear();
-    frames_mtx_.unlock();
+        std::lock_guard<std::mutex> qlg(handlers.second.frames->mutex);
+        for (auto& frame : handlers.second.frames->frames)
+        {
+            (void)uvgrtp::frame::dealloc_frame(frame);
+        }
+        handlers.second.frames->frames.clear();
+    }
 }
 
 void uvgrtp::reception_flow::create_ring_buffer()
 {
     destroy_ring_buffer();
-    size_t elements = buffer_size_kbytes_ / payload_size_;
+    size_t elements = ring_slots(buffer_size_kbytes_);
 
-    for (size_t i = 0; i < elements; ++i)
-    {
-        uint8_t* data = new uint8_t[payload_size_];
-        if (data)
-        {
-            ring_buffer_.push_back({ data, 0});
+    /* packets received by the reactor are processed before the next batch is read,
+     * the one extra slot is the one at the read index */
+    if (reactor_) {
+        elements = std::min(elements, (size_t)std::max(recv_batch_size_, 1) + 1);
+    }
+
+    // the slot at the read index is never written, so one slot would never receive anything
+    elements = std::max(elements, (size_t)2);
+
+    if (!receive_zero_copy_) {
+        buffer_pool_ = nullptr;
+    }
+    else if (!buffer_pool_ || buffer_pool_->get_buffer_size() != slot_size()) {
+        buffer_pool_ = std::make_shared<uvgrtp::buffer_pool>(slot_size());
+    }
+
+    if (buffer_pool_) {
+
+        for (size_t i = 0; i < elements; ++i) {
+            uvgrtp::pool_buffer* buffer = buffer_pool_->acquire();
+            if (!buffer) {
+                UVG_LOG_ERROR("Failed to allocate memory for ring buffer");
+                break;
+            }
+            ring_owners_.push_back(buffer);
         }
-        else
-        {
+        elements = ring_owners_.size();
+    }
+    else {
+        ring_stride_ = (slot_size() + RING_SLOT_ALIGNMENT - 1) / RING_SLOT_ALIGNMENT * RING_SLOT_ALIGNMENT;
+        ring_slab_size_ = elements * ring_stride_;
+
+        if (!(ring_slab_ = alloc_slab(ring_slab_size_, huge_pages_))) {
             UVG_LOG_ERROR("Failed to allocate memory for ring buffer");
+            ring_slab_size_ = 0;
+            elements = 0;
         }
     }
+
+    ring_buffer_.assign(elements, { 0, 0 });
+    limit_buffer_pool();
+
+    ring_read_index_ = -1;
+    last_ring_write_index_ = -1;
+    ring_slots_ = ring_buffer_.size();
+}
+
+size_t uvgrtp::reception_flow::slot_size() const
+{
+    return gro_ ? UINT16_MAX : payload_size_;
+}
+
+size_t uvgrtp::reception_flow::ring_slots(size_t bytes) const
+{
+    if (!gro_) {
+        return bytes / payload_size_;
+    }
+
+    /* Every slot is UINT16_MAX bytes, so counting slots by the MTU would make the default ring
+     * take over 180 MB. Small datagrams that are not coalesced each still take a whole slot,
+     * so one extra batch of slots keeps a burst of them from overflowing the ring at once */
+    return bytes / slot_size() + (size_t)std::max(recv_batch_size_, 1);
 }
 
 void uvgrtp::reception_flow::destroy_ring_buffer()
 {
-    for (size_t i = 0; i < ring_buffer_.size(); ++i)
+    for (uvgrtp::pool_buffer* buffer : ring_owners_)
     {
-        if (ring_buffer_.at(i).data)
-        {
-            delete[] ring_buffer_.at(i).data;
-        }
+        uvgrtp::release_buffer(buffer);
+    }
+    ring_owners_.clear();
+
+    if (ring_slab_)
+    {
+        free_slab(ring_slab_, ring_slab_size_);
+        ring_slab_ = nullptr;
+        ring_slab_size_ = 0;
     }
     ring_buffer_.clear();
 }
 
+uint8_t* uvgrtp::reception_flow::slot_data(ssize_t index) const
+{
+    if (ring_slab_) {
+        return ring_slab_ + (size_t)index * ring_stride_;
+    }
+    return ring_owners_[index]->data;
+}
+
+bool uvgrtp::reception_flow::recycle_slot(ssize_t index)
+{
+    /* the ring holds one reference, any other belongs to a frame */
+    if (ring_owners_.empty() || ring_owners_[index]->refs.load(std::memory_order_acquire) == 1) {
+        return true;
+    }
+
+    uvgrtp::pool_buffer* buffer = buffer_pool_->acquire();
+    if (!buffer) {
+        return false;
+    }
+
+    uvgrtp::release_buffer(ring_owners_[index]);
+    ring_owners_[index] = buffer;
+    return true;
+}
+
+void uvgrtp::reception_flow::limit_buffer_pool()
+{
+    if (!buffer_pool_) {
+        return;
+    }
+
+    // without RCC_RING_BUFFER_MAX_SIZE, buffers are allocated as long as there is memory
+    if (max_buffer_size_ <= 0) {
+        buffer_pool_->set_max_buffers(0);
+        return;
+    }
+
+    // the ring itself may grow up to the limit with RTP_RING_GROW
+    size_t max_buffers = ring_slots((size_t)max_buffer_size_);
+    buffer_pool_->set_max_buffers(std::max(max_buffers, ring_buffer_.size()));
+}
+
+bool uvgrtp::reception_flow::update_ring_buffer()
+{
+    if (!ring_changed_) {
+        return false;
+    }
+
+    /* let the processing thread finish with the packets of the old ring. The reactor has
+     * processed them already, and there is no thread that could process the rest */
+    if (!reactor_ && last_ring_write_index_ != -1) {
+        wake_processor();
+
+        std::unique_lock<std::mutex> lk(ring_request_mutex_);
+        ring_request_cond_.wait(lk, [this] {
+            return should_stop_ || (ring_read_index_ == last_ring_write_index_ &&
+                                    ring_buffer_[last_ring_write_index_].read == 0);
+        });
+    }
+
+    /* The processing thread may still be in process_available() after the last slot was marked
+     * processed. It holds "process_mutex_" for a whole pass, so it cannot see the ring half replaced */
+    std::lock_guard<std::mutex> plg(process_mutex_);
+
+    ring_changed_ = false;
+    create_ring_buffer();
+    return true;
+}
+
 void uvgrtp::reception_flow::set_buffer_size(const ssize_t& value)
 {
+    {
+        std::lock_guard<std::mutex> alg(active_mutex_);
+        for (auto& shard : shards_) {
+            shard->set_buffer_size(value);
+        }
+    }
+
     std::lock_guard<std::mutex> lg(ring_mutex_);
     buffer_size_kbytes_ = value;
-    create_ring_buffer();
+    ring_changed_ = true;
 }
 
 ssize_t uvgrtp::reception_flow::get_buffer_size() const
@@ -115,12 +398,24 @@ ssize_t uvgrtp::reception_flow::get_buffer_size() const
 
 void uvgrtp::reception_flow::set_payload_size(const size_t& value)
 {
+    {
+        std::lock_guard<std::mutex> alg(active_mutex_);
+        for (auto& shard : shards_) {
+            shard->set_payload_size(value);
+        }
+    }
+
+    std::lock_guard<std::mutex> lg(ring_mutex_);
     payload_size_ = value;
-    create_ring_buffer();
+    ring_changed_ = true;
 }
 
 void uvgrtp::reception_flow::set_poll_timeout_ms(int timeout_ms)
 {
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        shard->set_poll_timeout_ms(timeout_ms);
+    }
     poll_timeout_ms_ = timeout_ms;
 }
 
@@ -129,189 +424,476 @@ int uvgrtp::reception_flow::get_poll_timeout_ms()
     return poll_timeout_ms_;
 }
 
-rtp_error_t uvgrtp::reception_flow::start(std::shared_ptr<uvgrtp::socket> socket, int rce_flags)
+void uvgrtp::reception_flow::set_recv_batch_size(int batch_size)
 {
-    std::lock_guard<std::mutex> lg(active_mutex_);
-    if (active_) {
-        return RTP_OK;
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        shard->set_recv_batch_size(batch_size);
     }
-    should_stop_ = false;
-
-    UVG_LOG_DEBUG("Creating receiving threads and setting priorities");
-    processor_ = std::unique_ptr<std::thread>(new std::thread(&uvgrtp::reception_flow::process_packet, this, rce_flags));
-    receiver_ = std::unique_ptr<std::thread>(new std::thread(&uvgrtp::reception_flow::receiver, this, socket));
-
-    // set receiver thread priority to maximum
-#ifndef WIN32
-    struct sched_param params;
-    params.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    pthread_setschedparam(receiver_->native_handle(), SCHED_FIFO, &params);
-    params.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
-    pthread_setschedparam(processor_->native_handle(), SCHED_FIFO, &params);
-#else
-
-    SetThreadPriority(receiver_->native_handle(), REALTIME_PRIORITY_CLASS);
-    SetThreadPriority(processor_->native_handle(), ABOVE_NORMAL_PRIORITY_CLASS);
+    recv_batch_size_ = batch_size;
+}
 
-#endif
-    active_ = true;
-    return RTP_ERROR::RTP_OK;
+int uvgrtp::reception_flow::get_recv_batch_size() const
+{
+    return recv_batch_size_;
 }
 
-rtp_error_t uvgrtp::reception_flow::stop()
-{    
-    std::lock_guard<std::mutex> lg(active_mutex_);
-    if (!active_) {
-        return RTP_OK;
+void uvgrtp::reception_flow::set_overflow_policy(int policy)
+{
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        shard->set_overflow_policy(policy);
     }
-    should_stop_ = true;
-    process_cond_.notify_all();
+    overflow_policy_ = policy;
+}
 
-    if (receiver_ != nullptr && receiver_->joinable())
-    {
-        receiver_->join();
-    }
+int uvgrtp::reception_flow::get_overflow_policy() const
+{
+    return overflow_policy_;
+}
 
-    if (processor_ != nullptr && processor_->joinable())
-    {
-        processor_->join();
+void uvgrtp::reception_flow::set_max_buffer_size(ssize_t value)
+{
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        shard->set_max_buffer_size(value);
     }
+    max_buffer_size_ = value;
 
-    clear_frames();
-    active_ = false;
-    return RTP_OK;
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    limit_buffer_pool();
 }
 
-rtp_error_t uvgrtp::reception_flow::install_receive_hook(
-    void *arg,
-    void (*hook)(void *, uvgrtp::frame::rtp_frame *),
-    uint32_t remote_ssrc
-)
+ssize_t uvgrtp::reception_flow::get_max_buffer_size() const
 {
-    std::lock_guard<std::mutex> lg(hooks_mutex_);
-    if (!hook)
-        return RTP_INVALID_VALUE;
+    return max_buffer_size_ > 0 ? max_buffer_size_ : 4 * buffer_size_kbytes_;
+}
 
-    receive_pkt_hook new_hook = { arg, hook };
-    hooks_[remote_ssrc] = new_hook;
+void uvgrtp::reception_flow::set_run_to_completion(bool enabled)
+{
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        shard->set_run_to_completion(enabled);
+    }
+    run_to_completion_ = enabled;
+}
 
-    return RTP_OK;
+bool uvgrtp::reception_flow::get_run_to_completion() const
+{
+    return run_to_completion_;
 }
 
-uvgrtp::frame::rtp_frame *uvgrtp::reception_flow::pull_frame()
+void uvgrtp::reception_flow::set_huge_pages(bool enabled)
 {
-    while (frames_.empty() && !should_stop_)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> alg(active_mutex_);
+        for (auto& shard : shards_) {
+            shard->set_huge_pages(enabled);
+        }
     }
 
-    if (should_stop_)
-        return nullptr;
-    uvgrtp::frame::rtp_frame* frame = nullptr;
-    frames_mtx_.lock();
-    if (!frames_.empty()) {
-        frame = frames_.front();
-        frames_.erase(frames_.begin());
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    if (huge_pages_ != enabled) {
+        huge_pages_ = enabled;
+        ring_changed_ = true;
     }
-    frames_mtx_.unlock();
-
-    return frame;
 }
 
-uvgrtp::frame::rtp_frame *uvgrtp::reception_flow::pull_frame(ssize_t timeout_ms)
+bool uvgrtp::reception_flow::get_huge_pages() const
 {
-    auto start_time = std::chrono::high_resolution_clock::now();
+    return huge_pages_;
+}
 
-    while (frames_.empty() && 
-        !should_stop_ &&
-        timeout_ms > std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count())
+void uvgrtp::reception_flow::set_receive_zero_copy(bool enabled)
+{
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> alg(active_mutex_);
+        for (auto& shard : shards_) {
+            shard->set_receive_zero_copy(enabled);
+        }
     }
 
-    if (should_stop_ || frames_.empty())
-        return nullptr;
-    uvgrtp::frame::rtp_frame* frame = nullptr;
-    frames_mtx_.lock();
-    if (!frames_.empty()) {
-        frame = frames_.front();
-        frames_.pop_front();
+    /* the receiver still uses the pool of the old ring, the pool is replaced with the ring */
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    if (receive_zero_copy_ != enabled) {
+        receive_zero_copy_ = enabled;
+        ring_changed_ = true;
     }
-    frames_mtx_.unlock();
+}
 
-    return frame;
+void uvgrtp::reception_flow::set_socket_rcv_buffer_size(int buf_size)
+{
+    // the socket of the flow itself is owned and configured by the media stream
+    std::lock_guard<std::mutex> alg(active_mutex_);
+    for (auto& shard : shards_) {
+        if (shard->socket_->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, sizeof(int)) != RTP_OK) {
+            UVG_LOG_WARN("Failed to set the receive buffer size of a receive shard");
+        }
+    }
+    rcv_buf_size_ = buf_size;
 }
 
-uvgrtp::frame::rtp_frame* uvgrtp::reception_flow::pull_frame(std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
+void uvgrtp::reception_flow::get_ring_stats(uvgrtp::ring_stats& stats)
 {
-    while (frames_.empty() && !should_stop_)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> alg(active_mutex_);
+        for (auto& shard : shards_) {
+            shard->get_ring_stats(stats);
+        }
     }
 
-    if (should_stop_)
-        return nullptr;
+    stats.received       += received_packets_;
+    stats.dropped_newest += dropped_newest_;
+    stats.dropped_oldest += dropped_oldest_;
+    stats.grown          += ring_grows_;
+    stats.slots          += ring_slots_;
+}
+
+rtp_error_t uvgrtp::reception_flow::start(std::shared_ptr<uvgrtp::socket> socket, int rce_flags,
+    std::shared_ptr<uvgrtp::reactor> reactor)
+{
+    std::lock_guard<std::mutex> lg(active_mutex_);
+    if (active_) {
+        return RTP_OK;
+    }
+    should_stop_ = false;
+
+    bool gro = false;
 
-    // Check if the source ssrc in the frame matches the remote ssrc that we want to pull frames from
-    uvgrtp::frame::rtp_frame* frame = nullptr;
-    frames_mtx_.lock();
-    if (!frames_.empty()) {
-        frame = frames_.front();
-        if ( frame && frame->header.ssrc == remote_ssrc.get()->load()) {
-            frames_.erase(frames_.begin());
+    /* With GRO, the kernel may coalesce several datagrams into one read, so every ring buffer
+     * slot must fit the largest possible UDP payload. The buffer size is divided into these
+     * slots, see ring_slots() */
+    if (rce_flags & RCE_UDP_GRO) {
+        if (socket->enable_gro() == RTP_OK) {
+            gro = true;
         }
         else {
-            frame = nullptr;
+            UVG_LOG_WARN("RCE_UDP_GRO could not be enabled, receiving packets without GRO");
         }
     }
-    frames_mtx_.unlock();
-    return frame;
-}
 
-uvgrtp::frame::rtp_frame* uvgrtp::reception_flow::pull_frame(ssize_t timeout_ms, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
-{
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    while (frames_.empty() &&
-        !should_stop_ &&
-        timeout_ms > std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count())
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> rlg(ring_mutex_);
+        if (gro_ != gro) {
+            gro_ = gro;
+            ring_changed_ = true;
+        }
     }
 
-    if (should_stop_ || frames_.empty())
-        return nullptr;
-    // Check if the source ssrc in the frame matches the remote ssrc that we want to pull frames from
-    uvgrtp::frame::rtp_frame* frame = nullptr;
-    frames_mtx_.lock();
-    if (!frames_.empty()) {
-        frame = frames_.front();
-        if (frame && frame->header.ssrc == remote_ssrc.get()->load()) {
-            frames_.pop_front();
+    if (reactor) {
+        if (rce_flags & RCE_IO_URING) {
+            UVG_LOG_WARN("RCE_IO_URING is not used for receiving with RCE_REACTOR");
         }
-        else {
-            frame = nullptr;
+
+        {
+            std::lock_guard<std::mutex> rlg(ring_mutex_);
+            reactor_ = reactor;
+            ring_changed_ = true;
+        }
+
+        std::function<void()> ready = [this, socket, rce_flags]() mutable {
+            receive_ready(socket, rce_flags);
+        };
+
+        /* A reactor without threads only tells the application that there are packets waiting,
+         * they are read with a budget of the application by poll_once() */
+        if (reactor->get_threads() == 0) {
+            ready = []() {};
+        }
+
+        /* the callback of a shard uses its owner too, which also keeps the shard alive */
+        rtp_error_t ret = reactor->add_socket(socket->get_raw_socket(), ready, owner_->weak_from_this());
+
+        if (ret == RTP_OK) {
+            socket_ = socket;
+
+            if ((rce_flags & RCE_REUSEPORT_SHARDING) && reactor->get_threads() == 0) {
+                UVG_LOG_WARN("RCE_REUSEPORT_SHARDING is not used when the application runs the reactor");
+            }
+            else if ((rce_flags & RCE_REUSEPORT_SHARDING) && start_shards(socket, rce_flags) != RTP_OK) {
+                UVG_LOG_WARN("RCE_REUSEPORT_SHARDING could not be enabled, receiving with one socket");
+            }
+
+            active_ = true;
+            return RTP_OK;
         }
+
+        UVG_LOG_WARN("Failed to add the socket to the reactor, receiving packets with threads of its own");
+
+        std::lock_guard<std::mutex> rlg(ring_mutex_);
+        reactor_ = nullptr;
+        ring_changed_ = true;
     }
-    frames_mtx_.unlock();
-    return frame;
-}
 
-rtp_error_t uvgrtp::reception_flow::install_handler(int type, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc,
-    std::function<rtp_error_t(void*, int, uint8_t*, size_t, frame::rtp_frame** out)> handler, void* args)
-{
-    uint32_t ssrc = remote_ssrc.get()->load();
-    handlers_mutex_.lock();
-    switch (type) {
-        case 1: {
-            packet_handlers_[ssrc].rtp.handler = handler;
-            packet_handlers_[ssrc].rtp.args = args;
-            break;
+    void (uvgrtp::reception_flow::*receiver)(std::shared_ptr<uvgrtp::socket>, int) = &uvgrtp::reception_flow::receiver;
+
+    if (rce_flags & RCE_IO_URING) {
+        if (gro) {
+            UVG_LOG_WARN("RCE_IO_URING is not used for receiving with RCE_UDP_GRO");
         }
-        case 2: {
-            packet_handlers_[ssrc].rtcp.handler = handler;
-            packet_handlers_[ssrc].rtcp.args = args;
-            break;
+        else if (start_uring() == RTP_OK) {
+            receiver = &uvgrtp::reception_flow::receiver_uring;
+        }
+        else {
+            UVG_LOG_WARN("RCE_IO_URING could not be enabled, receiving packets with recvmmsg()");
+        }
+    }
+
+    UVG_LOG_DEBUG("Creating receiving threads and setting priorities");
+    processor_ = std::unique_ptr<std::thread>(new std::thread(&uvgrtp::reception_flow::process_packet, this, rce_flags));
+    receiver_ = std::unique_ptr<std::thread>(new std::thread(receiver, this, socket, rce_flags));
+
+    // set receiver thread priority to maximum
+#ifndef WIN32
+    struct sched_param params;
+    params.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_setschedparam(receiver_->native_handle(), SCHED_FIFO, &params);
+    params.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_setschedparam(processor_->native_handle(), SCHED_FIFO, &params);
+#else
+
+    SetThreadPriority(receiver_->native_handle(), REALTIME_PRIORITY_CLASS);
+    SetThreadPriority(processor_->native_handle(), ABOVE_NORMAL_PRIORITY_CLASS);
+
+#endif
+
+    if ((rce_flags & RCE_REUSEPORT_SHARDING) && start_shards(socket, rce_flags) != RTP_OK) {
+        UVG_LOG_WARN("RCE_REUSEPORT_SHARDING could not be enabled, receiving with one thread");
+    }
+
+    active_ = true;
+    return RTP_ERROR::RTP_OK;
+}
+
+rtp_error_t uvgrtp::reception_flow::start_shards(std::shared_ptr<uvgrtp::socket> socket, int rce_flags)
+{
+    /* SO_REUSEPORT is only set on sockets created by a stream with the flag. Multicast sockets never have it
+     * because every socket of the group would get a copy of each packet */
+    if (!socket->reuseport_enabled()) {
+        return RTP_NOT_SUPPORTED;
+    }
+
+    sockaddr_in addr = {};
+    sockaddr_in6 addr6 = {};
+    rtp_error_t ret = RTP_OK;
+
+    if ((ret = socket->get_local_address(addr, addr6)) != RTP_OK) {
+        return ret;
+    }
+
+    unsigned shards = std::min(std::max(std::thread::hardware_concurrency(), MIN_RECEIVE_SHARDS), MAX_RECEIVE_SHARDS);
+    int buf_size = rcv_buf_size_ > 0 ? rcv_buf_size_ : 4 * 1024 * 1024;
+
+    // "socket" is the first socket of the SO_REUSEPORT group
+    for (unsigned i = 1; i < shards; ++i) {
+        std::shared_ptr<uvgrtp::socket> shard_socket = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+
+        if ((ret = shard_socket->init(ipv6_ ? AF_INET6 : AF_INET, SOCK_DGRAM, 0)) != RTP_OK ||
+            (ret = shard_socket->enable_reuseport()) != RTP_OK ||
+            (ret = ipv6_ ? shard_socket->bind_ip6(addr6) : shard_socket->bind(addr)) != RTP_OK ||
+            (ret = shard_socket->setsockopt(SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, sizeof(int))) != RTP_OK) {
+            break;
+        }
+
+        std::unique_ptr<uvgrtp::reception_flow> shard(new uvgrtp::reception_flow(ipv6_));
+        shard->owner_ = this;
+        shard->socket_ = shard_socket;
+        shard->poll_timeout_ms_ = poll_timeout_ms_;
+        shard->recv_batch_size_ = recv_batch_size_;
+        shard->overflow_policy_ = overflow_policy_;
+        shard->max_buffer_size_ = max_buffer_size_;
+        shard->run_to_completion_ = run_to_completion_.load();
+        shard->buffer_size_kbytes_ = buffer_size_kbytes_;
+        shard->payload_size_ = payload_size_;
+        shard->huge_pages_ = huge_pages_;
+        shard->receive_zero_copy_ = receive_zero_copy_;
+
+        shards_.push_back(std::move(shard));
+    }
+
+    if (shards_.empty()) {
+        return ret;
+    }
+
+    if (socket->steer_reuseport_by_ssrc((unsigned)shards_.size() + 1) != RTP_OK) {
+        UVG_LOG_WARN("Packets are given to the receive threads by the address of the sender instead of the SSRC");
+    }
+
+    for (auto& shard : shards_) {
+        shard->start(shard->socket_, rce_flags & ~RCE_REUSEPORT_SHARDING, reactor_);
+    }
+
+    UVG_LOG_INFO("Receiving with %zu sockets", shards_.size() + 1);
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::reception_flow::stop()
+{    
+    std::lock_guard<std::mutex> lg(active_mutex_);
+    if (!active_) {
+        return RTP_OK;
+    }
+    for (auto& shard : shards_) {
+        shard->stop();
+    }
+
+    if (reactor_) {
+        std::move(shards_.begin(), shards_.end(), std::back_inserter(stopped_shards_));
+    }
+    shards_.clear();
+
+    should_stop_ = true;
+    {
+        std::lock_guard<std::mutex> wlg(wait_mtx_);
+    }
+    process_cond_.notify_all();
+    {
+        std::lock_guard<std::mutex> rlg(ring_request_mutex_);
+    }
+    ring_request_cond_.notify_all();
+
+    // wake up the threads waiting in pull_frame()
+    {
+        std::lock_guard<std::mutex> hlg(handlers_mutex_);
+        for (auto& handlers : packet_handlers_) {
+            if (!handlers.second.frames)
+                continue;
+
+            {
+                std::lock_guard<std::mutex> qlg(handlers.second.frames->mutex);
+            }
+            handlers.second.frames->cond.notify_all();
+        }
+    }
+
+    if (reactor_) {
+        /* waits until the reactor is done with the socket, except from a callback of another
+         * reactor thread, in which case the reactor keeps this flow alive until the running
+         * callback returns */
+        reactor_->remove_socket(socket_->get_raw_socket());
+
+        std::lock_guard<std::mutex> rlg(ring_mutex_);
+        reactor_ = nullptr;
+    }
+
+    if (receiver_ != nullptr && receiver_->joinable())
+    {
+        receiver_->join();
+    }
+
+    if (processor_ != nullptr && processor_->joinable())
+    {
+        processor_->join();
+    }
+
+    {
+        // if the flow is started again, its receiver starts with an empty ring of its own size
+        std::lock_guard<std::mutex> rlg(ring_mutex_);
+        uring_.reset();
+        ring_changed_ = true;
+    }
+
+    clear_frames();
+    active_ = false;
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::reception_flow::install_receive_hook(
+    void *arg,
+    void (*hook)(void *, uvgrtp::frame::rtp_frame *),
+    uint32_t remote_ssrc
+)
+{
+    if (!hook)
+        return RTP_INVALID_VALUE;
+
+    std::scoped_lock hlg(hooks_mutex_, handlers_mutex_);
+    receive_pkt_hook new_hook = { arg, hook };
+    hooks_[remote_ssrc] = new_hook;
+    publish_dispatch_table();
+
+    return RTP_OK;
+}
+
+uvgrtp::frame::rtp_frame* uvgrtp::reception_flow::pull_frame(ssize_t timeout_ms, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
+{
+    std::shared_ptr<receive_queue> queue = get_receive_queue(remote_ssrc.get()->load());
+    if (!queue)
+        return nullptr;
+
+    std::unique_lock<std::mutex> lk(queue->mutex);
+
+    if (!wait_frames(*queue, lk, timeout_ms))
+        return nullptr;
+
+    uvgrtp::frame::rtp_frame* frame = queue->frames.front();
+    queue->frames.pop_front();
+    return frame;
+}
+
+size_t uvgrtp::reception_flow::pull_frames(std::vector<uvgrtp::frame::rtp_frame*>& frames, size_t max_frames,
+    ssize_t timeout_ms, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
+{
+    std::shared_ptr<receive_queue> queue = get_receive_queue(remote_ssrc.get()->load());
+    if (!queue)
+        return 0;
+
+    std::unique_lock<std::mutex> lk(queue->mutex);
+
+    if (!wait_frames(*queue, lk, timeout_ms))
+        return 0;
+
+    size_t pulled = std::min(max_frames, queue->frames.size());
+    frames.insert(frames.end(), queue->frames.begin(), queue->frames.begin() + pulled);
+    queue->frames.erase(queue->frames.begin(), queue->frames.begin() + pulled);
+    return pulled;
+}
+
+std::shared_ptr<uvgrtp::receive_queue> uvgrtp::reception_flow::get_receive_queue(uint32_t remote_ssrc)
+{
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    auto it = packet_handlers_.find(remote_ssrc);
+
+    if (it == packet_handlers_.end())
+        return nullptr;
+
+    return it->second.frames;
+}
+
+bool uvgrtp::reception_flow::wait_frames(receive_queue& queue, std::unique_lock<std::mutex>& lk, ssize_t timeout_ms)
+{
+    auto ready = [this, &queue]() {
+        return should_stop_ || queue.closed || !queue.frames.empty();
+    };
+
+    if (timeout_ms < 0) {
+        queue.cond.wait(lk, ready);
+    }
+    else if (!queue.cond.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready)) {
+        return false;
+    }
+    return !should_stop_ && !queue.closed;
+}
+
+rtp_error_t uvgrtp::reception_flow::install_handler(int type, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc,
+    std::function<rtp_error_t(void*, int, uint8_t*, size_t, frame::rtp_frame** out)> handler, void* args)
+{
+    uint32_t ssrc = remote_ssrc.get()->load();
+    std::scoped_lock hlg(hooks_mutex_, handlers_mutex_);
+    if (!packet_handlers_[ssrc].frames) {
+        packet_handlers_[ssrc].frames = std::make_shared<receive_queue>();
+    }
+
+    switch (type) {
+        case 1: {
+            packet_handlers_[ssrc].rtp.handler = handler;
+            packet_handlers_[ssrc].rtp.args = args;
+            break;
+        }
+        case 2: {
+            packet_handlers_[ssrc].rtcp.handler = handler;
+            packet_handlers_[ssrc].rtcp.args = args;
+            break;
         }
         case 3: {
             packet_handlers_[ssrc].zrtp.handler = handler;
@@ -338,54 +920,98 @@ rtp_error_t uvgrtp::reception_flow::install_handler(int type, std::shared_ptr<st
             break;
         }
     }
-    handlers_mutex_.unlock();
+    publish_dispatch_table();
     return RTP_OK;
 }
 
 rtp_error_t uvgrtp::reception_flow::install_getter(std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc,
     std::function<rtp_error_t(uvgrtp::frame::rtp_frame**)> getter)
 {
-    handlers_mutex_.lock();
+    std::scoped_lock hlg(hooks_mutex_, handlers_mutex_);
     packet_handlers_[remote_ssrc.get()->load() ].getter = getter;
-    handlers_mutex_.unlock();
+    publish_dispatch_table();
     return RTP_OK;
 }
 
 rtp_error_t uvgrtp::reception_flow::remove_handlers(std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
 {
-    std::lock_guard<std::mutex> lg(handlers_mutex_);
-    size_t removed = packet_handlers_.erase(remote_ssrc.get()->load());
-    if (removed == 1) {
-        return RTP_OK;
+    std::scoped_lock hlg(hooks_mutex_, handlers_mutex_);
+    auto it = packet_handlers_.find(remote_ssrc.get()->load());
+    if (it == packet_handlers_.end()) {
+        return RTP_INVALID_VALUE;
+    }
+
+    close_receive_queue(it->second);
+    packet_handlers_.erase(it);
+    publish_dispatch_table();
+    return RTP_OK;
+}
+
+void uvgrtp::reception_flow::publish_dispatch_table()
+{
+    std::shared_ptr<dispatch_table> table = std::make_shared<dispatch_table>();
+    table->handlers = packet_handlers_;
+    table->hooks = hooks_;
+
+    std::atomic_store(&dispatch_table_, std::shared_ptr<const dispatch_table>(std::move(table)));
+}
+
+void uvgrtp::reception_flow::close_receive_queue(handler& handlers)
+{
+    if (!handlers.frames)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lg(handlers.frames->mutex);
+        handlers.frames->closed = true;
     }
-    return RTP_INVALID_VALUE;
+    handlers.frames->cond.notify_all();
 }
 
-void uvgrtp::reception_flow::return_frame(uvgrtp::frame::rtp_frame *frame)
+void uvgrtp::reception_flow::return_frame(uvgrtp::frame::rtp_frame *frame, const handler& handlers,
+    const dispatch_table& table)
 {
+    const std::unordered_map<uint32_t, receive_pkt_hook>& hooks = table.hooks;
+
     uint32_t ssrc = frame->header.ssrc;
 
     // 1. Check if there is only one hook installed -> no socket muxing
     // 2. Multiple handlers -> check if there exists a hook that this ssrc belongs to
     // 3. If neither is found, push the frame to the queue
-    if (hooks_.size() == 1) {
+    if (hooks.size() == 1) {
         /* No socket multiplexing: All packets are given to this hook */
-        receive_pkt_hook pkt_hook = hooks_.begin()->second;
+        receive_pkt_hook pkt_hook = hooks.begin()->second;
         recv_hook hook = pkt_hook.hook;
         void* arg = pkt_hook.arg;
         hook(arg, frame);
     }
-    else if (hooks_.find(ssrc) != hooks_.end()) {
+    else if (auto it = hooks.find(ssrc); it != hooks.end()) {
         /* Socket multiplexing: Hook found */
-        receive_pkt_hook pkt_hook = hooks_[ssrc];
+        receive_pkt_hook pkt_hook = it->second;
         recv_hook hook = pkt_hook.hook;
         void* arg = pkt_hook.arg;
         hook(arg, frame);
     }
+    else if (handlers.frames) {
+        receive_queue& queue = *handlers.frames;
+        {
+            std::lock_guard<std::mutex> lg(queue.mutex);
+
+            /* a stream that does not pull its frames must not hold up the other streams of the socket */
+            if (queue.frames.size() >= MAX_QUEUED_FRAMES) {
+                if (!queue.overflowed) {
+                    UVG_LOG_WARN("Frame queue of remote SSRC %u is full, dropping the oldest frames", frame->header.ssrc);
+                    queue.overflowed = true;
+                }
+                (void)uvgrtp::frame::dealloc_frame(queue.frames.front());
+                queue.frames.pop_front();
+            }
+            queue.frames.push_back(frame);
+        }
+        queue.cond.notify_one();
+    }
     else {
-        frames_mtx_.lock();
-        frames_.push_back(frame);
-        frames_mtx_.unlock();
+        (void)uvgrtp::frame::dealloc_frame(frame);
     }
 }
 /* User packets disabled for now
@@ -415,7 +1041,7 @@ void uvgrtp::reception_flow::return_user_pkt(uint8_t* pkt, uint32_t len)
     }
 }
 */
-void uvgrtp::reception_flow::receiver(std::shared_ptr<uvgrtp::socket> socket)
+void uvgrtp::reception_flow::receiver(std::shared_ptr<uvgrtp::socket> socket, int rce_flags)
 {
     int read_packets = 0;
 
@@ -448,49 +1074,56 @@ void uvgrtp::reception_flow::receiver(std::shared_ptr<uvgrtp::socket> socket)
             break;
         }
 
+#ifndef _WIN32
+        /* pending zero-copy completions of a socket that is also used for sending make poll() return */
+        if ((pfds->revents & POLLERR) && socket->zerocopy_enabled()) {
+            (void)socket->get_zerocopy_completed();
+        }
+#endif
+
         if (pfds->revents & POLLIN) {
 
+            {
+                std::lock_guard<std::mutex> lg(ring_mutex_);
+                (void)update_ring_buffer();
+            }
+
             // we write as many packets as socket has in the buffer
             while (!should_stop_)
             {
-                ssize_t next_write_index = next_buffer_location(last_ring_write_index_);
-
-                //increase_buffer_size(next_write_index);
-
-                rtp_error_t ret = RTP_OK;
-                //sockaddr_in sender = {};
-                //sockaddr_in6 sender6 = {};
-                
-                // get the potential packet
-                ret = socket->recvfrom(ring_buffer_[next_write_index].data, payload_size_,
-                    MSG_DONTWAIT, &ring_buffer_[next_write_index].read);
+                int msgs_read = 0;
 
+                // get the potential packets
+                rtp_error_t ret = read_batch(socket, msgs_read);
 
                 if (ret == RTP_INTERRUPTED)
                 {
                     break;
                 }
-                else if (ring_buffer_[next_write_index].read == 0)
-                {
-                    UVG_LOG_WARN("Failed to read anything from socket");
-                    break;
-                }
                 else if (ret != RTP_OK) {
-                    UVG_LOG_ERROR("recvfrom(2) failed! Reception flow cannot continue %d!", ret);
+                    UVG_LOG_ERROR("recvmmsg(2) failed! Reception flow cannot continue %d!", ret);
                     should_stop_ = true;
                     break;
                 }
+                else if (msgs_read == 0)
+                {
+                    UVG_LOG_WARN("Failed to read anything from socket");
+                    break;
+                }
 
-                ++read_packets;
-                // Save the IP adderss that this packet came from into the buffer
-                //ring_buffer_[next_write_index].from6 = sender6;
-                //ring_buffer_[next_write_index].from = sender;
-                // finally we update the ring buffer so processing (reading) knows that there is a new frame
-                last_ring_write_index_ = next_write_index;
+                read_packets += msgs_read;
+
+                // process the batch right here instead of handing it to the processing thread
+                if (run_to_completion_) {
+                    std::lock_guard<std::mutex> plg(process_mutex_);
+                    (void)process_available(rce_flags);
+                }
             }
 
             // start processing the packets by waking the processing thread
-            process_cond_.notify_one();
+            if (!run_to_completion_) {
+                wake_processor();
+            }
         }
 
         if (pfds)
@@ -503,6 +1136,310 @@ void uvgrtp::reception_flow::receiver(std::shared_ptr<uvgrtp::socket> socket)
     UVG_LOG_DEBUG("Total read packets from buffer: %li", read_packets);
 }
 
+rtp_error_t uvgrtp::reception_flow::read_batch(std::shared_ptr<uvgrtp::socket>& socket, int& msgs_read, size_t max_reads)
+{
+    size_t free = free_slots();
+
+    if (free == 0) {
+        // the processing thread may not know yet that there are packets waiting
+        wake_processor();
+
+        if (!make_room()) {
+            return drop_batch(socket, msgs_read);
+        }
+        free = free_slots();
+    }
+
+    ssize_t next_write_index = next_buffer_location(last_ring_write_index_);
+
+    // a single batch never wraps around the end of the ring buffer
+    size_t batch_size = std::min({ (size_t)recv_batch_size_, max_reads, ring_buffer_.size() - (size_t)next_write_index, free });
+    if (batch_bufs_.size() < batch_size) {
+        batch_bufs_.resize(batch_size);
+        batch_lens_.resize(batch_size);
+        batch_segments_.resize(batch_size);
+    }
+
+    /* A slot whose buffer frames still point to is only written once it has a buffer of its own. If
+     * the processing thread could not give it one, the frames of the application hold every buffer */
+    for (size_t i = 0; i < batch_size; ++i) {
+        if (!recycle_slot(next_write_index + i)) {
+            batch_size = i;
+            break;
+        }
+        batch_bufs_[i] = slot_data(next_write_index + i);
+    }
+
+    if (batch_size == 0) {
+        if (!out_of_buffers_) {
+            UVG_LOG_WARN("All receive buffers are held by frames, dropping packets until frames are deallocated");
+            out_of_buffers_ = true;
+        }
+        return drop_batch(socket, msgs_read);
+    }
+    out_of_buffers_ = false;
+
+    msgs_read = 0;
+    rtp_error_t ret = socket->recvmmsg(batch_bufs_.data(), slot_size(), batch_lens_.data(), batch_segments_.data(),
+        batch_size, MSG_DONTWAIT, &msgs_read);
+
+    if (ret != RTP_OK) {
+        return ret;
+    }
+
+    for (int i = 0; i < msgs_read; ++i) {
+        ring_buffer_[next_write_index + i].gso_size = batch_segments_[i];
+        ring_buffer_[next_write_index + i].read = batch_lens_[i];
+        received_packets_ += packets_in_slot(batch_lens_[i], batch_segments_[i]);
+    }
+
+    // finally we update the ring buffer so processing (reading) knows that there are new frames
+    if (msgs_read > 0) {
+        last_ring_write_index_ = next_write_index + msgs_read - 1;
+    }
+    return RTP_OK;
+}
+
+void uvgrtp::reception_flow::receive_ready(std::shared_ptr<uvgrtp::socket>& socket, int rce_flags)
+{
+#ifndef _WIN32
+    /* pending zero-copy completions of a socket that is also used for sending wake the reactor */
+    if (socket->zerocopy_enabled()) {
+        (void)socket->get_zerocopy_completed();
+    }
+#endif
+
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    (void)update_ring_buffer();
+
+    int msgs_read = 0;
+    rtp_error_t ret = read_batch(socket, msgs_read);
+
+    if (ret == RTP_OK) {
+        (void)process_available(rce_flags);
+    }
+    else if (ret != RTP_INTERRUPTED) {
+        UVG_LOG_ERROR("recvmmsg(2) failed! Reception flow cannot continue %d!", ret);
+        reactor_->remove_socket(socket->get_raw_socket());
+    }
+}
+
+int uvgrtp::reception_flow::poll_once(size_t max_reads, int rce_flags)
+{
+    if (!reactor_ || reactor_->get_threads() != 0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    (void)update_ring_buffer();
+
+    int reads = 0;
+
+    while ((size_t)reads < max_reads) {
+        int msgs_read = 0;
+        rtp_error_t ret = read_batch(socket_, msgs_read, max_reads - (size_t)reads);
+
+        if (ret == RTP_INTERRUPTED || (ret == RTP_OK && msgs_read == 0)) {
+            break;
+        }
+        else if (ret != RTP_OK) {
+            UVG_LOG_ERROR("recvmmsg(2) failed! %d", ret);
+            return -1;
+        }
+
+        reads += msgs_read;
+        (void)process_available(rce_flags);
+    }
+
+    return reads;
+}
+
+rtp_error_t uvgrtp::reception_flow::start_uring()
+{
+#ifdef UVGRTP_HAVE_IO_URING
+    std::lock_guard<std::mutex> lg(ring_mutex_);
+    std::unique_ptr<uvgrtp::uring> ring(new uvgrtp::uring());
+    rtp_error_t ret = RTP_OK;
+
+    if ((ret = ring->init(URING_RECV_ENTRIES)) != RTP_OK)
+        return ret;
+
+    /* The buffer ring is registered by receiver_uring() once it has created the ring buffer. Check
+     * here that the kernel supports it so that the stream falls back to recvmmsg() right away */
+    if ((ret = ring->register_buffer_ring(URING_BUFFER_GROUP, 1)) != RTP_OK)
+        return ret;
+    ring->unregister_buffer_ring();
+
+    uring_ = std::move(ring);
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("io_uring is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+void uvgrtp::reception_flow::receiver_uring(std::shared_ptr<uvgrtp::socket> socket, int rce_flags)
+{
+#ifdef UVGRTP_HAVE_IO_URING
+    int read_packets = 0;
+    int fd = socket->get_raw_socket();
+    bool armed = false;
+    bool fall_back = false;
+
+    // number of ring buffer slots the kernel can write to and the slot that was last given back
+    size_t available = 0;
+
+    // the kernel ran out of slots, receive again once more slots have been given back
+    bool starved = false;
+    ssize_t returned = -1;
+
+    while (!should_stop_) {
+
+        if (ring_changed_) {
+            /* the kernel must be done with the old ring before it is freed */
+            if (armed) {
+                cancel_receive(*uring_, poll_timeout_ms_);
+                armed = false;
+            }
+            uring_->unregister_buffer_ring();
+
+            std::lock_guard<std::mutex> lg(ring_mutex_);
+            (void)update_ring_buffer();
+            returned = -1;
+
+            if (uring_->register_buffer_ring(URING_BUFFER_GROUP, (unsigned)ring_buffer_.size()) != RTP_OK) {
+                fall_back = true;
+                break;
+            }
+        }
+
+        if (returned == -1) {
+            /* give the whole ring buffer to the kernel. It fills the slots in order
+             * so the packets end up in the ring just like with recvmmsg() */
+            for (size_t i = 0; i < ring_buffer_.size(); ++i) {
+                uring_->provide_buffer(slot_data(i), (unsigned)slot_size(), (uint16_t)i);
+            }
+            uring_->publish_buffers();
+
+            available = ring_buffer_.size();
+            returned  = (ssize_t)ring_buffer_.size() - 1;
+            starved   = false;
+        }
+        else if (available < ring_buffer_.size()) {
+            /* The processing thread is done with the slots it has moved past. The slot it is at is
+             * never given back, otherwise the kernel could fill the whole ring and the write index
+             * would catch up with the read index */
+            ssize_t read_index = ring_read_index_;
+            bool provided = false;
+
+            while (read_index != -1 && available < ring_buffer_.size()) {
+                ssize_t slot = next_buffer_location(returned);
+
+                // frames still point into the buffer of the slot and there is no buffer to replace it
+                if (slot == read_index || !recycle_slot(slot)) {
+                    break;
+                }
+
+                uring_->provide_buffer(slot_data(slot), (unsigned)slot_size(), (uint16_t)slot);
+                returned = slot;
+                ++available;
+                provided = true;
+            }
+
+            if (provided) {
+                uring_->publish_buffers();
+                starved = false;
+            }
+        }
+
+        if (!armed && !starved && available > 0) {
+            if (uring_->recv_multishot(fd, URING_BUFFER_GROUP, URING_RECV_ID) != RTP_OK) {
+                UVG_LOG_ERROR("Failed to queue io_uring receive! Reception flow cannot continue");
+                should_stop_ = true;
+                break;
+            }
+            armed = true;
+        }
+
+        // without a receive the processing thread is expected to free slots soon
+        rtp_error_t ret = uring_->wait(armed ? poll_timeout_ms_ : 1);
+
+        if (ret != RTP_OK && ret != RTP_INTERRUPTED) {
+            UVG_LOG_ERROR("Waiting for io_uring completions failed! Reception flow cannot continue");
+            should_stop_ = true;
+            break;
+        }
+
+        bool received = false;
+        struct io_uring_cqe cqe;
+
+        while (uring_->next_completion(cqe)) {
+            if (cqe.user_data != URING_RECV_ID) {
+                continue;
+            }
+
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                armed = false;
+            }
+
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                ssize_t slot = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+                ring_buffer_[slot].gso_size = 0;
+                ring_buffer_[slot].read = std::max(cqe.res, 0);
+                last_ring_write_index_ = slot;
+                ++received_packets_;
+
+                --available;
+                ++read_packets;
+                received = true;
+            }
+            else if (cqe.res == -EINVAL && read_packets == 0) {
+                // multishot receives need Linux 6.0
+                fall_back = true;
+            }
+            else if (cqe.res == -ENOBUFS) {
+                starved = true;
+            }
+            else if (cqe.res < 0) {
+                UVG_LOG_ERROR("io_uring receive failed: %s! Reception flow cannot continue", strerror(-cqe.res));
+                should_stop_ = true;
+            }
+        }
+
+        if (received && run_to_completion_) {
+            std::lock_guard<std::mutex> plg(process_mutex_);
+            (void)process_available(rce_flags);
+        }
+        else if (received) {
+            // start processing the packets by waking the processing thread
+            wake_processor();
+        }
+
+        if (fall_back) {
+            break;
+        }
+    }
+
+    if (armed) {
+        cancel_receive(*uring_, poll_timeout_ms_);
+    }
+
+    UVG_LOG_DEBUG("Total read packets from io_uring: %li", read_packets);
+
+    if (fall_back && !should_stop_) {
+        UVG_LOG_WARN("io_uring multishot receive is not supported, receiving packets with recvmmsg()");
+        {
+            std::lock_guard<std::mutex> lg(ring_mutex_);
+            uring_.reset();
+        }
+        receiver(socket, rce_flags);
+    }
+#else
+    receiver(socket, rce_flags);
+#endif
+}
+
 void uvgrtp::reception_flow::process_packet(int rce_flags)
 {
     std::unique_lock<std::mutex> lk(wait_mtx_);
@@ -512,164 +1449,256 @@ void uvgrtp::reception_flow::process_packet(int rce_flags)
     while (!should_stop_)
     {
         // go to sleep waiting for something to process
-        process_cond_.wait(lk); 
+        process_cond_.wait(lk, [this] { return should_stop_ || has_work(); });
 
         if (should_stop_)
         {
             break;
         }
 
-        // process all available reads in one go
-        while (ring_read_index_ != last_ring_write_index_)
+        // process all available reads in one go. The receiver must be able to wake us meanwhile
+        lk.unlock();
         {
-            // first update the read location
-            ring_read_index_ = next_buffer_location(ring_read_index_);
+            std::lock_guard<std::mutex> plg(process_mutex_);
+            processed_packets += process_available(rce_flags);
+        }
+        lk.lock();
+    }
 
-            if (ring_buffer_[ring_read_index_].read > 0)
+    UVG_LOG_DEBUG("Total processed packets: %li", processed_packets);
+}
+
+void uvgrtp::reception_flow::wake_processor()
+{
+    /* the processing thread is either before its check of has_work() or waiting,
+     * so the wakeup cannot fall between the two */
+    {
+        std::lock_guard<std::mutex> lg(wait_mtx_);
+    }
+    process_cond_.notify_one();
+}
+
+bool uvgrtp::reception_flow::has_work() const
+{
+    return ring_read_index_ != last_ring_write_index_ || ring_request_ != RING_NO_REQUEST;
+}
+
+int uvgrtp::reception_flow::process_available(int rce_flags)
+{
+    int processed_packets = 0;
+    std::shared_ptr<const dispatch_table> table;
+    ssize_t batch_end = ring_read_index_;
+
+    while (true)
+    {
+        // the receiver may be waiting for room in the full ring buffer
+        serve_ring_request();
+
+        if (ring_read_index_ == last_ring_write_index_)
+        {
+            // the receiver may be waiting to replace the ring buffer
             {
-                /* When processing a packet, the following checks are done
-                 * 1. If there is only a single set of handlers installed, there is no socket multiplexing. All packets
-                 *    to to this handler
-                 * 2. Check the SSRC of the packets. This field is in the same place for RTP and ZRTP, octets 8-11. For RTCP, it is
-                 *    in octets 4-7
-                 * 3. If there is no SSRC match for any of the handlers, this either a holepuncher or a user packet.
-                 * 4. SSRC match found -> Determine which protocol this packet belongs to. RTCP packets can be told apart from RTP packets via 
-                 *    bits 8-15. ZRTP packets can be told apart from others via their 2 first bits being 0 and the Magic Cookie
-                 *    field being 0x5a525450. Holepuncher packets contain 0x00 payload. However, holepunching is
-                 *    not needed if RTCP is enabled. 
-                 * 5. After determining the correct protocol, hand out the packet to the correct handler(s) if it exists. */
-                
-                uint8_t* ptr = (uint8_t*)ring_buffer_[ring_read_index_].data;
-                //sockaddr_in from = ring_buffer_[ring_read_index_].from;
-                //sockaddr_in6 from6 = ring_buffer_[ring_read_index_].from6;
-                uint32_t rtp_ssrc = ntohl(*(uint32_t*)&ptr[8]);
-                uint32_t rtcp_ssrc = ntohl(*(uint32_t*)&ptr[4]);
-                bool rtcp_pkt = false;
-
-                handler* handlers = nullptr;
-                if (packet_handlers_.size() == 1) {
-                    /* No socket multiplexing: All packets are given to this handler */
-                    handlers = &packet_handlers_.begin()->second;
-                }
-                else if (packet_handlers_.find(rtcp_ssrc) != packet_handlers_.end()) {
-                    /* Socket multiplexing: RTCP packet */
-                    handlers = &packet_handlers_[rtcp_ssrc];
-                    rtcp_pkt = true;
-                }
-                else if (packet_handlers_.find(rtp_ssrc) != packet_handlers_.end()) {
-                    /* Socket multiplexing: RTP/ZRTP packet */
-                    handlers = &packet_handlers_[rtp_ssrc];
-                }
-                size_t size = (size_t)ring_buffer_[ring_read_index_].read;
-                uint8_t version = (*(uint8_t*)&ptr[0] >> 6) & 0x3;
-
-                if (handlers != nullptr) {
-                    /* SSRC match or SSRC 0 is found -> call handlers */
-                    rtp_error_t retval;
-                    uvgrtp::frame::rtp_frame* frame = nullptr;
-
-                    /* -------------------- Protocol checks -------------------- */
-                    /* Checks in the following order:
-                     * 1. SSRC is in octets 4-7                         -> RTCP packet
-                     * 2. Version 0 and Magic Cookie is 0x5a525450      -> ZRTP packet
-                     * 3. Version is 2                                  -> RTP packet     (or SRTP)
-                     * 4. Version is 3                                  -> Keep-Alive/Holepuncher 
-                     * 5. Otherwise                                     -> User packet, DISABLED */
-                    if (rtcp_pkt && (rce_flags & RCE_RTCP_MUX)) {
-                        uint8_t pt = (uint8_t)ptr[1]; // Packet type
-                        if (pt >= 200 && pt <= 204) {
-                            if (handlers->rtcp.handler != nullptr) {
-                                retval = handlers->rtcp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
-                            }
-                        }
-                    }
-                    // Magic Cookie 0x5a525450
-                    else if (version == 0x0 && ntohl(*(uint32_t*)&ptr[4]) == 0x5a525450) {
-                        if (handlers->zrtp.handler != nullptr) {
-                            retval = handlers->zrtp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
-                        }
-                    }
-                    else if (version == 0x2) {
-                        retval = RTP_PKT_MODIFIED;
-
-                        /* Create RTP header */
-                        if (handlers->rtp.handler != nullptr) {
-                            retval = handlers->rtp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
-                        }
-                        else {
-                            /* Received a packet but RTP handler is not installed.
-                             * This should only happen when ZRTP is enabled. If the remote stream is done first, they start sending
-                             * media already before we have handled the last ZRTP ConfACK packet. This should not be a problem
-                             * as we only lose the first frame or a few at worst. If this causes issues, the sender
-                             * may, for example, sleep for 50 or so milliseconds to give us time to complete ZRTP negotiation. */
-                            UVG_LOG_DEBUG("RTP handler is not (yet?) installed");
-                        }
-
-                        /* If SRTP is enabled -> send through SRTP handler */
-                        if (rce_flags & RCE_SRTP && retval == RTP_PKT_MODIFIED) {
-                            if (handlers->srtp.handler != nullptr) {
-                                retval = handlers->srtp.handler(handlers->srtp.args, rce_flags, &ptr[0], size, &frame);
-                            }
-                        }
-                        /* Update RTCP session statistics */
-                        if (rce_flags & RCE_RTCP) {
-                            if (handlers->rtcp_common.handler != nullptr) {
-                                retval = handlers->rtcp_common.handler(handlers->rtcp_common.args, rce_flags, &ptr[0], size, &frame);
-                            }
-                        }
-
-                        /* If packet is ok, hand over to media handler */
-                        if (retval == RTP_PKT_MODIFIED || retval == RTP_PKT_NOT_HANDLED) {
-                            if (handlers->media.handler && frame) {
-                                retval = handlers->media.handler(handlers->media.args, rce_flags, &ptr[0], size, &frame);
-                            }
-                            /* Last, if one or more packets are ready, return them to the user */
-                            if (retval == RTP_PKT_READY) {
-                                return_frame(frame);
-                            }
-                            else if (retval == RTP_MULTIPLE_PKTS_READY && handlers->getter != nullptr) {
-                                while (handlers->getter(&frame) == RTP_PKT_READY) {
-                                    return_frame(frame);
-                                }
-                            }
-                        }
-                    }
-                    /* No SSRC match found -> Holepuncher or user packet */
-                    else if (version == 0x3) {
-                        UVG_LOG_DEBUG("Holepuncher packet");
-                    }
-                    /* DISABLED else {
-                        return_user_pkt(&ptr[0], (uint32_t)size);
-                    }*/
-                }
-                else {
-                    /* No SSRC match found -> Holepuncher or user packet */
-                    if (version == 0x3) {
-                        UVG_LOG_DEBUG("Holepuncher packet");
-                    }
-                    /* DISABLED else {
-                        return_user_pkt(&ptr[0], (uint32_t)size);
-                    }*/
-                }
-                // to make sure we don't process this packet again
-                ring_buffer_[ring_read_index_].read = 0;
+                std::lock_guard<std::mutex> lg(ring_request_mutex_);
+            }
+            ring_request_cond_.notify_all();
+            break;
+        }
+
+        // the packets written so far are dispatched with the same table
+        if (ring_read_index_ == batch_end) {
+            batch_end = last_ring_write_index_;
+            table = owner_->load_dispatch_table();
+        }
+
+        // first update the read location
+        ring_read_index_ = next_buffer_location(ring_read_index_);
+
+        if (ring_buffer_[ring_read_index_].read > 0)
+        {
+            uint8_t* data = slot_data(ring_read_index_);
+            size_t size = (size_t)ring_buffer_[ring_read_index_].read;
+            size_t segment_size = (size_t)ring_buffer_[ring_read_index_].gso_size;
+            uvgrtp::pool_buffer* owner = ring_owners_.empty() ? nullptr : ring_owners_[ring_read_index_];
+
+            /* With UDP GRO, one slot may hold several datagrams of "segment_size" bytes
+             * back to back, the last one possibly shorter. They are handed out in place */
+            if (segment_size == 0 || segment_size > size) {
+                segment_size = size;
+            }
+
+            for (size_t offset = 0; offset < size; offset += segment_size) {
+                owner_->dispatch_packet(*table, data + offset, std::min(segment_size, size - offset), rce_flags, owner);
                 ++processed_packets;
             }
-            else
-            {
+
+            /* to make sure we don't process this packet again. After this, the receiver
+             * may free the slot if the ring is recreated. If there is no buffer to replace
+             * the one the frames hold, the receiver tries again before writing to the slot */
+            (void)recycle_slot(ring_read_index_);
+            ring_buffer_[ring_read_index_].read = 0;
+        }
+        else
+        {
 #ifndef NDEBUG 
 #ifndef __RTP_SILENT__
-                ssize_t write = last_ring_write_index_;
-                ssize_t read = ring_read_index_;
-                UVG_LOG_DEBUG("Found invalid frame in read buffer: %li. R: %lli, W: %lli", 
-                    ring_buffer_[ring_read_index_].read, read, write);
+            ssize_t write = last_ring_write_index_;
+            ssize_t read = ring_read_index_;
+            UVG_LOG_DEBUG("Found invalid frame in read buffer: %li. R: %lli, W: %lli", 
+                ring_buffer_[ring_read_index_].read, read, write);
 #endif
 #endif
-            }
         }
     }
 
-    UVG_LOG_DEBUG("Total processed packets: %li", processed_packets);
+    return processed_packets;
+}
+
+std::shared_ptr<const uvgrtp::dispatch_table> uvgrtp::reception_flow::load_dispatch_table() const
+{
+    return std::atomic_load(&dispatch_table_);
+}
+
+void uvgrtp::reception_flow::dispatch_packet(const dispatch_table& table, uint8_t* ptr, size_t size, int rce_flags,
+    uvgrtp::pool_buffer* buffer)
+{
+    /* When processing a packet, the following checks are done
+     * 1. If there is only a single set of handlers installed, there is no socket multiplexing. All packets
+     *    to to this handler
+     * 2. Check the SSRC of the packets. This field is in the same place for RTP and ZRTP, octets 8-11. For RTCP, it is
+     *    in octets 4-7
+     * 3. If there is no SSRC match for any of the handlers, this either a holepuncher or a user packet.
+     * 4. SSRC match found -> Determine which protocol this packet belongs to. RTCP packets can be told apart from RTP packets via 
+     *    bits 8-15. ZRTP packets can be told apart from others via their 2 first bits being 0 and the Magic Cookie
+     *    field being 0x5a525450. Holepuncher packets contain 0x00 payload. However, holepunching is
+     *    not needed if RTCP is enabled. 
+     * 5. After determining the correct protocol, hand out the packet to the correct handler(s) if it exists. */
+    
+    uint32_t rtp_ssrc = ntohl(*(uint32_t*)&ptr[8]);
+    uint32_t rtcp_ssrc = ntohl(*(uint32_t*)&ptr[4]);
+    bool rtcp_pkt = false;
+
+    /* The handlers are looked up from a table that is never modified, so the streams may install and
+     * remove their handlers while packets are being dispatched. With RCE_REUSEPORT_SHARDING, the
+     * processing threads of the shards dispatch packets at the same time */
+    const std::unordered_map<uint32_t, handler>& table_handlers = table.handlers;
+
+    const handler* handlers = nullptr;
+    if (table_handlers.size() == 1) {
+        /* No socket multiplexing: All packets are given to this handler */
+        handlers = &table_handlers.begin()->second;
+    }
+    else if (auto rtcp_it = table_handlers.find(rtcp_ssrc); rtcp_it != table_handlers.end()) {
+        /* Socket multiplexing: RTCP packet */
+        handlers = &rtcp_it->second;
+        rtcp_pkt = true;
+    }
+    else if (auto rtp_it = table_handlers.find(rtp_ssrc); rtp_it != table_handlers.end()) {
+        /* Socket multiplexing: RTP/ZRTP packet */
+        handlers = &rtp_it->second;
+    }
+    uint8_t version = (*(uint8_t*)&ptr[0] >> 6) & 0x3;
+
+    if (handlers != nullptr) {
+        /* SSRC match or SSRC 0 is found -> call handlers */
+        rtp_error_t retval;
+        uvgrtp::frame::rtp_frame* frame = nullptr;
+
+        /* -------------------- Protocol checks -------------------- */
+        /* Checks in the following order:
+         * 1. SSRC is in octets 4-7                         -> RTCP packet
+         * 2. Version 0 and Magic Cookie is 0x5a525450      -> ZRTP packet
+         * 3. Version is 2                                  -> RTP packet     (or SRTP)
+         * 4. Version is 3                                  -> Keep-Alive/Holepuncher 
+         * 5. Otherwise                                     -> User packet, DISABLED */
+        if (rtcp_pkt && (rce_flags & RCE_RTCP_MUX)) {
+            uint8_t pt = (uint8_t)ptr[1]; // Packet type
+            if (pt >= 200 && pt <= 204) {
+                if (handlers->rtcp.handler != nullptr) {
+                    retval = handlers->rtcp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
+                }
+            }
+        }
+        // Magic Cookie 0x5a525450
+        else if (version == 0x0 && ntohl(*(uint32_t*)&ptr[4]) == 0x5a525450) {
+            if (handlers->zrtp.handler != nullptr) {
+                retval = handlers->zrtp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
+            }
+        }
+        else if (version == 0x2) {
+            retval = RTP_PKT_MODIFIED;
+
+            /* Create RTP header */
+            if (handlers->rtp.handler != nullptr) {
+                retval = handlers->rtp.handler(nullptr, rce_flags, &ptr[0], size, &frame);
+
+                /* With RCC_RECEIVE_ZERO_COPY, the payload points into the ring buffer slot
+                 * and the frame keeps the slot's buffer from being reused until it is deallocated.
+                 * Streams of the socket that did not set it have copied the payload */
+                if (retval == RTP_PKT_MODIFIED && frame && payload_in_packet(frame, ptr, size)) {
+                    if (buffer) {
+                        uvgrtp::hold_buffer(buffer);
+                        frame->buffer = buffer;
+                    }
+                    else {
+                        frame->payload = (uint8_t*)memdup(frame->payload, frame->payload_len);
+                    }
+                }
+            }
+            else {
+                /* Received a packet but RTP handler is not installed.
+                 * This should only happen when ZRTP is enabled. If the remote stream is done first, they start sending
+                 * media already before we have handled the last ZRTP ConfACK packet. This should not be a problem
+                 * as we only lose the first frame or a few at worst. If this causes issues, the sender
+                 * may, for example, sleep for 50 or so milliseconds to give us time to complete ZRTP negotiation. */
+                UVG_LOG_DEBUG("RTP handler is not (yet?) installed");
+            }
+
+            /* If SRTP is enabled -> send through SRTP handler */
+            if (rce_flags & RCE_SRTP && retval == RTP_PKT_MODIFIED) {
+                if (handlers->srtp.handler != nullptr) {
+                    retval = handlers->srtp.handler(handlers->srtp.args, rce_flags, &ptr[0], size, &frame);
+                }
+            }
+            /* Update RTCP session statistics */
+            if (rce_flags & RCE_RTCP) {
+                if (handlers->rtcp_common.handler != nullptr) {
+                    retval = handlers->rtcp_common.handler(handlers->rtcp_common.args, rce_flags, &ptr[0], size, &frame);
+                }
+            }
+
+            /* If packet is ok, hand over to media handler */
+            if (retval == RTP_PKT_MODIFIED || retval == RTP_PKT_NOT_HANDLED) {
+                if (handlers->media.handler && frame) {
+                    retval = handlers->media.handler(handlers->media.args, rce_flags, &ptr[0], size, &frame);
+                }
+                /* Last, if one or more packets are ready, return them to the user */
+                if (retval == RTP_PKT_READY) {
+                    return_frame(frame, *handlers, table);
+                }
+                else if (retval == RTP_MULTIPLE_PKTS_READY && handlers->getter != nullptr) {
+                    while (handlers->getter(&frame) == RTP_PKT_READY) {
+                        return_frame(frame, *handlers, table);
+                    }
+                }
+            }
+        }
+        /* No SSRC match found -> Holepuncher or user packet */
+        else if (version == 0x3) {
+            UVG_LOG_DEBUG("Holepuncher packet");
+        }
+        /* DISABLED else {
+            return_user_pkt(&ptr[0], (uint32_t)size);
+        }*/
+    }
+    else {
+        /* No SSRC match found -> Holepuncher or user packet */
+        if (version == 0x3) {
+            UVG_LOG_DEBUG("Holepuncher packet");
+        }
+        /* DISABLED else {
+            return_user_pkt(&ptr[0], (uint32_t)size);
+        }*/
+    }
 }
 
 ssize_t uvgrtp::reception_flow::next_buffer_location(ssize_t current_location)
@@ -689,26 +1718,197 @@ ssize_t uvgrtp::reception_flow::next_buffer_location(ssize_t current_location)
     return (current_location + 1) % ring_buffer_.size();
 }
 
-void uvgrtp::reception_flow::increase_buffer_size(ssize_t next_write_index)
+size_t uvgrtp::reception_flow::free_slots() const
 {
-    // create new buffer spaces if the process/read hasn't freed any spots on the ring buffer
-    if (next_write_index == ring_read_index_)
-    {
-        // increase the buffer size by 25%
-        ssize_t increase = ring_buffer_.size() / 4;
-        if (increase == 0) // just so there is some increase
-            ++increase;
-
-        UVG_LOG_DEBUG("Reception buffer ran out, increasing the buffer size: %lli -> %lli",
-            ring_buffer_.size(), ring_buffer_.size() + increase);
-        for (unsigned int i = 0; i < increase; ++i)
-        {
-            ring_buffer_.insert(ring_buffer_.begin() + next_write_index, { new uint8_t[payload_size_] , -1 });
+    if (ring_buffer_.empty()) {
+        return 0;
+    }
+
+    /* -1 is the index before the first slot, i.e. the last one */
+    ssize_t size = (ssize_t)ring_buffer_.size();
+    ssize_t read = ring_read_index_ == -1 ? size - 1 : (ssize_t)ring_read_index_;
+    ssize_t write = last_ring_write_index_ == -1 ? size - 1 : (ssize_t)last_ring_write_index_;
+
+    ssize_t pending = (write - read + size) % size;
+    return (size_t)(size - 1 - pending);
+}
+
+bool uvgrtp::reception_flow::make_room()
+{
+    int request = RING_NO_REQUEST;
+
+    /* the reactor and RCC_RUN_TO_COMPLETION process every batch before reading the next one,
+     * so nobody would serve the request */
+    if (reactor_ || run_to_completion_) {
+        return false;
+    }
+
+    if (overflow_policy_ == RTP_RING_DROP_OLDEST) {
+        request = RING_DROP_OLDEST;
+    }
+    else if (overflow_policy_ == RTP_RING_GROW) {
+        ssize_t max_size = max_buffer_size_ > 0 ? max_buffer_size_ : 4 * buffer_size_kbytes_;
+
+        if (ring_buffer_.size() < ring_slots((size_t)max_size)) {
+            request = RING_GROW;
+        }
+    }
+
+    if (request == RING_NO_REQUEST) {
+        return false;
+    }
+
+    ring_request_ = request;
+    wake_processor();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(poll_timeout_ms_, 1));
+    std::unique_lock<std::mutex> lk(ring_request_mutex_);
+
+    if (!ring_request_cond_.wait_until(lk, deadline, [this] { return ring_request_ == RING_NO_REQUEST; })) {
+        /* the processing thread is stuck in a handler, withdraw the request unless it is already being served */
+        int expected = request;
+        if (ring_request_.compare_exchange_strong(expected, RING_NO_REQUEST)) {
+            return false;
         }
+        ring_request_cond_.wait(lk, [this] { return ring_request_ == RING_NO_REQUEST; });
+    }
+
+    return free_slots() > 0;
+}
+
+rtp_error_t uvgrtp::reception_flow::drop_batch(std::shared_ptr<uvgrtp::socket>& socket, int& msgs_read)
+{
+    size_t batch_size = (size_t)std::max(recv_batch_size_, 1);
+
+    if (drop_buffer_.size() != slot_size()) {
+        drop_buffer_.resize(slot_size());
+    }
+    if (batch_bufs_.size() < batch_size) {
+        batch_bufs_.resize(batch_size);
+        batch_lens_.resize(batch_size);
+        batch_segments_.resize(batch_size);
+    }
+
+    // every packet of the batch is written over the previous one
+    for (size_t i = 0; i < batch_size; ++i) {
+        batch_bufs_[i] = drop_buffer_.data();
+    }
+
+    msgs_read = 0;
+    rtp_error_t ret = socket->recvmmsg(batch_bufs_.data(), slot_size(), batch_lens_.data(), batch_segments_.data(),
+        batch_size, MSG_DONTWAIT, &msgs_read);
+
+    for (int i = 0; i < msgs_read; ++i) {
+        dropped_newest_ += packets_in_slot(batch_lens_[i], batch_segments_[i]);
+    }
 
-        // this works, because we have just added increase amount of spaces
-        ring_read_index_ += increase;
+    if (msgs_read > 0) {
+        UVG_LOG_DEBUG("Reception ring buffer is full, dropped %i reads", msgs_read);
     }
+
+    return ret;
+}
+
+void uvgrtp::reception_flow::serve_ring_request()
+{
+    int request = ring_request_;
+
+    if (request == RING_NO_REQUEST || request == RING_SERVING ||
+        !ring_request_.compare_exchange_strong(request, RING_SERVING)) {
+        return;
+    }
+
+    if (request == RING_DROP_OLDEST) {
+        drop_oldest();
+    }
+    else if (request == RING_GROW) {
+        grow_ring_buffer();
+    }
+
+    std::lock_guard<std::mutex> lg(ring_request_mutex_);
+    ring_request_ = RING_NO_REQUEST;
+    ring_request_cond_.notify_one();
+}
+
+void uvgrtp::reception_flow::drop_oldest()
+{
+    /* one batch and the slot that stays at the read index */
+    int count = std::max(recv_batch_size_, 1) + 1;
+
+    for (int i = 0; i < count && ring_read_index_ != last_ring_write_index_; ++i) {
+        ring_read_index_ = next_buffer_location(ring_read_index_);
+
+        Buffer& slot = ring_buffer_[ring_read_index_];
+        if (slot.read > 0) {
+            dropped_oldest_ += packets_in_slot(slot.read, slot.gso_size);
+        }
+        slot.read = 0;
+    }
+}
+
+void uvgrtp::reception_flow::grow_ring_buffer()
+{
+    ssize_t max_size = max_buffer_size_ > 0 ? max_buffer_size_ : 4 * buffer_size_kbytes_;
+    size_t size = ring_buffer_.size();
+    size_t new_size = std::min(2 * size, ring_slots((size_t)max_size));
+
+    if (new_size <= size) {
+        return;
+    }
+
+    /* The slots are moved so that the unprocessed ones are at the start of the new ring, oldest first.
+     * The receiver is waiting for this to finish and the slot at the read index has been processed */
+    ssize_t first = next_buffer_location(ring_read_index_);
+    size_t pending = size - 1 - free_slots();
+
+    std::vector<Buffer> slots(new_size, { 0, 0 });
+    for (size_t i = 0; i < pending; ++i) {
+        slots[i] = ring_buffer_[(first + i) % size];
+    }
+
+    if (!ring_owners_.empty()) {
+        std::vector<uvgrtp::pool_buffer*> owners;
+        for (size_t i = 0; i < size; ++i) {
+            owners.push_back(ring_owners_[(first + i) % size]);
+        }
+
+        while (owners.size() < new_size) {
+            uvgrtp::pool_buffer* buffer = buffer_pool_->acquire();
+            if (!buffer) {
+                break;
+            }
+            owners.push_back(buffer);
+        }
+        ring_owners_.swap(owners);
+    }
+    else {
+        size_t slab_size = new_size * ring_stride_;
+        uint8_t* slab = alloc_slab(slab_size, huge_pages_);
+
+        if (!slab) {
+            UVG_LOG_ERROR("Failed to allocate memory for a larger ring buffer");
+            return;
+        }
+
+        for (size_t i = 0; i < pending; ++i) {
+            std::memcpy(slab + i * ring_stride_, slot_data((first + i) % size), slots[i].read);
+        }
+
+        free_slab(ring_slab_, ring_slab_size_);
+        ring_slab_ = slab;
+        ring_slab_size_ = slab_size;
+    }
+
+    slots.resize(ring_owners_.empty() ? new_size : ring_owners_.size());
+    ring_buffer_.swap(slots);
+
+    ring_read_index_ = -1;
+    last_ring_write_index_ = (ssize_t)pending - 1;
+
+    ring_slots_ = ring_buffer_.size();
+    ++ring_grows_;
+
+    UVG_LOG_DEBUG("Reception ring buffer was full, grew it from %zu to %zu slots", size, ring_buffer_.size());
 }
 
 int uvgrtp::reception_flow::clear_stream_from_flow(std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc)
@@ -717,7 +1917,11 @@ int uvgrtp::reception_flow::clear_stream_from_flow(std::shared_ptr<std::atomic<s
     uint32_t ssrc = remote_ssrc.get()->load();
     // Clear all the data structures
     hooks_.erase(ssrc);
-    packet_handlers_.erase(ssrc);
+    if (auto it = packet_handlers_.find(ssrc); it != packet_handlers_.end()) {
+        close_receive_queue(it->second);
+        packet_handlers_.erase(it);
+    }
+    publish_dispatch_table();
     
     // If all the data structures are empty, return 1 which means that there is no streams left for this reception_flow
     // and it can be safely deleted
@@ -740,5 +1944,6 @@ rtp_error_t uvgrtp::reception_flow::update_remote_ssrc(uint32_t old_remote_ssrc,
         hooks_.erase(old_remote_ssrc);
         hooks_.insert({new_remote_ssrc, hook});
     }
+    publish_dispatch_table();
     return RTP_OK;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include <atomic>
 #include <deque>
 #include <map>
+#include <cstdint>
 
 #ifdef _WIN32
 #include <ws2ipdef.h>
@@ -28,6 +29,11 @@ namespace uvgrtp {
 
     class socket;
     class rtcp;
+    class buffer_pool;
+    struct pool_buffer;
+    struct ring_stats;
+    class uring;
+    class reactor;
 
     typedef void (*recv_hook)(void* arg, uvgrtp::frame::rtp_frame* frame);
 
@@ -44,6 +50,22 @@ namespace uvgrtp {
         std::function<rtp_error_t(void*, int, uint8_t*, size_t, frame::rtp_frame** out)> handler;
         void* args = nullptr;
     };
+    /* Frames of one remote source that are waiting for pull_frame(). Shared with the pulling
+     * threads so that removing the handlers of the source does not free it under them */
+    struct receive_queue {
+        ~receive_queue();
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<uvgrtp::frame::rtp_frame*> frames;
+
+        // set when the handlers of the source are removed
+        bool closed = false;
+
+        // set once the queue has been full, so the frames dropped are only logged once
+        bool overflowed = false;
+    };
+
     struct handler {
         packet_handler rtp;
         packet_handler rtcp;
@@ -52,6 +74,14 @@ namespace uvgrtp {
         packet_handler media;
         packet_handler rtcp_common;
         std::function<rtp_error_t(uvgrtp::frame::rtp_frame ** out)> getter;
+        std::shared_ptr<receive_queue> frames;
+    };
+
+    /* Copy of the handlers and hooks that dispatch_packet() looks packets up from. The copy is never
+     * modified, a new one is published whenever the handlers or hooks change */
+    struct dispatch_table {
+        std::unordered_map<uint32_t, handler> handlers;
+        std::unordered_map<uint32_t, receive_pkt_hook> hooks;
     };
 
     /* This class handles the reception processing of received RTP packets. It 
@@ -83,7 +113,7 @@ namespace uvgrtp {
      * packet is assumed to be a user packet, in which case it is handed over to 
      * a user packet handler, provided that there is one installed. */
 
-    class reception_flow{
+    class reception_flow : public std::enable_shared_from_this<reception_flow> {
         public:
             reception_flow(bool ipv6);
             ~reception_flow();
@@ -113,10 +143,13 @@ namespace uvgrtp {
             rtp_error_t install_receive_hook(void *arg, void (*hook)(void *, uvgrtp::frame::rtp_frame *), uint32_t remote_ssrc);
 
             /* Start the RTP reception flow. Start querying for received packets and processing them.
+             * If "reactor" is given, the packets are received and processed by a thread of the reactor
+             * and the flow has no threads of its own
              *
              * Return RTP_OK on success
              * Return RTP_MEMORY_ERROR if allocation of a thread object fails */
-            rtp_error_t start(std::shared_ptr<uvgrtp::socket> socket, int rce_flags);
+            rtp_error_t start(std::shared_ptr<uvgrtp::socket> socket, int rce_flags,
+                std::shared_ptr<uvgrtp::reactor> reactor = nullptr);
 
             /* Stop the RTP reception flow and wait until the receive loop is exited
              * to make sure that destroying the object is safe.
@@ -124,20 +157,24 @@ namespace uvgrtp {
              * Return RTP_OK on success */
             rtp_error_t stop();
 
-            /* Fetch frame from the frame queue that contains all received frame.
+            /* Fetch a frame from the frame queue of the handlers installed for "remote_ssrc".
+             * Every set of handlers has a queue of its own, so a stream waits only for its own frames.
              * pull_frame() will block until there is a frame that can be returned.
-             * If "timeout" is given, pull_frame() will block only for however long
+             * If "timeout_ms" is not -1, pull_frame() will block only for however long
              * that value tells it to.
              * If no frame is received within that time period, pull_frame() returns nullptr
-             * If remote SSRC is given, only pull frames that come from a source with this ssrc
              *
              * Return pointer to RTP frame on success
              * Return nullptr if operation timed out or an error occurred */
-            uvgrtp::frame::rtp_frame *pull_frame();
-            uvgrtp::frame::rtp_frame *pull_frame(ssize_t timeout_ms);
-            uvgrtp::frame::rtp_frame* pull_frame(std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc);
             uvgrtp::frame::rtp_frame* pull_frame(ssize_t timeout_ms, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc);
 
+            /* Move at most "max_frames" frames from the frame queue of "remote_ssrc" to the end of "frames"
+             * under one lock. Blocks like pull_frame() until at least one frame is available
+             *
+             * Return the number of frames moved, 0 if the operation timed out or the flow was stopped */
+            size_t pull_frames(std::vector<uvgrtp::frame::rtp_frame*>& frames, size_t max_frames,
+                ssize_t timeout_ms, std::shared_ptr<std::atomic<std::uint32_t>> remote_ssrc);
+
             /* Clear the packet handlers associated with this REMOTE SSRC
              * Also clear the hooks associated with this remote_ssrc
              * 
@@ -157,35 +194,123 @@ namespace uvgrtp {
             void set_payload_size(const size_t& value);
             void set_poll_timeout_ms(int timeout_ms);
             int get_poll_timeout_ms();
+            void set_recv_batch_size(int batch_size);
+            int get_recv_batch_size() const;
+            void set_overflow_policy(int policy);
+            int get_overflow_policy() const;
+            void set_max_buffer_size(ssize_t value);
+            ssize_t get_max_buffer_size() const;
+            void set_run_to_completion(bool enabled);
+            bool get_run_to_completion() const;
+            void set_huge_pages(bool enabled);
+            bool get_huge_pages() const;
+            void set_receive_zero_copy(bool enabled);
+            void set_socket_rcv_buffer_size(int buf_size);
+
+            /* With a reactor without threads, read at most "max_reads" packets waiting in the socket
+             * and process them on the calling thread. Does not block
+             *
+             * Return the number of reads on success, with UDP GRO one read may hold several packets
+             * Return -1 if the flow is not run by the application or reading failed */
+            int poll_once(size_t max_reads, int rce_flags);
+
+            /* Add the ring buffer counters of this flow and its shards to "stats" */
+            void get_ring_stats(uvgrtp::ring_stats& stats);
 
             // DISABLED rtp_error_t install_user_hook(void* arg, void (*hook)(void*, uint8_t* data, uint32_t len));
             /// \endcond
 
         private:
-            /* RTP packet receiver thread */
-            void receiver(std::shared_ptr<uvgrtp::socket> socket);
+            /* RTP packet receiver thread. With RCC_RUN_TO_COMPLETION, it also processes the packets it reads */
+            void receiver(std::shared_ptr<uvgrtp::socket> socket, int rce_flags);
+
+            /* RTP packet receiver thread of RCE_IO_URING. The ring buffer slots are given to the kernel
+             * as provided buffers and a multishot receive writes the packets straight into them.
+             * A slot is given back to the kernel once the processing thread has moved past it.
+             * Falls back to receiver() if the kernel does not support multishot receives */
+            void receiver_uring(std::shared_ptr<uvgrtp::socket> socket, int rce_flags);
+
+            /* Read one batch of at most "max_reads" packets from "socket" into the ring buffer
+             *
+             * Return RTP_OK on success and write the number of packets read to "msgs_read"
+             * Return RTP_INTERRUPTED if there was nothing to read */
+            rtp_error_t read_batch(std::shared_ptr<uvgrtp::socket>& socket, int& msgs_read, size_t max_reads = SIZE_MAX);
+
+            /* Called by the reactor when "socket" is readable. Reads one batch of packets and
+             * processes it right away so that other sockets of the reactor thread get their turn */
+            void receive_ready(std::shared_ptr<uvgrtp::socket>& socket, int rce_flags);
+
+            /* Bind more SO_REUSEPORT sockets to the address of "socket" (RCE_REUSEPORT_SHARDING) and start
+             * a shard for each of them. A shard is a reception flow of its own that only receives and hands
+             * its packets to dispatch_packet() of this flow, so the streams and frames stay here
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if "socket" does not allow SO_REUSEPORT */
+            rtp_error_t start_shards(std::shared_ptr<uvgrtp::socket> socket, int rce_flags);
+
+            /* Create the io_uring instance of receiver_uring() and check that it supports provided buffer rings
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support io_uring */
+            rtp_error_t start_uring();
 
             /* RTP packet dispatcher thread */
             void process_packet(int rce_flags);
 
-            /* Return a processed RTP frame to user either through frame queue or receive hook */
-            void return_frame(uvgrtp::frame::rtp_frame *frame);
+            /* Wake up the processing thread after the receiver has written to the ring buffer or posted a request */
+            void wake_processor();
 
-            //void return_user_pkt(uint8_t* pkt, uint32_t len);
+            /* Does the processing thread have packets or a request of the receiver waiting */
+            bool has_work() const;
+
+            /* Dispatch the packets written to the ring buffer since the last call
+             *
+             * Return the number of processed packets */
+            int process_available(int rce_flags);
+
+            /* Determine the type of a single received packet and hand it to the correct handlers of "table".
+             * With RCC_RECEIVE_ZERO_COPY, "buffer" is the pooled ring buffer slot holding the packet */
+            void dispatch_packet(const dispatch_table& table, uint8_t* ptr, size_t size, int rce_flags,
+                uvgrtp::pool_buffer* buffer);
+
+            /* Return the current dispatch table. The table is loaded once per batch of packets,
+             * std::atomic_load() of a shared_ptr takes a lock */
+            std::shared_ptr<const dispatch_table> load_dispatch_table() const;
 
-            inline void increase_buffer_size(ssize_t next_write_index);
+            /* Return a processed RTP frame to user either through the frame queue of "handlers" or receive hook */
+            void return_frame(uvgrtp::frame::rtp_frame *frame, const handler& handlers, const dispatch_table& table);
+
+            /* Publish a new dispatch table. Both "hooks_mutex_" and "handlers_mutex_" must be held */
+            void publish_dispatch_table();
+
+            //void return_user_pkt(uint8_t* pkt, uint32_t len);
 
             inline ssize_t next_buffer_location(ssize_t current_location);
 
             void create_ring_buffer();
             void destroy_ring_buffer();
 
+            /* Bytes that one ring buffer slot can receive */
+            size_t slot_size() const;
+
+            /* Number of slots that fit in "bytes" of ring buffer memory */
+            size_t ring_slots(size_t bytes) const;
+
             void clear_frames();
 
-            /* If receive hook has not been installed, frames are pushed to "frames_"
-             * and they can be retrieved using pull_frame() */
-            std::deque<uvgrtp::frame::rtp_frame *> frames_;
-            std::mutex frames_mtx_;
+            /* Get the frame queue of the handlers installed for "remote_ssrc"
+             *
+             * Return nullptr if there are no handlers for "remote_ssrc" */
+            std::shared_ptr<receive_queue> get_receive_queue(uint32_t remote_ssrc);
+
+            /* Wake up the threads waiting for frames of "handlers" before the handlers are removed */
+            void close_receive_queue(handler& handlers);
+
+            /* Wait with the mutex of "queue" held by "lk" until the queue has a frame, the queue is
+             * closed, the flow is stopped or "timeout_ms" has passed
+             *
+             * Return true if there is a frame to pull */
+            bool wait_frames(receive_queue& queue, std::unique_lock<std::mutex>& lk, ssize_t timeout_ms);
 
             //void *recv_hook_arg_;
             //void (*recv_hook_)(void *arg, uvgrtp::frame::rtp_frame *frame);
@@ -198,24 +323,83 @@ namespace uvgrtp {
             std::unique_ptr<std::thread> receiver_;
             std::unique_ptr<std::thread> processor_;
 
-            // from/from6 is the IP address that this packet came from
+            /* State of a ring buffer slot. The states are kept apart from the packet data so that
+             * the processing thread scans a small dense array */
             struct Buffer
             {
-                uint8_t* data;
                 int read;
-                //sockaddr_in6 from6;
-                //sockaddr_in from;
+                int gso_size; // with UDP GRO, size of each coalesced datagram. 0 if only one datagram
             };
 
+            /* Start of the packet data of ring buffer slot "index" */
+            inline uint8_t* slot_data(ssize_t index) const;
+
+            /* With RCC_RECEIVE_ZERO_COPY, give slot "index" a fresh buffer if frames still point into its current one
+             *
+             * Return false if there is no buffer left, the slot must not be written until the frames are released */
+            bool recycle_slot(ssize_t index);
+
+            /* With RCC_RECEIVE_ZERO_COPY, the buffers of the ring and the frames pointing into them are limited
+             * to RCC_RING_BUFFER_MAX_SIZE bytes if it has been set. Must be called with "ring_mutex_" held */
+            void limit_buffer_pool();
+
+            /* Called by a receiver with ring_mutex_ held before it writes to the ring buffer. If the size of the
+             * ring has changed, wait until the processing thread is done with the old ring and create a new one.
+             * The new ring is created with "process_mutex_" held, so the caller must not hold it
+             *
+             * Return true if the ring buffer was created */
+            bool update_ring_buffer();
+
+            /* Number of ring buffer slots the receiver can write to. The slot at the read index is never
+             * written because the processing thread may still be dispatching it */
+            size_t free_slots() const;
+
+            /* Called by the receiver when the ring buffer is full. With RTP_RING_DROP_OLDEST and RTP_RING_GROW,
+             * the processing thread is asked to make room and the receiver waits for it at most poll_timeout_ms_
+             *
+             * Return true if there is room in the ring buffer */
+            bool make_room();
+
+            /* Read a batch of packets that do not fit in the full ring buffer and drop them */
+            rtp_error_t drop_batch(std::shared_ptr<uvgrtp::socket>& socket, int& msgs_read);
+
+            /* Run by the processing thread to serve the request of make_room(), if there is one */
+            void serve_ring_request();
+            void drop_oldest();
+            void grow_ring_buffer();
+
             void* user_hook_arg_;
             void (*user_hook_)(void* arg, uint8_t* data, uint32_t len);
 
-            // Map different types of handlers by remote SSRC
+            /* Map different types of handlers by remote SSRC. If receive hook has not been installed,
+             * frames are pushed to the frame queue of the handlers and they can be retrieved using pull_frame() */
             std::unordered_map<uint32_t, handler> packet_handlers_;
 
+            /* Read with std::atomic_load() by the processing threads, which may be those of several
+             * shards at the same time. Each thread loads it once per batch of packets */
+            std::shared_ptr<const dispatch_table> dispatch_table_;
+
             int poll_timeout_ms_;
 
+            // how many datagrams the receiver thread tries to read with one system call
+            int recv_batch_size_;
+
             std::vector<Buffer> ring_buffer_;
+
+            /* The packet data of all slots in one allocation, "ring_stride_" bytes per slot. With
+             * RCC_RECEIVE_ZERO_COPY, the slots are pooled buffers of "ring_owners_" instead */
+            uint8_t* ring_slab_;
+            size_t ring_slab_size_;
+            size_t ring_stride_;
+            std::vector<uvgrtp::pool_buffer*> ring_owners_;
+
+            std::unique_ptr<uvgrtp::uring> uring_;
+
+            /* The ring buffer is created by the receiver right before it is first written to. Changing the
+             * ring size only sets "ring_changed_" so that configuring the stream after it has been created
+             * does not allocate the ring again and so that the ring is never freed under the receiver */
+            std::atomic<bool> ring_changed_;
+
             std::mutex handlers_mutex_;
             std::mutex ring_mutex_;
             std::mutex active_mutex_;
@@ -227,13 +411,74 @@ namespace uvgrtp {
 
             std::mutex wait_mtx_; // for waking up the processing thread (read)
 
+            /* Held while the ring buffer is being processed. With RCC_RUN_TO_COMPLETION, the receiver
+             * processes its packets itself, but the processing thread may still be finishing older ones */
+            std::mutex process_mutex_;
+            std::atomic<bool> run_to_completion_;
+
             std::condition_variable process_cond_;
             std::shared_ptr<uvgrtp::socket> socket_;
 
             ssize_t buffer_size_kbytes_;
             size_t payload_size_;
+
+            /* With RCE_UDP_GRO, a slot may receive several coalesced datagrams and holds
+             * up to UINT16_MAX bytes. The ring size is then divided into these larger slots,
+             * plus one receive batch of slots for reads that were not coalesced */
+            bool gro_;
+
+            // RCC_RING_HUGE_PAGES, the ring slab is advised to use transparent huge pages
+            bool huge_pages_;
+
+            // RCC_RECEIVE_ZERO_COPY, the ring is built of the buffers of "buffer_pool_"
+            bool receive_zero_copy_;
             bool active_;
             bool ipv6_;
+
+            /* With RCE_REUSEPORT_SHARDING, the flows receiving the other sockets of the port. The
+             * processing thread of a shard dispatches the packets with "owner_", which is "this" otherwise */
+            std::vector<std::unique_ptr<uvgrtp::reception_flow>> shards_;
+            uvgrtp::reception_flow *owner_;
+
+            /* Shards stopped while a reactor thread may still be running their callback. The reactor
+             * keeps "owner_" alive during the callback, so they are destroyed together with it */
+            std::vector<std::unique_ptr<uvgrtp::reception_flow>> stopped_shards_;
+
+            // ring buffer slots, their read sizes and GRO segment sizes for a single recvmmsg() call
+            std::vector<uint8_t*> batch_bufs_;
+            std::vector<int> batch_lens_;
+            std::vector<int> batch_segments_;
+
+            /* Set when receiving with the reactor. The ring buffer then only needs room for one batch */
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+
+            /* Set with RCC_RECEIVE_ZERO_COPY. The ring buffer slots are then taken from this pool */
+            std::shared_ptr<uvgrtp::buffer_pool> buffer_pool_;
+
+            // RCC_RING_OVERFLOW_POLICY and RCC_RING_BUFFER_MAX_SIZE, 0 meaning four times the ring buffer size
+            int overflow_policy_;
+            ssize_t max_buffer_size_;
+
+            // RCC_UDP_RCV_BUF_SIZE for the sockets of the shards, 0 if the stream has not set it
+            int rcv_buf_size_;
+
+            /* request of the receiver to the processing thread when the ring buffer is full. The
+             * condition is also notified when the processing thread has caught up with the receiver */
+            std::atomic<int> ring_request_;
+            std::mutex ring_request_mutex_;
+            std::condition_variable ring_request_cond_;
+
+            // packets that do not fit in the ring buffer are read here and dropped
+            std::vector<uint8_t> drop_buffer_;
+
+            std::atomic<size_t> ring_slots_;
+            std::atomic<uint64_t> received_packets_;
+            std::atomic<uint64_t> dropped_newest_;
+            std::atomic<uint64_t> dropped_oldest_;
+            std::atomic<uint64_t> ring_grows_;
+
+            // set while the receiver drops packets because frames hold every receive buffer
+            bool out_of_buffers_;
     };
 }
 
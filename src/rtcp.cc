@@ -12,6 +12,7 @@
 #include "rtcp_packets.hh"
 #include "socketfactory.hh"
 #include "rtcp_reader.hh"
+#include "reactor.hh"
 
 #include "global.hh"
 
@@ -72,6 +73,8 @@ uvgrtp::rtcp::rtcp(std::shared_ptr<uvgrtp::rtp> rtp, std::shared_ptr<std::atomic
     fb_hook_u_(nullptr),
     sfp_(sfp),
     rtcp_reader_(nullptr),
+    reactor_(nullptr),
+    report_timer_(0),
     active_(false),
     interval_ms_(DEFAULT_RTCP_INTERVAL_MS),
     rtp_ptr_(rtp),
@@ -200,10 +203,12 @@ void uvgrtp::rtcp::free_participant(std::unique_ptr<rtcp_participant> participan
     }
 }
 
-rtp_error_t uvgrtp::rtcp::start()
+rtp_error_t uvgrtp::rtcp::start(std::shared_ptr<uvgrtp::reactor> reactor)
 {
     active_ = true;
     ipv6_ = sfp_->get_ipv6();
+    reactor_ = reactor;
+
     if ((rce_flags_ & RCE_RTCP_MUX)) {
         if (ipv6_) {
             socket_address_ipv6_ = uvgrtp::socket::create_ip6_sockaddr(remote_addr_, dst_port_);
@@ -211,7 +216,7 @@ rtp_error_t uvgrtp::rtcp::start()
         else {
             socket_address_ = uvgrtp::socket::create_sockaddr(AF_INET, remote_addr_, dst_port_);
         }
-        report_generator_.reset(new std::thread(rtcp_runner, this));
+        start_report_generator();
         return RTP_OK;
     }
 
@@ -255,8 +260,8 @@ rtp_error_t uvgrtp::rtcp::start()
     else {
         socket_address_ = uvgrtp::socket::create_sockaddr(AF_INET, remote_addr_, dst_port_);
     }
-    report_generator_.reset(new std::thread(rtcp_runner, this));
-    rtcp_reader_->start();
+    start_report_generator();
+    rtcp_reader_->start(reactor_);
 
     return RTP_OK;
 }
@@ -283,6 +288,12 @@ rtp_error_t uvgrtp::rtcp::stop()
         return RTP_OK;
     }
     active_ = false;
+    if (report_timer_ != 0)
+    {
+        reactor_->remove_timer(report_timer_);
+        report_timer_ = 0;
+    }
+
     if (report_generator_ && report_generator_->joinable())
     {
         UVG_LOG_DEBUG("Waiting for RTCP loop to exit");
@@ -307,48 +318,77 @@ void uvgrtp::rtcp::rtcp_runner(rtcp* rtcp)
     std::this_thread::sleep_for(std::chrono::milliseconds(initial_sleep_ms));
 
     uint32_t current_interval_ms = rtcp->get_rtcp_interval_ms();
-    rtp_error_t ret = RTP_OK;
-    
+
     // keep track of report numbers
     int report_number = 0;
 
     while (rtcp->is_active())
     {
-        ++report_number;
-        UVG_LOG_DEBUG("Sending RTCP report number %i", report_number);
+        current_interval_ms = rtcp->send_periodic_report(current_interval_ms, ++report_number);
+        std::this_thread::sleep_for(std::chrono::milliseconds(current_interval_ms));
+    }
+    UVG_LOG_DEBUG("Exited RTCP loop");
+}
+
+void uvgrtp::rtcp::start_report_generator()
+{
+    if (reactor_)
+    {
+        uint32_t current_interval_ms = get_rtcp_interval_ms();
+        int report_number = 0;
+
+        // RFC 3550 says to wait half interval before sending first report
+        report_timer_ = reactor_->add_timer(current_interval_ms / 2,
+            [this, current_interval_ms, report_number]() mutable {
+                current_interval_ms = send_periodic_report(current_interval_ms, ++report_number);
+                return (int)current_interval_ms;
+            }, weak_from_this());
 
-        if ((ret = rtcp->generate_report()) != RTP_OK && ret != RTP_NOT_READY)
+        if (report_timer_ != 0)
         {
-            UVG_LOG_INFO("Failed to send RTCP status report!");
+            UVG_LOG_INFO("RTCP instance created!");
+            return;
         }
+        UVG_LOG_WARN("Failed to add RTCP reports to the reactor, sending them from a thread of its own");
+    }
 
-        //Here we check if there are any timed out sources
-        //This vector collects the ssrcs of timed out sources
-        std::vector<uint32_t> ssrcs_to_be_removed = {};
-        for (auto it = rtcp->ms_since_last_rep_.begin(); it != rtcp->ms_since_last_rep_.end(); ++it) {
-            double timeout_interval_s = rtcp->rtcp_interval(int(rtcp->members_), 1, rtcp->rtcp_bandwidth_,
-                true, (double)rtcp->avg_rtcp_size_, false, false);
-            it->second += uint32_t(current_interval_ms);
-            if (it->second > 5*1000*timeout_interval_s) {
-                ssrcs_to_be_removed.push_back(it->first);
-            }
-        }
-        //If some ssrcs are timed out, remove them
-        for (auto rm : ssrcs_to_be_removed) {
-            rtcp->remove_timeout_ssrc(rm);
-            rtcp->ms_since_last_rep_.erase(rm);
-        }
+    report_generator_.reset(new std::thread(rtcp_runner, this));
+}
+
+uint32_t uvgrtp::rtcp::send_periodic_report(uint32_t elapsed_ms, int report_number)
+{
+    rtp_error_t ret = RTP_OK;
+    UVG_LOG_DEBUG("Sending RTCP report number %i", report_number);
+    (void)report_number;
 
-        // Number of senders is hard set to 1, because it is not updated anywhere.
-        // TODO: Keep track of senders and update it here too
-        // Same goes for we_sent also, it is always set to true. TODO: fix this
-        double interval_s = rtcp->rtcp_interval(int(rtcp->members_), 1, rtcp->rtcp_bandwidth_,
-            true, (double)rtcp->avg_rtcp_size_, true, true);
-        current_interval_ms = (uint32_t)round(1000 * interval_s);
+    if ((ret = generate_report()) != RTP_OK && ret != RTP_NOT_READY)
+    {
+        UVG_LOG_INFO("Failed to send RTCP status report!");
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(current_interval_ms));
+    //Here we check if there are any timed out sources
+    //This vector collects the ssrcs of timed out sources
+    std::vector<uint32_t> ssrcs_to_be_removed = {};
+    for (auto it = ms_since_last_rep_.begin(); it != ms_since_last_rep_.end(); ++it) {
+        double timeout_interval_s = rtcp_interval(int(members_), 1, rtcp_bandwidth_,
+            true, (double)avg_rtcp_size_, false, false);
+        it->second += elapsed_ms;
+        if (it->second > 5*1000*timeout_interval_s) {
+            ssrcs_to_be_removed.push_back(it->first);
+        }
     }
-    UVG_LOG_DEBUG("Exited RTCP loop");
+    //If some ssrcs are timed out, remove them
+    for (auto rm : ssrcs_to_be_removed) {
+        remove_timeout_ssrc(rm);
+        ms_since_last_rep_.erase(rm);
+    }
+
+    // Number of senders is hard set to 1, because it is not updated anywhere.
+    // TODO: Keep track of senders and update it here too
+    // Same goes for we_sent also, it is always set to true. TODO: fix this
+    double interval_s = rtcp_interval(int(members_), 1, rtcp_bandwidth_,
+        true, (double)avg_rtcp_size_, true, true);
+    return (uint32_t)round(1000 * interval_s);
 }
 
 rtp_error_t uvgrtp::rtcp::set_sdes_items(const std::vector<uvgrtp::frame::rtcp_sdes_item>& items)
@@ -6,6 +6,7 @@
 #include "uvgrtp/rtcp.hh"
 #include "socketfactory.hh"
 #include "socket.hh"
+#include "reactor.hh"
 #include "global.hh"
 #include "debug.hh"
 
@@ -15,6 +16,7 @@
 #include <netinet/in.h>
 #else
 #include <ws2ipdef.h>
+#define MSG_DONTWAIT 0
 #endif
 
 const int MAX_PACKET = 65536;
@@ -22,7 +24,9 @@ const int MAX_PACKET = 65536;
 uvgrtp::rtcp_reader::rtcp_reader() :
     active_(false),
     socket_(nullptr),
-    rtcps_map_({})
+    rtcps_map_({}),
+    reactor_(nullptr),
+    buffer_(nullptr)
 {
     report_reader_ = nullptr;
 }
@@ -34,11 +38,23 @@ uvgrtp::rtcp_reader::~rtcp_reader()
     }
 }
 
-rtp_error_t uvgrtp::rtcp_reader::start()
+rtp_error_t uvgrtp::rtcp_reader::start(std::shared_ptr<uvgrtp::reactor> reactor)
 {
     if (active_) {
         return RTP_OK;
     }
+
+    if (reactor) {
+        buffer_.reset(new uint8_t[MAX_PACKET]);
+
+        if (reactor->add_socket(socket_->get_raw_socket(), [this]() { read_reports(); }, weak_from_this()) == RTP_OK) {
+            reactor_ = reactor;
+            active_  = true;
+            return RTP_OK;
+        }
+        UVG_LOG_WARN("Failed to add the RTCP socket to the reactor, reading it with a thread of its own");
+    }
+
     report_reader_.reset(new std::thread(&uvgrtp::rtcp_reader::rtcp_report_reader, this));
     active_ = true;
     return RTP_OK;
@@ -47,6 +63,11 @@ rtp_error_t uvgrtp::rtcp_reader::start()
 rtp_error_t uvgrtp::rtcp_reader::stop()
 {
     active_ = false;
+    if (reactor_) {
+        reactor_->remove_socket(socket_->get_raw_socket());
+        reactor_ = nullptr;
+    }
+
     if (report_reader_ && report_reader_->joinable())
     {
         UVG_LOG_DEBUG("Waiting for RTCP reader to exit");
@@ -71,21 +92,7 @@ void uvgrtp::rtcp_reader::rtcp_report_reader() {
 
         if (ret == RTP_OK && nread > 0)
         {
-            uint32_t sender_ssrc = ntohl(*(uint32_t*)&buffer.get()[0 + RTCP_HEADER_SIZE]);
-            map_mutex_.lock();
-            if (rtcps_map_.size() == 1) {
-                auto& ptr = rtcps_map_.begin()->second;
-                (void)ptr->handle_incoming_packet(nullptr, 0, buffer.get(), (size_t)nread, nullptr);
-            }
-            else {
-                for (auto& p : rtcps_map_) {
-                    std::shared_ptr<uvgrtp::rtcp> rtcp_ptr = p.second;
-                    if (sender_ssrc == p.first.get()->load()) {
-                        (void)rtcp_ptr->handle_incoming_packet(nullptr, 0, buffer.get(), (size_t)nread, nullptr);
-                    }
-                }
-            }
-            map_mutex_.unlock();
+            handle_report(buffer.get(), (size_t)nread);
         }
         else if (ret == RTP_INTERRUPTED) {
             /* do nothing */
@@ -98,6 +105,35 @@ void uvgrtp::rtcp_reader::rtcp_report_reader() {
     UVG_LOG_DEBUG("Exited RTCP report reader loop");
 }
 
+void uvgrtp::rtcp_reader::read_reports()
+{
+    int nread = 0;
+
+    while (socket_->recv(buffer_.get(), MAX_PACKET, MSG_DONTWAIT, &nread) == RTP_OK) {
+        if (nread > 0)
+            handle_report(buffer_.get(), (size_t)nread);
+    }
+}
+
+void uvgrtp::rtcp_reader::handle_report(uint8_t *buffer, size_t len)
+{
+    uint32_t sender_ssrc = ntohl(*(uint32_t*)&buffer[0 + RTCP_HEADER_SIZE]);
+    map_mutex_.lock();
+    if (rtcps_map_.size() == 1) {
+        auto& ptr = rtcps_map_.begin()->second;
+        (void)ptr->handle_incoming_packet(nullptr, 0, buffer, len, nullptr);
+    }
+    else {
+        for (auto& p : rtcps_map_) {
+            std::shared_ptr<uvgrtp::rtcp> rtcp_ptr = p.second;
+            if (sender_ssrc == p.first.get()->load()) {
+                (void)rtcp_ptr->handle_incoming_packet(nullptr, 0, buffer, len, nullptr);
+            }
+        }
+    }
+    map_mutex_.unlock();
+}
+
 rtp_error_t uvgrtp::rtcp_reader::set_socket(std::shared_ptr<uvgrtp::socket> socket)
 {
     socket_ = socket;
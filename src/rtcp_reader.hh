@@ -23,23 +23,25 @@ namespace uvgrtp {
     class socketfactory;
     class rtcp;
     class socket;
+    class reactor;
 
     /* Every RTCP socket will have an RTCP reader that receives packets and distributes them to the correct RTCP
      * objects. RTCP objects are mapped via REMOTE SSRCs, the SSRC that they will be receiving packets from.
      * If NO socket multiplexing is done, this will be 0 by default. If there IS socket multiplexing, this will be the 
      * remote SSRC of the media stream, set via the RCC_REMOTE_SSRC context flag.
      */
-    class rtcp_reader {
+    class rtcp_reader : public std::enable_shared_from_this<rtcp_reader> {
 
         public: 
             rtcp_reader();
             ~rtcp_reader();
 
-            /* Start the report reader thread
+            /* Start the report reader thread. If "reactor" is given, packets are read by a
+             * thread of the reactor instead
              *
              * Return RTP_OK on success */
 
-            rtp_error_t start();
+            rtp_error_t start(std::shared_ptr<uvgrtp::reactor> reactor = nullptr);
 
 
             /* Stop the report reader thread
@@ -71,11 +73,20 @@ namespace uvgrtp {
 
             void rtcp_report_reader();
 
+            /* Read the packets waiting in the socket, called by the reactor */
+            void read_reports();
+
+            /* Give a received packet to the RTCP objects it belongs to */
+            void handle_report(uint8_t *buffer, size_t len);
+
             bool active_;
             std::shared_ptr<uvgrtp::socket> socket_;
             std::map<std::shared_ptr<std::atomic<uint32_t>>, std::shared_ptr<uvgrtp::rtcp>> rtcps_map_;
             std::unique_ptr<std::thread> report_reader_;
             std::mutex map_mutex_;
+
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+            std::unique_ptr<uint8_t[]> buffer_;
     };
 
 
@@ -5,6 +5,7 @@
 #include "debug.hh"
 #include "random.hh"
 #include "memory.hh"
+#include "frame_pool.hh"
 
 #include "global.hh"
 
@@ -31,7 +32,8 @@ uvgrtp::rtp::rtp(rtp_format_t fmt, std::shared_ptr<std::atomic<std::uint32_t>> s
     timestamp_(INVALID_TS),
     sampling_ntp_(0),
     rtp_ts_(0),
-    delay_(PKT_MAX_DELAY_MS)
+    delay_(PKT_MAX_DELAY_MS),
+    receive_zero_copy_(false)
 {
     if (ipv6) {
         payload_size_ = MAX_IPV6_MEDIA_PAYLOAD;
@@ -214,6 +216,16 @@ size_t uvgrtp::rtp::get_payload_size() const
     return payload_size_;
 }
 
+void uvgrtp::rtp::set_receive_zero_copy(bool enabled)
+{
+    receive_zero_copy_ = enabled;
+}
+
+bool uvgrtp::rtp::get_receive_zero_copy() const
+{
+    return receive_zero_copy_;
+}
+
 rtp_format_t uvgrtp::rtp::get_payload() const
 {
     return (rtp_format_t)fmt_;
@@ -243,8 +255,8 @@ uint32_t uvgrtp::rtp::get_rtp_ts() const {
 
 rtp_error_t uvgrtp::rtp::packet_handler(void* args, int rce_flags, uint8_t* packet, size_t size, uvgrtp::frame::rtp_frame **out)
 {
-    (void)rce_flags;
     (void)args;
+    (void)rce_flags;
 
     /* not an RTP frame */
     if (size < 12)
@@ -320,7 +332,7 @@ rtp_error_t uvgrtp::rtp::packet_handler(void* args, int rce_flags, uint8_t* pack
      * valid and subtract the amount of padding bytes from payload length */
     if ((*out)->header.padding) {
         UVG_LOG_DEBUG("Frame contains padding");
-        uint8_t padding_len = (*out)->payload[(*out)->payload_len - 1];
+        uint8_t padding_len = ptr[(*out)->payload_len - 1];
 
         if (!padding_len || (*out)->payload_len <= padding_len) {
             uvgrtp::frame::dealloc_frame(*out);
@@ -331,7 +343,19 @@ rtp_error_t uvgrtp::rtp::packet_handler(void* args, int rce_flags, uint8_t* pack
         (*out)->padding_len  = padding_len;
     }
 
-    (*out)->payload    = (uint8_t *)memdup(ptr, (*out)->payload_len);
+    /* With RCC_RECEIVE_ZERO_COPY, the payload is left in the receive buffer and
+     * reception_flow attaches the buffer to the frame */
+    if (receive_zero_copy_) {
+        (*out)->payload = ptr;
+    }
+    else if (((*out)->payload = uvgrtp::frame_pool::alloc_payload((*out)->payload_len, (*out)->buffer)) != nullptr) {
+        std::memcpy((*out)->payload, ptr, (*out)->payload_len);
+    }
+    else {
+        (void)uvgrtp::frame::dealloc_frame(*out);
+        return RTP_MEMORY_ERROR;
+    }
+
     (*out)->dgram      = (uint8_t *)packet;
     (*out)->dgram_size = size;
 
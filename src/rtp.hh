@@ -24,6 +24,7 @@ namespace uvgrtp {
             uint32_t     get_clock_rate()    const;
             size_t       get_payload_size()  const;
             size_t       get_pkt_max_delay() const;
+            bool         get_receive_zero_copy() const;
             rtp_format_t get_payload()       const;
             uint64_t     get_sampling_ntp()  const;
             uint32_t     get_rtp_ts()        const;
@@ -39,6 +40,7 @@ namespace uvgrtp {
             void set_payload_size(size_t payload_size);
             void set_pkt_max_delay(size_t delay);
             void set_sampling_ntp(uint64_t ntp_ts);
+            void set_receive_zero_copy(bool enabled);
 
             void fill_header(uint8_t* buffer, bool use_old_ts = false);
             void update_sequence(uint8_t *buffer);
@@ -81,6 +83,10 @@ namespace uvgrtp {
              *
              * Default value is 100ms */
             size_t delay_;
+
+            /* RCC_RECEIVE_ZERO_COPY, leave the payloads of received packets in the receive buffer.
+             * Set by the application while the processing thread reads it */
+            std::atomic<bool> receive_zero_copy_;
     };
 }
 
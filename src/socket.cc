@@ -4,7 +4,11 @@
 
 #include "debug.hh"
 #include "memory.hh"
+#include "global.hh"
+#include "uring.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <thread>
 
 #ifdef _WIN32
@@ -35,23 +39,85 @@ using namespace mingw;
 
 #define WSABUF_SIZE 256
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define UVGRTP_ZEROCOPY
+#endif
+
+#if defined(__linux__) && defined(SO_TXTIME) && defined(SCM_TXTIME)
+#include <linux/net_tstamp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <time.h>
+#define UVGRTP_TXTIME
+#endif
+
+#if defined(__linux__) && defined(SO_REUSEPORT) && defined(SO_ATTACH_REUSEPORT_CBPF)
+#include <linux/filter.h>
+#define UVGRTP_REUSEPORT_CBPF
+#endif
+
+#ifdef UVGRTP_HAVE_IO_URING
+/* how many packets are given to the kernel with one io_uring_enter(2) */
+constexpr unsigned URING_SEND_ENTRIES = 256;
+#endif
+
+/* How long a socket waits for the kernel to complete the retained zero-copy sends when it is destroyed */
+constexpr int ZEROCOPY_CLOSE_TIMEOUT_MS = 100;
+
+#if defined(__linux__) && defined(UDP_SEGMENT)
+/* Kernel limits for a single GSO buffer (UDP_MAX_SEGMENTS and UIO_MAXIOV) */
+constexpr size_t MAX_GSO_SEGMENTS = 64;
+constexpr size_t MAX_GSO_IOVECS   = 1024;
+#endif
+
 uvgrtp::socket::socket(int rce_flags) :
     socket_(0),
     local_address_(),
     local_ip6_address_(),
     ipv6_(false),
     rce_flags_(rce_flags),
-#ifdef _WIN32
-    buffers_()
-#else
-    header_(),
-    chunks_()
-#endif
+    gso_enabled_(false),
+    gro_enabled_(false),
+    handler_table_(nullptr),
+    table_readers_(0),
+    tables_retired_(false),
+    zerocopy_enabled_(false),
+    zerocopy_reserved_(0),
+    zerocopy_completed_(0),
+    zerocopy_pending_(),
+    zerocopy_retained_(),
+    io_uring_enabled_(false),
+    txtime_enabled_(false),
+    reuseport_enabled_(false)
 {}
 
 uvgrtp::socket::~socket()
 {
-    UVG_LOG_DEBUG("Socket total sent packets is %lu and received packets is %lu", sent_packets_, received_packets_);
+    UVG_LOG_DEBUG("Socket total sent packets is %lu and received packets is %lu", sent_packets_.load(), received_packets_);
+
+#ifdef UVGRTP_ZEROCOPY
+    /* the completions are reported through the error queue, which makes the socket readable with POLLERR */
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ZEROCOPY_CLOSE_TIMEOUT_MS);
+
+    while ((void)get_zerocopy_completed(), !zerocopy_retained_.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        struct pollfd pfd = { socket_, 0, 0 };
+
+        if (left.count() <= 0 || ::poll(&pfd, 1, (int)left.count()) <= 0)
+            break;
+    }
+
+    if (!zerocopy_retained_.empty()) {
+        UVG_LOG_WARN("Leaking the memory of %zu zero-copy sends that the kernel has not completed",
+            zerocopy_retained_.size());
+
+        for (auto& retained : zerocopy_retained_)
+            (void)new std::function<void()>(std::move(retained.second));
+    }
+#endif
 
 #ifndef _WIN32
     close(socket_);
@@ -389,26 +455,126 @@ socket_t& uvgrtp::socket::get_raw_socket()
 
 rtp_error_t uvgrtp::socket::install_handler(std::shared_ptr<std::atomic<std::uint32_t>> local_ssrc, void* arg, packet_handler_vec handler)
 {
-    handlers_mutex_.lock();
     if (!handler)
         return RTP_INVALID_VALUE;
 
-
     socket_packet_handler hndlr;
     hndlr.arg = arg;
     hndlr.handler = handler;
+
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
     vec_handlers_.insert({local_ssrc, hndlr});
-    handlers_mutex_.unlock();
+    publish_handlers();
 
     return RTP_OK;
 }
 
 rtp_error_t uvgrtp::socket::remove_handler(std::shared_ptr<std::atomic<std::uint32_t>> local_ssrc)
-
 {
-    handlers_mutex_.lock();
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
     vec_handlers_.erase(local_ssrc);
-    handlers_mutex_.unlock();
+    publish_handlers();
+
+    return RTP_OK;
+}
+
+void uvgrtp::socket::update_handlers()
+{
+    std::lock_guard<std::mutex> lg(handlers_mutex_);
+    publish_handlers();
+}
+
+void uvgrtp::socket::publish_handlers()
+{
+    std::unique_ptr<handler_table> table = std::unique_ptr<handler_table>(new handler_table);
+
+    for (auto& handler : vec_handlers_) {
+        table->by_ssrc[handler.first.get()->load()].push_back(table->entries.size());
+        table->entries.push_back(handler);
+    }
+
+    handler_table_.store(table.get());
+
+    if (current_table_)
+        retired_tables_.push_back(std::move(current_table_));
+    current_table_ = std::move(table);
+
+    /* set before checking the readers so that either this or the last reader frees the tables */
+    tables_retired_ = true;
+    free_retired_tables();
+}
+
+void uvgrtp::socket::free_retired_tables()
+{
+    /* a sender that starts reading now gets the current table, which is never retired here */
+    if (table_readers_ == 0) {
+        retired_tables_.clear();
+        tables_retired_ = false;
+    }
+}
+
+uvgrtp::socket::handler_reader::handler_reader(socket& sock) :
+    socket_(sock),
+    table_(nullptr)
+{
+    ++socket_.table_readers_;
+    table_ = socket_.handler_table_.load();
+}
+
+uvgrtp::socket::handler_reader::~handler_reader()
+{
+    if (--socket_.table_readers_ == 0 && socket_.tables_retired_) {
+        /* never wait for a writer, the next reader or writer frees the tables */
+        std::unique_lock<std::mutex> lock(socket_.handlers_mutex_, std::try_to_lock);
+
+        if (lock.owns_lock())
+            socket_.free_retired_tables();
+    }
+}
+
+const uvgrtp::socket::handler_table *uvgrtp::socket::handler_reader::table() const
+{
+    return table_;
+}
+
+rtp_error_t uvgrtp::socket::call_handlers(uint32_t ssrc, pkt_vec& buffers)
+{
+    handler_reader handlers(*this);
+    rtp_error_t ret = RTP_OK;
+
+    for (auto& buffer : buffers) {
+        if ((ret = call_handlers(handlers.table(), ssrc, buffer)) != RTP_OK)
+            return ret;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::socket::call_handlers(const handler_table *table, uint32_t ssrc, buf_vec& buffers)
+{
+    if (!table)
+        return RTP_OK;
+
+    auto it = table->by_ssrc.find(ssrc);
+
+    if (it == table->by_ssrc.end())
+        return RTP_OK;
+
+    rtp_error_t ret = RTP_OK;
+
+    for (size_t index : it->second) {
+        auto& handler = table->entries[index];
+
+        /* the SSRC may be changing right now, don't give the packet to a handler of another SSRC */
+        if (handler.first.get()->load() != ssrc)
+            continue;
+
+        if ((ret = (*handler.second.handler)(handler.second.arg, buffers)) != RTP_OK) {
+            UVG_LOG_ERROR("Malformed packet");
+            return ret;
+        }
+    }
+
     return RTP_OK;
 }
 
@@ -489,55 +655,58 @@ rtp_error_t uvgrtp::socket::__sendtov(
     int send_flags, int *bytes_sent
 )
 {
+    if (buffers.size() > (size_t)MAX_BUFFER_COUNT) {
+        UVG_LOG_ERROR("Trying to send too many buffers: %zu", buffers.size());
+        set_bytes(bytes_sent, -1);
+        return RTP_INVALID_VALUE;
+    }
+
 #ifndef _WIN32
+    /* the message is built on the stack so that senders of different streams don't share any state */
+    struct mmsghdr header = {};
+    struct iovec   chunks[MAX_BUFFER_COUNT];
     int sent_bytes = 0;
 
     for (size_t i = 0; i < buffers.size(); ++i) {
-        chunks_[i].iov_len  = buffers.at(i).first;
-        chunks_[i].iov_base = buffers.at(i).second;
+        chunks[i].iov_len  = buffers.at(i).first;
+        chunks[i].iov_base = buffers.at(i).second;
 
         sent_bytes += buffers.at(i).first;
     }
     if (ipv6) {
-        header_.msg_hdr.msg_name = (void*)&addr6;
-        header_.msg_hdr.msg_namelen = sizeof(addr6);
+        header.msg_hdr.msg_name = (void*)&addr6;
+        header.msg_hdr.msg_namelen = sizeof(addr6);
     }
     else {
-        header_.msg_hdr.msg_name       = (void *)&addr;
-        header_.msg_hdr.msg_namelen    = sizeof(addr);
+        header.msg_hdr.msg_name       = (void *)&addr;
+        header.msg_hdr.msg_namelen    = sizeof(addr);
     }
-    header_.msg_hdr.msg_iov        = chunks_;
-    header_.msg_hdr.msg_iovlen     = buffers.size();
-    header_.msg_hdr.msg_control    = 0;
-    header_.msg_hdr.msg_controllen = 0;
+    header.msg_hdr.msg_iov        = chunks;
+    header.msg_hdr.msg_iovlen     = buffers.size();
+    header.msg_hdr.msg_control    = 0;
+    header.msg_hdr.msg_controllen = 0;
 
-    if (sendmmsg(socket_, &header_, 1, send_flags) < 0) {
+    if (sendmmsg(socket_, &header, 1, send_flags) < 0) {
         UVG_LOG_ERROR("Failed to send RTP frame: %s!", strerror(errno));
         set_bytes(bytes_sent, -1);
         return RTP_SEND_ERROR;
     }
 #else
+    WSABUF wsa_buffers[MAX_BUFFER_COUNT];
     DWORD sent_bytes = 0;
 
-    // DWORD corresponds to uint16 on most platforms
-    if (buffers.size() > UINT16_MAX)
-    {
-        UVG_LOG_ERROR("Trying to send too large buffer");
-        return RTP_INVALID_VALUE;
-    }
-
     /* create WSABUFs from input buffers and send them at once */
     for (size_t i = 0; i < buffers.size(); ++i) {
-        buffers_[i].len = (ULONG)buffers.at(i).first;
-        buffers_[i].buf = (char *)buffers.at(i).second;
+        wsa_buffers[i].len = (ULONG)buffers.at(i).first;
+        wsa_buffers[i].buf = (char *)buffers.at(i).second;
     }
     int success = 0;
     if (ipv6) {
-        success = WSASendTo(socket_, buffers_, (DWORD)buffers.size(), &sent_bytes, send_flags,
+        success = WSASendTo(socket_, wsa_buffers, (DWORD)buffers.size(), &sent_bytes, send_flags,
             (SOCKADDR*)&addr6, sizeof(addr6), nullptr, nullptr);
     }
     else {
-        success = WSASendTo(socket_, buffers_, (DWORD)buffers.size(), &sent_bytes, send_flags,
+        success = WSASendTo(socket_, wsa_buffers, (DWORD)buffers.size(), &sent_bytes, send_flags,
             (SOCKADDR*)&addr, sizeof(addr), nullptr, nullptr);
     }
     if (success != 0) {
@@ -566,17 +735,12 @@ rtp_error_t uvgrtp::socket::__sendtov(
 
 rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, buf_vec& buffers, int send_flags)
 {
-    rtp_error_t ret = RTP_OK;
-    std::lock_guard<std::mutex> lg(handlers_mutex_);
-    for (auto& handler : vec_handlers_) {
-        if (handler.first.get()->load() != ssrc) {
-            continue;
-        }
-        if ((ret = (*handler.second.handler)(handler.second.arg, buffers)) != RTP_OK) {
-            UVG_LOG_ERROR("Malformed packet");
-            return ret;
-        }
-    }
+    handler_reader handlers(*this);
+    rtp_error_t ret = call_handlers(handlers.table(), ssrc, buffers);
+
+    if (ret != RTP_OK)
+        return ret;
+
     // buf_vec
     return __sendtov(addr, addr6, ipv6_, buffers, send_flags, nullptr);
 }
@@ -588,40 +752,91 @@ rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc,
     int send_flags, int *bytes_sent
 )
 {
-    rtp_error_t ret = RTP_OK;
-    std::lock_guard<std::mutex> lg(handlers_mutex_);
-    for (auto& handler : vec_handlers_) {
-        if (handler.first.get()->load() != ssrc) {
-            continue;
-        }
-        if ((ret = (*handler.second.handler)(handler.second.arg, buffers)) != RTP_OK) {
-            UVG_LOG_ERROR("Malformed packet");
-            return ret;
-        }
-    }
+    handler_reader handlers(*this);
+    rtp_error_t ret = call_handlers(handlers.table(), ssrc, buffers);
+
+    if (ret != RTP_OK)
+        return ret;
+
     // buf_vec
     return __sendtov(addr, addr6, ipv6_, buffers, send_flags, bytes_sent);
 }
 
+#ifndef _WIN32
+uvgrtp::socket::send_scratch& uvgrtp::socket::get_send_scratch()
+{
+    thread_local send_scratch scratch;
+    return scratch;
+}
+#endif
+
+uvgrtp::uring *uvgrtp::socket::get_send_ring()
+{
+#ifdef UVGRTP_HAVE_IO_URING
+    thread_local std::unique_ptr<uvgrtp::uring> ring;
+    thread_local bool failed = false;
+
+    /* closing a broken instance cancels the requests it could not wait for */
+    if (ring && ring->broken())
+        ring.reset();
+
+    if (!ring && !failed) {
+        std::unique_ptr<uvgrtp::uring> new_ring(new uvgrtp::uring());
+
+        if (new_ring->init(URING_SEND_ENTRIES) == RTP_OK)
+            ring = std::move(new_ring);
+        else
+            failed = true;
+    }
+
+    return ring.get();
+#else
+    return nullptr;
+#endif
+}
+
 rtp_error_t uvgrtp::socket::__sendtov(
     sockaddr_in& addr,
     sockaddr_in6& addr6,
     bool ipv6,
     uvgrtp::pkt_vec& buffers,
-    int send_flags, int *bytes_sent
+    int send_flags, int *bytes_sent,
+    const txtime_schedule *txtime
 )
 {
     rtp_error_t return_value = RTP_OK;
     int sent_bytes = 0;
 
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    /* a GSO buffer leaves as a whole so its packets cannot have launch times of their own */
+    if (gso_enabled_ && buffers.size() > 1 && !txtime) {
+        return __sendtov_gso(addr, addr6, ipv6, buffers, send_flags, bytes_sent);
+    }
+#endif
+
 #ifndef _WIN32
 
-    struct mmsghdr *headers = new struct mmsghdr[buffers.size()];
+    size_t iov_count = 0;
+    for (auto& buffer : buffers) {
+        iov_count += buffer.size();
+    }
+
+    send_scratch& scratch = get_send_scratch();
+
+    if (scratch.headers.size() < buffers.size())
+        scratch.headers.resize(buffers.size());
+    if (scratch.chunks.size() < iov_count)
+        scratch.chunks.resize(iov_count);
+
+    struct mmsghdr *headers = scratch.headers.data();
     struct mmsghdr *hptr = headers;
+    struct iovec *chunks = scratch.chunks.data();
 
     for (size_t i = 0; i < buffers.size(); ++i) {
-        headers[i].msg_hdr.msg_iov        = new struct iovec[buffers[i].size()];
+        headers[i].msg_hdr.msg_iov        = chunks;
         headers[i].msg_hdr.msg_iovlen     = buffers[i].size();
+        headers[i].msg_hdr.msg_flags      = 0;
+        chunks += buffers[i].size();
         if (ipv6) {
             headers[i].msg_hdr.msg_name = (void*)&addr6;
             headers[i].msg_hdr.msg_namelen = sizeof(addr6);
@@ -640,36 +855,78 @@ rtp_error_t uvgrtp::socket::__sendtov(
         }
     }
 
+#ifdef UVGRTP_TXTIME
+    if (txtime) {
+        const size_t space = CMSG_SPACE(sizeof(uint64_t));
+
+        if (scratch.control.size() < buffers.size() * space)
+            scratch.control.resize(buffers.size() * space);
+
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            uint64_t launch_time = txtime->launch_time + i * txtime->interval;
+
+            headers[i].msg_hdr.msg_control    = &scratch.control[i * space];
+            headers[i].msg_hdr.msg_controllen = space;
+
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type  = SCM_TXTIME;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint64_t));
+            memcpy(CMSG_DATA(cmsg), &launch_time, sizeof(uint64_t));
+        }
+    }
+#endif
+
     ssize_t npkts = (rce_flags_ & RCE_SYSTEM_CALL_CLUSTERING) ? 1024 : 1;
     ssize_t bptr  = buffers.size();
 
-    while (bptr > npkts) {
-        if (sendmmsg(socket_, hptr, npkts, send_flags) < 0) {
-            log_platform_error("sendmmsg(2) failed");
-            return_value = RTP_SEND_ERROR;
-            break;
-        }
+#ifdef UVGRTP_HAVE_IO_URING
+    uvgrtp::uring *ring = nullptr;
 
-        bptr -= npkts;
-        hptr += npkts;
+    if (io_uring_enabled_ && !(send_flags & MSG_ZEROCOPY) && (ring = get_send_ring()) != nullptr) {
+        size_t msgs_sent = 0;
+
+        if ((return_value = ring->sendmsg(socket_, hptr, bptr, send_flags, msgs_sent)) != RTP_OK)
+            log_platform_error("io_uring sendmsg failed");
+
+        bptr = 0;
     }
+#endif
 
-    if (return_value == RTP_OK)
-    {
-        if (sendmmsg(socket_, hptr, bptr, send_flags) < 0) {
+#ifdef UVGRTP_ZEROCOPY
+    /* reserve ids for the zero-copy messages before sending them, see zerocopy_reserved_ */
+    uint32_t zerocopy_reserved = (send_flags & MSG_ZEROCOPY) ? (uint32_t)bptr : 0;
+    uint32_t zerocopy_used = 0;
+    zerocopy_reserved_ += zerocopy_reserved;
+#endif
+
+    while (bptr > 0) {
+        int sent = sendmmsg(socket_, hptr, (unsigned int)std::min(npkts, bptr), send_flags);
+
+        if (sent < 0) {
+#ifdef UVGRTP_ZEROCOPY
+            /* the kernel could not pin more memory, the rest of the packets are copied */
+            if (errno == ENOBUFS && (send_flags & MSG_ZEROCOPY)) {
+                send_flags &= ~MSG_ZEROCOPY;
+                continue;
+            }
+#endif
             log_platform_error("sendmmsg(2) failed");
             return_value = RTP_SEND_ERROR;
+            break;
         }
-    }
 
-    for (size_t i = 0; i < buffers.size(); ++i)
-    {
-        if (headers[i].msg_hdr.msg_iov)
-        {
-            delete[] headers[i].msg_hdr.msg_iov;
-        }
+#ifdef UVGRTP_ZEROCOPY
+        if (send_flags & MSG_ZEROCOPY)
+            zerocopy_used += sent;
+#endif
+        bptr -= sent;
+        hptr += sent;
     }
-    delete[] headers;
+
+#ifdef UVGRTP_ZEROCOPY
+    zerocopy_reserved_ -= zerocopy_reserved - zerocopy_used;
+#endif
 
 #else
     INT ret = 0;
@@ -753,40 +1010,650 @@ send_:
     return return_value;
 }
 
-rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, int send_flags)
+rtp_error_t uvgrtp::socket::__sendtov_gso(
+    sockaddr_in& addr,
+    sockaddr_in6& addr6,
+    bool ipv6,
+    uvgrtp::pkt_vec& buffers,
+    int send_flags, int *bytes_sent
+)
 {
-    rtp_error_t ret = RTP_OK;
-    for (auto& buffer : buffers) {
-        std::lock_guard<std::mutex> lg(handlers_mutex_);
-        for (auto& handler : vec_handlers_) {
-            if (handler.first.get()->load() != ssrc) {
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    const size_t max_gso_bytes = UINT16_MAX - (ipv6 ? IPV6_HDR_SIZE : IPV4_HDR_SIZE) - UDP_HDR_SIZE;
+
+    send_scratch& scratch = get_send_scratch();
+    std::vector<gso_run>& runs = scratch.runs;
+    runs.clear();
+    size_t iov_count = 0;
+    int sent_bytes = 0;
+
+    /* Group consecutive packets of equal size into runs. The last segment of a GSO buffer
+     * may be shorter than the others so a shorter packet can still end the run */
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        size_t pkt_size = 0;
+        for (auto& buffer : buffers[i]) {
+            pkt_size += buffer.first;
+        }
+        sent_bytes += (int)pkt_size;
+        iov_count  += buffers[i].size();
+
+        if (!runs.empty()) {
+            gso_run& run = runs.back();
+
+            if (!run.closed &&
+                pkt_size <= run.segment_size &&
+                run.count < MAX_GSO_SEGMENTS &&
+                run.iovecs + buffers[i].size() <= MAX_GSO_IOVECS &&
+                (run.count + 1) * run.segment_size <= max_gso_bytes)
+            {
+                ++run.count;
+                run.iovecs += buffers[i].size();
+                run.closed = pkt_size < run.segment_size;
                 continue;
             }
-            if ((ret = (*handler.second.handler)(handler.second.arg, buffer)) != RTP_OK) {
-                UVG_LOG_ERROR("Malformed packet");
-                return ret;
+        }
+        runs.push_back({ i, 1, buffers[i].size(), pkt_size, false });
+    }
+
+    const size_t cmsg_space = CMSG_SPACE(sizeof(uint16_t));
+
+    if (scratch.headers.size() < runs.size())
+        scratch.headers.resize(runs.size());
+    if (scratch.chunks.size() < iov_count)
+        scratch.chunks.resize(iov_count);
+    if (scratch.control.size() < runs.size() * cmsg_space)
+        scratch.control.resize(runs.size() * cmsg_space);
+
+    struct mmsghdr *headers = scratch.headers.data();
+    struct iovec *chunks    = scratch.chunks.data();
+    char *control           = scratch.control.data();
+
+    size_t iov_idx = 0;
+    for (size_t r = 0; r < runs.size(); ++r) {
+        struct msghdr& hdr = headers[r].msg_hdr;
+        hdr = {};
+
+        if (ipv6) {
+            hdr.msg_name    = (void*)&addr6;
+            hdr.msg_namelen = sizeof(addr6);
+        }
+        else {
+            hdr.msg_name    = (void*)&addr;
+            hdr.msg_namelen = sizeof(addr);
+        }
+        hdr.msg_iov    = &chunks[iov_idx];
+        hdr.msg_iovlen = runs[r].iovecs;
+
+        for (size_t i = runs[r].first; i < runs[r].first + runs[r].count; ++i) {
+            for (auto& buffer : buffers[i]) {
+                chunks[iov_idx].iov_base = buffer.second;
+                chunks[iov_idx].iov_len  = buffer.first;
+                ++iov_idx;
             }
         }
+
+        /* a run of one packet is sent as a normal datagram */
+        if (runs[r].count > 1) {
+            uint16_t segment_size = (uint16_t)runs[r].segment_size;
+
+            hdr.msg_control    = &control[r * cmsg_space];
+            hdr.msg_controllen = cmsg_space;
+            memset(hdr.msg_control, 0, cmsg_space);
+
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(uint16_t));
+        }
     }
-    return __sendtov(addr, addr6, ipv6_, buffers, send_flags, nullptr);
+
+#ifdef UVGRTP_ZEROCOPY
+    /* reserve ids for the zero-copy messages before sending them, see zerocopy_reserved_ */
+    uint32_t zerocopy_reserved = (send_flags & MSG_ZEROCOPY) ? (uint32_t)runs.size() : 0;
+    uint32_t zerocopy_used = 0;
+    zerocopy_reserved_ += zerocopy_reserved;
+#endif
+
+    size_t hidx = 0;
+    while (hidx < runs.size()) {
+        int ret = sendmmsg(socket_, &headers[hidx], (unsigned int)(runs.size() - hidx), send_flags);
+
+        if (ret < 0) {
+#ifdef UVGRTP_ZEROCOPY
+            if (errno == ENOBUFS && (send_flags & MSG_ZEROCOPY)) {
+                send_flags &= ~MSG_ZEROCOPY;
+                continue;
+            }
+#endif
+            if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+                /* The kernel or the network device does not support GSO for this socket,
+                 * disable it and send the remaining packets one datagram at a time */
+                UVG_LOG_WARN("UDP GSO send failed: %s, disabling GSO", strerror(errno));
+                gso_enabled_ = false;
+
+#ifdef UVGRTP_ZEROCOPY
+                zerocopy_reserved_ -= zerocopy_reserved - zerocopy_used;
+#endif
+
+                uvgrtp::pkt_vec remaining(buffers.begin() + runs[hidx].first, buffers.end());
+                rtp_error_t return_value = __sendtov(addr, addr6, ipv6, remaining, send_flags, nullptr);
+
+                set_bytes(bytes_sent, (return_value == RTP_OK) ? sent_bytes : -1);
+                return return_value;
+            }
+
+            log_platform_error("sendmmsg(2) failed");
+#ifdef UVGRTP_ZEROCOPY
+            zerocopy_reserved_ -= zerocopy_reserved - zerocopy_used;
+#endif
+            set_bytes(bytes_sent, -1);
+            return RTP_SEND_ERROR;
+        }
+
+#ifdef UVGRTP_ZEROCOPY
+        if (send_flags & MSG_ZEROCOPY)
+            zerocopy_used += ret;
+#endif
+        hidx += ret;
+    }
+
+#ifdef UVGRTP_ZEROCOPY
+    zerocopy_reserved_ -= zerocopy_reserved - zerocopy_used;
+#endif
+
+#ifndef NDEBUG
+    sent_packets_ += buffers.size();
+#endif // !NDEBUG
+
+    set_bytes(bytes_sent, sent_bytes);
+    return RTP_OK;
+#else
+    (void)addr;
+    (void)addr6;
+    (void)ipv6;
+    (void)buffers;
+    (void)send_flags;
+
+    set_bytes(bytes_sent, -1);
+    return RTP_NOT_SUPPORTED;
+#endif
 }
 
-rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, int send_flags, int *bytes_sent)
+rtp_error_t uvgrtp::socket::enable_gso()
 {
-    rtp_error_t ret = RTP_OK;
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    /* kernels without GSO support do not know the socket option */
+    int gso_size = 0;
+    socklen_t len = sizeof(gso_size);
+
+    if (::getsockopt(socket_, SOL_UDP, UDP_SEGMENT, &gso_size, &len) < 0) {
+        UVG_LOG_WARN("UDP GSO is not supported: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
 
-    for (auto& buffer : buffers) {
-        std::lock_guard<std::mutex> lg(handlers_mutex_);
-        for (auto& handler : vec_handlers_) {
-            if (handler.first.get()->load() != ssrc) {
+    gso_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("UDP GSO is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::enable_gro()
+{
+#if defined(__linux__) && defined(UDP_GRO)
+    int enable = 1;
+
+    if (::setsockopt(socket_, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) < 0) {
+        UVG_LOG_WARN("UDP GRO is not supported: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    gro_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("UDP GRO is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+void uvgrtp::socket::enable_system_call_clustering()
+{
+    rce_flags_ |= RCE_SYSTEM_CALL_CLUSTERING;
+}
+
+rtp_error_t uvgrtp::socket::enable_zerocopy()
+{
+#ifdef UVGRTP_ZEROCOPY
+    int enable = 1;
+
+    if (::setsockopt(socket_, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) < 0) {
+        UVG_LOG_WARN("Zero-copy sending is not supported: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    zerocopy_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("Zero-copy sending is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::enable_io_uring()
+{
+#ifdef UVGRTP_HAVE_IO_URING
+    if (io_uring_enabled_)
+        return RTP_OK;
+
+    /* check that the kernel supports io_uring, the senders create their own instances when they need them */
+    uvgrtp::uring ring;
+    rtp_error_t ret = ring.init(URING_SEND_ENTRIES);
+
+    if (ret != RTP_OK)
+        return ret;
+
+    io_uring_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("io_uring is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+#ifdef UVGRTP_TXTIME
+/* Return the index of the interface the kernel sends to "remote" through, 0 if not known */
+static unsigned outgoing_interface(const sockaddr *remote, socklen_t remote_len)
+{
+    int probe = ::socket(remote->sa_family, SOCK_DGRAM, 0);
+    if (probe < 0)
+        return 0;
+
+    /* connecting a UDP socket only chooses the route, nothing is sent */
+    sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+
+    if (::connect(probe, remote, remote_len) < 0 ||
+        ::getsockname(probe, (sockaddr *)&local, &local_len) < 0) {
+        ::close(probe);
+        return 0;
+    }
+    ::close(probe);
+
+    struct ifaddrs *ifaddr = nullptr;
+    unsigned index = 0;
+
+    if (getifaddrs(&ifaddr) < 0)
+        return 0;
+
+    for (struct ifaddrs *ifa = ifaddr; ifa && !index; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != local.ss_family)
+            continue;
+
+        if (local.ss_family == AF_INET) {
+            if (((sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr == ((sockaddr_in *)&local)->sin_addr.s_addr)
+                index = if_nametoindex(ifa->ifa_name);
+        } else if (memcmp(&((sockaddr_in6 *)ifa->ifa_addr)->sin6_addr,
+                          &((sockaddr_in6 *)&local)->sin6_addr, sizeof(in6_addr)) == 0) {
+            index = if_nametoindex(ifa->ifa_name);
+        }
+    }
+
+    freeifaddrs(ifaddr);
+    return index;
+}
+
+/* Return true if an fq qdisc is attached to the interface, the other qdiscs ignore launch
+ * times. etf is not accepted because it drops every packet whose clock is not its own,
+ * which is normally CLOCK_TAI. The qdisc may also be a child of mq */
+static bool txtime_qdisc_attached(unsigned ifindex)
+{
+    int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        return false;
+
+    struct {
+        struct nlmsghdr hdr;
+        struct tcmsg tcm;
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.hdr.nlmsg_len   = NLMSG_LENGTH(sizeof(struct tcmsg));
+    request.hdr.nlmsg_type  = RTM_GETQDISC;
+    request.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.tcm.tcm_family  = AF_UNSPEC;
+    request.tcm.tcm_ifindex = (int)ifindex;
+
+    if (::send(fd, &request, request.hdr.nlmsg_len, 0) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    bool found = false;
+    bool done  = false;
+    std::unique_ptr<char[]> buffer(new char[16384]);
+
+    while (!done) {
+        ssize_t len = ::recv(fd, buffer.get(), 16384, 0);
+        if (len <= 0)
+            break;
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buffer.get(); NLMSG_OK(nlh, (unsigned)len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_DONE || nlh->nlmsg_type == NLMSG_ERROR) {
+                done = true;
+                break;
+            }
+
+            if (nlh->nlmsg_type != RTM_NEWQDISC)
+                continue;
+
+            struct tcmsg *tcm = (struct tcmsg *)NLMSG_DATA(nlh);
+            if (tcm->tcm_ifindex != (int)ifindex)
                 continue;
+
+            int attr_len = (int)nlh->nlmsg_len - (int)NLMSG_LENGTH(sizeof(*tcm));
+
+            for (struct rtattr *rta = TCA_RTA(tcm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                if (rta->rta_type != TCA_KIND)
+                    continue;
+
+                const char *kind = (const char *)RTA_DATA(rta);
+                if (!strcmp(kind, "fq"))
+                    found = true;
             }
-            if ((ret = (*handler.second.handler)(handler.second.arg, buffer)) != RTP_OK) {
-                UVG_LOG_ERROR("Malformed packet");
-                return ret;
+        }
+    }
+
+    ::close(fd);
+    return found;
+}
+#endif
+
+rtp_error_t uvgrtp::socket::enable_txtime(const sockaddr_in& addr, const sockaddr_in6& addr6)
+{
+#ifdef UVGRTP_TXTIME
+    /* SO_TXTIME is accepted whatever the qdisc is, so check that the packets to the remote
+     * really are sent at their launch times */
+    unsigned ifindex = ipv6_ ? outgoing_interface((const sockaddr *)&addr6, sizeof(addr6))
+                             : outgoing_interface((const sockaddr *)&addr, sizeof(addr));
+
+    if (!ifindex) {
+        UVG_LOG_WARN("Cannot find the interface the packets are sent through");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    if (!txtime_qdisc_attached(ifindex)) {
+        char name[IF_NAMESIZE] = "";
+        UVG_LOG_WARN("Interface %s has no fq qdisc, launch times would be ignored",
+            if_indextoname(ifindex, name) ? name : "?");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    struct sock_txtime config;
+    memset(&config, 0, sizeof(config));
+
+    /* fq qdisc only accepts launch times of the monotonic clock */
+    config.clockid = CLOCK_MONOTONIC;
+
+    if (::setsockopt(socket_, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) < 0) {
+        UVG_LOG_WARN("SO_TXTIME is not supported: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    txtime_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("SO_TXTIME is only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+bool uvgrtp::socket::txtime_enabled() const
+{
+    return txtime_enabled_;
+}
+
+uint64_t uvgrtp::socket::get_txtime_now()
+{
+#ifdef UVGRTP_TXTIME
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::enable_reuseport()
+{
+#if !defined(_WIN32) && defined(SO_REUSEPORT)
+    int enable = 1;
+
+    if (::setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        UVG_LOG_WARN("SO_REUSEPORT is not supported: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    reuseport_enabled_ = true;
+    return RTP_OK;
+#else
+    UVG_LOG_WARN("SO_REUSEPORT is not supported on this platform");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+bool uvgrtp::socket::reuseport_enabled() const
+{
+    return reuseport_enabled_;
+}
+
+rtp_error_t uvgrtp::socket::steer_reuseport_by_ssrc(unsigned sockets)
+{
+#ifdef UVGRTP_REUSEPORT_CBPF
+    if (sockets < 2)
+        return RTP_INVALID_VALUE;
+
+    /* The program sees the UDP payload and returns the index of the socket. RTCP packet
+     * types 200-204 have the SSRC in octets 4-7, RTP and ZRTP packets in octets 8-11.
+     * Packets too short for the load are given to the first socket */
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 1),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 200, 0, 3),
+        BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 204, 2, 0),
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JA, 1, 0, 0),
+        BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, 8),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, sockets),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+
+    struct sock_fprog program;
+    program.len    = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+
+    if (::setsockopt(socket_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        UVG_LOG_WARN("Failed to attach the SO_REUSEPORT program: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    return RTP_OK;
+#else
+    (void)sockets;
+    UVG_LOG_WARN("SO_REUSEPORT programs are only supported on Linux");
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+rtp_error_t uvgrtp::socket::get_local_address(sockaddr_in& addr, sockaddr_in6& addr6)
+{
+    struct sockaddr *local = ipv6_ ? (struct sockaddr *)&addr6 : (struct sockaddr *)&addr;
+#ifdef _WIN32
+    int len = ipv6_ ? sizeof(addr6) : sizeof(addr);
+#else
+    socklen_t len = ipv6_ ? sizeof(addr6) : sizeof(addr);
+#endif
+
+    if (::getsockname(socket_, local, &len) < 0) {
+        log_platform_error("getsockname(2) failed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::socket::sendto_txtime(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers,
+    uint64_t launch_time, uint64_t interval)
+{
+#ifdef UVGRTP_TXTIME
+    rtp_error_t ret = RTP_OK;
+
+    if ((ret = call_handlers(ssrc, buffers)) != RTP_OK)
+        return ret;
+
+    txtime_schedule txtime = { launch_time, interval };
+    return __sendtov(addr, addr6, ipv6_, buffers, 0, nullptr, &txtime);
+#else
+    (void)ssrc;
+    (void)addr;
+    (void)addr6;
+    (void)buffers;
+    (void)launch_time;
+    (void)interval;
+
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+bool uvgrtp::socket::zerocopy_enabled() const
+{
+    return zerocopy_enabled_;
+}
+
+rtp_error_t uvgrtp::socket::sendto_zerocopy(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, uint32_t& zerocopy_id)
+{
+#ifdef UVGRTP_ZEROCOPY
+    rtp_error_t ret = RTP_OK;
+
+    /* "zerocopy_id" is valid even if sending fails, some of the packets may have been sent */
+    zerocopy_id = zerocopy_reserved_;
+
+    if ((ret = call_handlers(ssrc, buffers)) != RTP_OK)
+        return ret;
+
+    ret = __sendtov(addr, addr6, ipv6_, buffers, MSG_ZEROCOPY, nullptr);
+
+    /* Every send that the kernel numbered before this one returned had reserved its ids, so this
+     * covers the packets of this call. It may also cover messages of other senders that are still
+     * being sent, which only delays the release of the buffers until those have been numbered */
+    zerocopy_id = zerocopy_reserved_;
+
+    return ret;
+#else
+    (void)ssrc;
+    (void)addr;
+    (void)addr6;
+    (void)buffers;
+    (void)zerocopy_id;
+
+    return RTP_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t uvgrtp::socket::get_zerocopy_completed()
+{
+    std::unique_lock<std::mutex> lk(zerocopy_mutex_);
+
+#ifdef UVGRTP_ZEROCOPY
+    /* the error is followed by the address of the offending node */
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(sockaddr_in6))];
+
+    while (zerocopy_enabled_) {
+        struct msghdr msg = {};
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(socket_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP   && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            /* the notification covers sends [ee_info, ee_data] */
+            zerocopy_pending_.push_back({ err.ee_info, err.ee_data + 1 });
+        }
+    }
+
+    /* the kernel usually completes the sends in order but merge any ranges that arrived early */
+    bool merged = true;
+    while (merged) {
+        merged = false;
+
+        for (size_t i = 0; i < zerocopy_pending_.size(); ++i) {
+            if (zerocopy_pending_[i].first == zerocopy_completed_) {
+                zerocopy_completed_ = zerocopy_pending_[i].second;
+                zerocopy_pending_.erase(zerocopy_pending_.begin() + i);
+                merged = true;
+                break;
             }
         }
     }
+#endif
+
+    uint32_t completed = zerocopy_completed_;
+
+    /* the ids wrap around */
+    std::vector<std::function<void()>> released;
+    while (!zerocopy_retained_.empty() && (int32_t)(completed - zerocopy_retained_.front().first) >= 0) {
+        released.push_back(std::move(zerocopy_retained_.front().second));
+        zerocopy_retained_.pop_front();
+    }
+    lk.unlock();
+
+    for (auto& release : released) {
+        release();
+    }
+
+    return completed;
+}
+
+void uvgrtp::socket::retain_zerocopy(uint32_t zerocopy_id, std::function<void()> release)
+{
+    {
+        std::lock_guard<std::mutex> lg(zerocopy_mutex_);
+        zerocopy_retained_.push_back({ zerocopy_id, std::move(release) });
+    }
+
+    // the send may have completed already
+    (void)get_zerocopy_completed();
+}
+
+rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, int send_flags)
+{
+    rtp_error_t ret = RTP_OK;
+    if ((ret = call_handlers(ssrc, buffers)) != RTP_OK)
+        return ret;
+
+    return __sendtov(addr, addr6, ipv6_, buffers, send_flags, nullptr);
+}
+
+rtp_error_t uvgrtp::socket::sendto(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, int send_flags, int *bytes_sent)
+{
+    rtp_error_t ret = RTP_OK;
+
+    if ((ret = call_handlers(ssrc, buffers)) != RTP_OK)
+        return ret;
+
     return __sendtov(addr, addr6, ipv6_, buffers, send_flags, bytes_sent);
 }
 
@@ -990,3 +1857,131 @@ rtp_error_t uvgrtp::socket::recvfrom(uint8_t *buf, size_t buf_len, int recv_flag
 {
     return __recvfrom(buf, buf_len, recv_flags, nullptr, nullptr);
 }
+
+#ifndef _WIN32
+namespace uvgrtp {
+    /* resolves to either the system recvmmsg(2) or the fallback in socket.hh */
+    static inline int recvmmsg_sys(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+    {
+        return recvmmsg(sockfd, msgvec, vlen, flags, nullptr);
+    }
+}
+#endif
+
+rtp_error_t uvgrtp::socket::recvmmsg(uint8_t **bufs, size_t buf_len, int *bytes_read, size_t count,
+    int recv_flags, int *msgs_read)
+{
+    return recvmmsg(bufs, buf_len, bytes_read, nullptr, count, recv_flags, msgs_read);
+}
+
+rtp_error_t uvgrtp::socket::recvmmsg(uint8_t **bufs, size_t buf_len, int *bytes_read, int *segment_sizes,
+    size_t count, int recv_flags, int *msgs_read)
+{
+    if (!bufs || !bytes_read || !buf_len || !count) {
+        set_bytes(msgs_read, -1);
+        return RTP_INVALID_VALUE;
+    }
+
+#ifndef _WIN32
+    const size_t cmsg_space = CMSG_SPACE(sizeof(int));
+    bool gro = gro_enabled_ && segment_sizes;
+
+    if (recv_headers_.size() < count) {
+        recv_headers_.resize(count);
+        recv_chunks_.resize(count);
+    }
+
+    if (gro && recv_control_.size() < count * cmsg_space) {
+        recv_control_.resize(count * cmsg_space);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        recv_chunks_[i].iov_base = bufs[i];
+        recv_chunks_[i].iov_len  = buf_len;
+
+        recv_headers_[i].msg_hdr            = {};
+        recv_headers_[i].msg_hdr.msg_iov    = &recv_chunks_[i];
+        recv_headers_[i].msg_hdr.msg_iovlen = 1;
+        recv_headers_[i].msg_len            = 0;
+
+        if (gro) {
+            recv_headers_[i].msg_hdr.msg_control    = &recv_control_[i * cmsg_space];
+            recv_headers_[i].msg_hdr.msg_controllen = cmsg_space;
+        }
+    }
+
+    int ret = recvmmsg_sys(socket_, recv_headers_.data(), (unsigned int)count, recv_flags);
+
+    if (ret == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            set_bytes(msgs_read, 0);
+            return RTP_INTERRUPTED;
+        }
+        UVG_LOG_ERROR("recvmmsg(2) failed: %s", strerror(errno));
+
+        set_bytes(msgs_read, -1);
+        return RTP_GENERIC_ERROR;
+    }
+
+    for (int i = 0; i < ret; ++i) {
+        bytes_read[i] = (int)recv_headers_[i].msg_len;
+
+        if (segment_sizes) {
+            segment_sizes[i] = 0;
+        }
+    }
+
+#if defined(__linux__) && defined(UDP_GRO)
+    if (gro) {
+        for (int i = 0; i < ret; ++i) {
+            struct msghdr *hdr = &recv_headers_[i].msg_hdr;
+
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    memcpy(&segment_sizes[i], CMSG_DATA(cmsg), sizeof(int));
+                    break;
+                }
+            }
+        }
+    }
+#endif
+
+#ifndef NDEBUG
+    received_packets_ += ret;
+#endif // !NDEBUG
+
+    set_bytes(msgs_read, ret);
+#else
+    /* Winsock has no batched receive, read the messages one by one */
+    int ret = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        rtp_error_t rtp_ret = recvfrom(bufs[i], buf_len, recv_flags, &bytes_read[i]);
+
+        if (segment_sizes) {
+            segment_sizes[i] = 0;
+        }
+
+        if (rtp_ret == RTP_INTERRUPTED) {
+            break;
+        }
+        else if (rtp_ret != RTP_OK) {
+            if (ret == 0) {
+                set_bytes(msgs_read, -1);
+                return rtp_ret;
+            }
+            break;
+        }
+        ++ret;
+    }
+
+    if (ret == 0) {
+        set_bytes(msgs_read, 0);
+        return RTP_INTERRUPTED;
+    }
+
+    set_bytes(msgs_read, ret);
+#endif
+
+    return RTP_OK;
+}
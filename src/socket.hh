@@ -11,6 +11,7 @@
 #include <WS2tcpip.h>
 #else
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
@@ -20,9 +21,12 @@
 #include <vector>
 #include <string>
 #include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <map>
+#include <unordered_map>
 
 #ifdef _WIN32
 typedef SOCKET socket_t;
@@ -32,6 +36,8 @@ typedef int socket_t;
 
 namespace uvgrtp {
 
+    class uring;
+
 #ifdef _WIN32
     typedef unsigned int socklen_t;
 #endif
@@ -58,6 +64,25 @@ namespace uvgrtp {
     }
 #endif
 
+#if defined(UVGRTP_HAVE_SENDMSG) && !defined(UVGRTP_HAVE_RECVMMSG)
+    static inline
+    int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+        int flags, struct timespec *timeout)
+    {
+        (void)timeout;
+        unsigned int i = 0;
+        for (; i < vlen; i++) {
+            ssize_t ret = recvmsg(sockfd, &msgvec[i].msg_hdr, flags);
+            if (ret < 0)
+                break;
+            msgvec[i].msg_len = (unsigned int)ret;
+        }
+        if (i == 0)
+            return -1;
+        return int(i);
+    }
+#endif
+
     const int MAX_BUFFER_COUNT = 256;
 
     /* Vector of buffers that contain a full RTP frame */
@@ -149,6 +174,23 @@ namespace uvgrtp {
             rtp_error_t recvfrom(uint8_t *buf, size_t buf_len, int recv_flags, int *bytes_read);
             rtp_error_t recvfrom(uint8_t *buf, size_t buf_len, int recv_flags);
 
+            /* Same as recvmmsg(2), receives up to "count" messages from remote with a single system call
+             *
+             * "bufs" must hold "count" buffers that are each at least "buf_len" bytes long.
+             * The size of each received message is written to the corresponding index of "bytes_read".
+             * On platforms without recvmmsg(2), the messages are read one at a time.
+             *
+             * Return RTP_OK on success and write the amount of messages received to "msgs_read"
+             * Return RTP_INTERRUPTED if there was nothing to read and set "msgs_read" to 0
+             * Return RTP_GENERIC_ERROR on error and set "msgs_read" to -1 */
+            rtp_error_t recvmmsg(uint8_t **bufs, size_t buf_len, int *bytes_read, size_t count,
+                int recv_flags, int *msgs_read);
+
+            /* Same as above, but if UDP GRO has been enabled, the size of the coalesced datagrams
+             * of each message is written to "segment_sizes". 0 means the message is a single datagram */
+            rtp_error_t recvmmsg(uint8_t **bufs, size_t buf_len, int *bytes_read, int *segment_sizes,
+                size_t count, int recv_flags, int *msgs_read);
+
             /* Create sockaddr_in (IPv4) object using the provided information
              * NOTE: "family" must be AF_INET */
             static sockaddr_in create_sockaddr(short family, unsigned host, short port);
@@ -182,9 +224,109 @@ namespace uvgrtp {
 
             rtp_error_t remove_handler(std::shared_ptr<std::atomic<std::uint32_t>> local_ssrc);
 
+            /* Rebuild the SSRC index of the installed handlers. Must be called when the value
+             * of an SSRC given to install_handler() changes */
+            void update_handlers();
+
             static bool is_multicast(sockaddr_in& local_address);
             static bool is_multicast(sockaddr_in6& local_address);
 
+            /* Send equal-sized consecutive packets of pkt_vec sends as UDP GSO buffers
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support UDP GSO */
+            rtp_error_t enable_gso();
+
+            /* Let the kernel coalesce received datagrams of a flow into one buffer (UDP GRO)
+             * The receive buffers given to recvmmsg() must then be large enough for any UDP payload
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support UDP GRO */
+            rtp_error_t enable_gro();
+
+            /* Send a whole pkt_vec with as few sendmmsg() calls as possible instead of
+             * one packet per system call (RCE_SYSTEM_CALL_CLUSTERING) */
+            void enable_system_call_clustering();
+
+            /* Allow sending with MSG_ZEROCOPY (SO_ZEROCOPY)
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support zero-copy sending */
+            rtp_error_t enable_zerocopy();
+            bool zerocopy_enabled() const;
+
+            /* Same as sendto() for pkt_vec but the kernel pins the buffers instead of copying them.
+             * The buffers must stay valid until get_zerocopy_completed() has reached "zerocopy_id",
+             * also when sending fails because some of the packets may have been sent.
+             * If the kernel runs out of memory for pinning, the rest of the packets are copied normally
+             *
+             * Return RTP_OK on success
+             * Return RTP_SEND_ERROR if send fails
+             * Return RTP_NOT_SUPPORTED if the platform does not support zero-copy sending */
+            rtp_error_t sendto_zerocopy(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers, uint32_t& zerocopy_id);
+
+            /* Read the zero-copy completion notifications from the error queue of the socket
+             *
+             * Return the number of zero-copy sends whose buffers the kernel no longer uses.
+             * Sends complete in order so every "zerocopy_id" up to this value is complete */
+            uint32_t get_zerocopy_completed();
+
+            /* Keep the memory of zero-copy sends whose owner goes away before the kernel is done
+             * with them. "release" is called once get_zerocopy_completed() has reached "zerocopy_id".
+             * What has not been completed when the socket is destroyed is never released because
+             * the kernel may still be reading it */
+            void retain_zerocopy(uint32_t zerocopy_id, std::function<void()> release);
+
+            /* Send the packets of pkt_vec as batches of io_uring sendmsg requests
+             * instead of with sendmmsg() (RCE_IO_URING)
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support io_uring */
+            rtp_error_t enable_io_uring();
+
+            /* Allow giving packets a launch time with SO_TXTIME (RCE_PACE_TXTIME). The interface
+             * that routes to "addr" (or "addr6" for IPv6) must have an fq qdisc
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support SO_TXTIME or if the
+             * qdisc of the interface is not fq */
+            rtp_error_t enable_txtime(const sockaddr_in& addr, const sockaddr_in6& addr6);
+            bool txtime_enabled() const;
+
+            /* Same as sendto() for pkt_vec but packet i is sent at "launch_time" + i * "interval".
+             * The times are nanoseconds of the clock returned by get_txtime_now()
+             *
+             * Return RTP_OK on success
+             * Return RTP_SEND_ERROR if send fails
+             * Return RTP_NOT_SUPPORTED if the platform does not support SO_TXTIME */
+            rtp_error_t sendto_txtime(uint32_t ssrc, sockaddr_in& addr, sockaddr_in6& addr6, pkt_vec& buffers,
+                uint64_t launch_time, uint64_t interval);
+
+            /* Current time of the SO_TXTIME clock in nanoseconds */
+            static uint64_t get_txtime_now();
+
+            /* Allow binding several sockets to the same address and port (SO_REUSEPORT).
+             * Must be called before the socket is bound
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support SO_REUSEPORT */
+            rtp_error_t enable_reuseport();
+            bool reuseport_enabled() const;
+
+            /* Make the kernel deliver each packet to the SO_REUSEPORT socket "SSRC % sockets" of the group
+             * of this socket. The SSRC is read from octets 4-7 of RTCP packets and octets 8-11 of others.
+             * Sockets are numbered in the order they were bound
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the platform does not support reuseport BPF programs */
+            rtp_error_t steer_reuseport_by_ssrc(unsigned sockets);
+
+            /* Same as getsockname(2), write the address of the socket to "addr" or "addr6"
+             *
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR on error */
+            rtp_error_t get_local_address(sockaddr_in& addr, sockaddr_in6& addr6);
+
 
         private:
 
@@ -196,9 +338,50 @@ namespace uvgrtp {
             rtp_error_t __recvfrom_ip6(uint8_t* buf, size_t buf_len, int recv_flags, sockaddr_in6* sender, int* bytes_read);
             rtp_error_t __recvfrom(uint8_t *buf, size_t buf_len, int recv_flags, sockaddr_in *sender, int *bytes_read);
 
+            /* Launch times of the packets of one pkt_vec send, see sendto_txtime() */
+            struct txtime_schedule {
+                uint64_t launch_time;
+                uint64_t interval;
+            };
+
             /* __sendtov() does the same as __sendto but it combines multiple buffers into one frame and sends them */
             rtp_error_t __sendtov(sockaddr_in& addr, sockaddr_in6& addr6, bool ipv6, buf_vec& buffers, int send_flags, int *bytes_sent);
-            rtp_error_t __sendtov(sockaddr_in& addr, sockaddr_in6& addr6, bool ipv6, uvgrtp::pkt_vec& buffers, int send_flags, int *bytes_sent);
+
+            /* If "txtime" is not nullptr, the packets are given launch times */
+            rtp_error_t __sendtov(sockaddr_in& addr, sockaddr_in6& addr6, bool ipv6, uvgrtp::pkt_vec& buffers, int send_flags, int *bytes_sent,
+                const txtime_schedule *txtime = nullptr);
+
+            /* Same as __sendtov() for pkt_vec but equal-sized packets are sent as UDP GSO buffers.
+             * If the kernel rejects GSO, it is disabled and the remaining packets are sent normally */
+            rtp_error_t __sendtov_gso(sockaddr_in& addr, sockaddr_in6& addr6, bool ipv6, uvgrtp::pkt_vec& buffers, int send_flags, int *bytes_sent);
+
+            /* Consecutive packets of pkt_vec that are sent as one UDP GSO buffer */
+            struct gso_run {
+                size_t first;        // index of the first packet in "buffers"
+                size_t count;        // number of packets in the run
+                size_t iovecs;       // number of buffers in the run
+                size_t segment_size; // size of every packet of the run except possibly the last one
+                bool closed;         // the last packet was shorter, nothing can follow it
+            };
+
+#ifndef _WIN32
+            /* __sendtov() for pkt_vec builds its messages here. The arrays only grow so once they are
+             * large enough for the biggest frame, sending doesn't allocate */
+            struct send_scratch {
+                std::vector<struct mmsghdr> headers;
+                std::vector<struct iovec>   chunks;
+                std::vector<char>           control;
+                std::vector<gso_run>        runs;
+            };
+
+            /* Return the scratch arrays of the calling thread. Each sending thread has its own so
+             * that the streams sharing a socket never wait for each other */
+            static send_scratch& get_send_scratch();
+#endif
+
+            /* Return the io_uring instance of the calling thread or nullptr if it cannot be created.
+             * An instance can send to any socket but must not be used by several threads at once */
+            static uvgrtp::uring *get_send_ring();
 
             socket_t socket_;
             //sockaddr_in remote_address_;
@@ -208,26 +391,91 @@ namespace uvgrtp {
             bool ipv6_;
 
             int rce_flags_;
+            std::atomic<bool> gso_enabled_;
+            bool gro_enabled_;
+
+            /* Immutable snapshot of vec_handlers_ that the senders read without locking */
+            struct handler_table {
+                std::vector<std::pair<std::shared_ptr<std::atomic<std::uint32_t>>, socket_packet_handler>> entries;
+
+                /* indices to "entries" by the SSRC value the table was built with */
+                std::unordered_map<uint32_t, std::vector<size_t>> by_ssrc;
+            };
+
+            /* Keeps the current handler_table alive while a sender uses it. Senders only count themselves
+             * in and out, a replaced table is freed once no sender is reading any table */
+            class handler_reader {
+                public:
+                    handler_reader(socket& sock);
+                    ~handler_reader();
 
+                    const handler_table *table() const;
+
+                private:
+                    socket& socket_;
+                    const handler_table *table_;
+            };
+
+            /* Call the handlers of "ssrc" in "table" for one packet */
+            rtp_error_t call_handlers(const handler_table *table, uint32_t ssrc, buf_vec& buffers);
+
+            /* Call the handlers of "ssrc" for every packet of "buffers" */
+            rtp_error_t call_handlers(uint32_t ssrc, pkt_vec& buffers);
+
+            /* Build a new handler_table from vec_handlers_ and publish it. Must be called with handlers_mutex_ held */
+            void publish_handlers();
+
+            /* Free the retired handler tables if no sender is reading one. Must be called with handlers_mutex_ held */
+            void free_retired_tables();
+
+            /* serializes the writers of the handler table */
             std::mutex handlers_mutex_;
             std::mutex conf_mutex_;
 
-            /* __sendto() calls these handlers in order before sending the packet */
-            std::multimap<std::shared_ptr<std::atomic<std::uint32_t>>, socket_packet_handler> buf_handlers_;
-
             /* __sendtov() calls these handlers in order before sending the packet */
             std::multimap<std::shared_ptr<std::atomic<std::uint32_t>>, socket_packet_handler> vec_handlers_;
 
+            /* The table the senders use. A replaced table is retired instead of freed because a sender
+             * may still be reading it. The retired tables are freed by publish_handlers() or by the
+             * last sender to stop reading */
+            std::atomic<const handler_table *> handler_table_;
+            std::unique_ptr<handler_table> current_table_;
+            std::vector<std::unique_ptr<handler_table>> retired_tables_;
+            std::atomic<int> table_readers_;
+            std::atomic<bool> tables_retired_;
+
+            std::atomic<bool> zerocopy_enabled_;
+
+            /* Number of messages sent with MSG_ZEROCOPY plus the messages that are being sent right now.
+             * A sender reserves ids for its messages before sending them and returns the ones it did
+             * not use, so after a send this is at least one past the ids the kernel has given so far */
+            std::atomic<uint32_t> zerocopy_reserved_;
+
+            /* Completed zero-copy sends and completions that arrived ahead of earlier ones */
+            std::mutex zerocopy_mutex_;
+            uint32_t zerocopy_completed_;
+            std::vector<std::pair<uint32_t, uint32_t>> zerocopy_pending_;
+
+            /* Memory given to retain_zerocopy(), oldest send first */
+            std::deque<std::pair<uint32_t, std::function<void()>>> zerocopy_retained_;
+
+            /* pkt_vec senders use the io_uring instance of their thread, see get_send_ring() */
+            std::atomic<bool> io_uring_enabled_;
+
+            std::atomic<bool> txtime_enabled_;
+
+            bool reuseport_enabled_;
+
 #ifndef NDEBUG
-            uint64_t sent_packets_ = 0;
+            std::atomic<uint64_t> sent_packets_{0};
             uint64_t received_packets_ = 0;
 #endif // !NDEBUG
 
-#ifdef _WIN32
-            WSABUF buffers_[MAX_BUFFER_COUNT];
-#else
-            struct mmsghdr header_;
-            struct iovec   chunks_[MAX_BUFFER_COUNT];
+#ifndef _WIN32
+            /* recvmmsg() reuses these between calls, they are only touched by the receiving thread */
+            std::vector<struct mmsghdr> recv_headers_;
+            std::vector<struct iovec>   recv_chunks_;
+            std::vector<char>           recv_control_;
 #endif
     };
 }
@@ -2,6 +2,7 @@
 #include "socket.hh"
 #include "uvgrtp/frame.hh"
 #include "rtcp_reader.hh"
+#include "reactor.hh"
 #include "random.hh"
 #include "global.hh"
 #include "debug.hh"
@@ -23,9 +24,13 @@
 #include <algorithm>
 #include <cstring>
 #include <iterator>
+#include <thread>
 
 constexpr size_t DEFAULT_INITIAL_BUFFER_SIZE = 4194304;
 
+/* More reactor threads rarely pay off since each of them serves many sockets */
+constexpr unsigned DEFAULT_REACTOR_THREADS = 4;
+
 uvgrtp::socketfactory::socketfactory(int rce_flags) :
     rce_flags_(rce_flags),
     local_address_(""),
@@ -33,7 +38,11 @@ uvgrtp::socketfactory::socketfactory(int rce_flags) :
     ipv6_(false),
     used_sockets_({}),
     reception_flows_({}),
-    rtcp_readers_to_ports_({})
+    rtcp_readers_to_ports_({}),
+    reactor_mutex_(),
+    reactor_threads_(0),
+    user_driven_reactor_(false),
+    reactor_(nullptr)
 {
 }
 
@@ -61,7 +70,7 @@ rtp_error_t uvgrtp::socketfactory::set_local_interface(std::string local_addr)
     return RTP_OK;
 }
 
-std::shared_ptr<uvgrtp::socket> uvgrtp::socketfactory::create_new_socket(int type, uint16_t port)
+std::shared_ptr<uvgrtp::socket> uvgrtp::socketfactory::create_new_socket(int type, uint16_t port, int rce_flags)
 {
     rtp_error_t ret = RTP_OK;
     std::shared_ptr<uvgrtp::socket> socket = std::make_shared<uvgrtp::socket>(rce_flags_);
@@ -85,6 +94,11 @@ std::shared_ptr<uvgrtp::socket> uvgrtp::socketfactory::create_new_socket(int typ
     }
 #endif
 
+    /* SO_REUSEPORT must be set before binding, the reception flow opens the other sockets of the port */
+    if (type == 2 && (rce_flags & RCE_REUSEPORT_SHARDING)) {
+        (void)socket->enable_reuseport();
+    }
+
     if (ret == RTP_OK) {
         used_sockets_.push_back(socket);
         if (port != 0) {
@@ -168,14 +182,14 @@ rtp_error_t uvgrtp::socketfactory::bind_socket_anyip(std::shared_ptr<uvgrtp::soc
     return ret;
 }
 
-std::shared_ptr<uvgrtp::socket> uvgrtp::socketfactory::get_socket_ptr(int type, uint16_t port)
+std::shared_ptr<uvgrtp::socket> uvgrtp::socketfactory::get_socket_ptr(int type, uint16_t port, int rce_flags)
 {
     std::lock_guard<std::mutex> lg(conf_mutex_);
     const auto& ptr = used_ports_.find(port);
     if (ptr != used_ports_.end()) {
         return ptr->second;
     }
-    return create_new_socket(type, port);
+    return create_new_socket(type, port, rce_flags);
 }
 
 std::shared_ptr<uvgrtp::reception_flow> uvgrtp::socketfactory::get_reception_flow_ptr(std::shared_ptr<uvgrtp::socket> socket) 
@@ -206,6 +220,45 @@ std::shared_ptr <uvgrtp::rtcp_reader> uvgrtp::socketfactory::get_rtcp_reader(uin
     return nullptr;
 }
 
+std::shared_ptr<uvgrtp::reactor> uvgrtp::socketfactory::get_reactor()
+{
+    std::lock_guard<std::mutex> lg(reactor_mutex_);
+
+    if (user_driven_reactor_) {
+        return std::make_shared<uvgrtp::reactor>(0);
+    }
+
+    if (!reactor_) {
+        unsigned threads = reactor_threads_;
+
+        if (threads == 0)
+            threads = std::max(std::min(std::thread::hardware_concurrency(), DEFAULT_REACTOR_THREADS), 1u);
+
+        reactor_ = std::make_shared<uvgrtp::reactor>(threads);
+    }
+
+    return reactor_;
+}
+
+rtp_error_t uvgrtp::socketfactory::set_reactor_threads(unsigned threads)
+{
+    std::lock_guard<std::mutex> lg(reactor_mutex_);
+
+    if (reactor_) {
+        UVG_LOG_ERROR("The reactor is already in use, its threads cannot be changed");
+        return RTP_GENERIC_ERROR;
+    }
+
+    reactor_threads_ = threads;
+    return RTP_OK;
+}
+
+void uvgrtp::socketfactory::set_user_driven_reactor(bool enabled)
+{
+    std::lock_guard<std::mutex> lg(reactor_mutex_);
+    user_driven_reactor_ = enabled;
+}
+
 bool uvgrtp::socketfactory::get_ipv6() const
 {
     return ipv6_;
@@ -13,6 +13,7 @@ namespace uvgrtp {
     class socket;
     class reception_flow;
     class rtcp_reader;
+    class reactor;
 
     /* This class keeps track of all the sockets that uvgRTP is using. 
      * Each socket will have either a reception_flow or an rtcp_reader depending on what the socket
@@ -44,8 +45,10 @@ namespace uvgrtp {
              * will use the correct IP version
              *
              * Param type 1 RTCP socket, 2 for any other type of a socket
+             * Param rce_flags flags of the stream that creates the socket. With RCE_REUSEPORT_SHARDING
+             * the socket allows the reception flow to bind more sockets to the same port
              * Return the created socket on success, nullptr otherwise */
-            std::shared_ptr<uvgrtp::socket> create_new_socket(int , uint16_t port);
+            std::shared_ptr<uvgrtp::socket> create_new_socket(int type, uint16_t port, int rce_flags = RCE_NO_FLAGS);
 
             /* Bind socket to the local IP address and given port
              * 
@@ -64,8 +67,9 @@ namespace uvgrtp {
             /* Get the socket bound to the given port
              *
              * Param port socket with wanted port
+             * Param rce_flags flags given to create_new_socket() if the socket is created
              * Return pointer to socket on success. If one does not exist, a new one is created */
-            std::shared_ptr<uvgrtp::socket> get_socket_ptr(int type, uint16_t port);
+            std::shared_ptr<uvgrtp::socket> get_socket_ptr(int type, uint16_t port, int rce_flags = RCE_NO_FLAGS);
 
             /* Get reception flow matching the given socket
              *
@@ -93,6 +97,23 @@ namespace uvgrtp {
              * true on success */
             bool clear_port(uint16_t port, std::shared_ptr<uvgrtp::socket> socket);
 
+            /* Get the reactor shared by the streams using RCE_REACTOR. It is created on first use.
+             * If the reactor is user-driven, every call creates a new reactor without threads
+             *
+             * Return pointer to the reactor */
+            std::shared_ptr<uvgrtp::reactor> get_reactor();
+
+            /* Set the number of reactor threads. Must be called before the reactor is used
+             *
+             * Param threads number of threads, 0 for the default
+             * Return RTP_OK on success
+             * Return RTP_GENERIC_ERROR if the reactor is already in use */
+            rtp_error_t set_reactor_threads(unsigned threads);
+
+            /* Give every stream created after this with RCE_REACTOR a reactor of its own that is
+             * run by the application, see uvgrtp::context::set_user_driven_reactor() */
+            void set_user_driven_reactor(bool enabled);
+
             /// \cond DO_NOT_DOCUMENT
             bool get_ipv6() const;
             bool is_port_in_use(uint16_t port);
@@ -110,5 +131,10 @@ namespace uvgrtp {
             std::map<std::shared_ptr<uvgrtp::reception_flow>, std::shared_ptr<uvgrtp::socket>> reception_flows_;
             std::map<std::shared_ptr<uvgrtp::rtcp_reader>, uint16_t> rtcp_readers_to_ports_;
 
+            std::mutex reactor_mutex_;
+            unsigned reactor_threads_;
+            bool user_driven_reactor_;
+            std::shared_ptr<uvgrtp::reactor> reactor_;
+
     };
 }
\ No newline at end of file
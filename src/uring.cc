@@ -0,0 +1,391 @@
+#include "uring.hh"
+
+#ifdef UVGRTP_HAVE_IO_URING
+
+#include "debug.hh"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+/* The kernel does not accept provided buffer rings larger than this */
+constexpr unsigned MAX_BUFFER_RING_ENTRIES = 1 << 15;
+
+/* The user data of a sendmsg() request holds the number of the call in the upper half
+ * and the index of the message in the lower half */
+constexpr uint64_t SEND_GENERATION_MASK = 0xffffffff00000000ULL;
+
+uvgrtp::uring::uring() :
+    fd_(-1),
+    rings_(nullptr),
+    rings_size_(0),
+    sqes_(nullptr),
+    sqes_size_(0),
+    sq_head_(nullptr),
+    sq_tail_(nullptr),
+    sq_array_(nullptr),
+    sq_mask_(0),
+    sq_entries_(0),
+    sqe_tail_(0),
+    sqe_submitted_(0),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cqes_(nullptr),
+    cq_mask_(0),
+    buf_ring_(nullptr),
+    buf_ring_size_(0),
+    buf_ring_mask_(0),
+    buf_ring_tail_(0),
+    buf_group_(0),
+    send_generation_(0),
+    broken_(false)
+{}
+
+uvgrtp::uring::~uring()
+{
+    unregister_buffer_ring();
+
+    if (sqes_)
+        munmap(sqes_, sqes_size_);
+
+    if (rings_)
+        munmap(rings_, rings_size_);
+
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+rtp_error_t uvgrtp::uring::init(unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    if ((fd_ = (int)syscall(__NR_io_uring_setup, entries, &params)) < 0) {
+        UVG_LOG_WARN("io_uring_setup(2) failed: %s", strerror(errno));
+        return RTP_NOT_SUPPORTED;
+    }
+
+    /* waiting with a timeout needs IORING_ENTER_EXT_ARG (Linux 5.11) */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        UVG_LOG_WARN("The kernel is too old for the io_uring I/O engine");
+        return RTP_NOT_SUPPORTED;
+    }
+
+    rings_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                           params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe));
+    sqes_size_  = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    rings_ = mmap(nullptr, rings_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (rings_ == MAP_FAILED) {
+        UVG_LOG_ERROR("Failed to map io_uring rings: %s", strerror(errno));
+        rings_ = nullptr;
+        return RTP_MEMORY_ERROR;
+    }
+
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        UVG_LOG_ERROR("Failed to map io_uring submission entries: %s", strerror(errno));
+        return RTP_MEMORY_ERROR;
+    }
+    sqes_ = (struct io_uring_sqe *)sqes;
+
+    uint8_t *base = (uint8_t *)rings_;
+
+    sq_head_    = (unsigned *)(base + params.sq_off.head);
+    sq_tail_    = (unsigned *)(base + params.sq_off.tail);
+    sq_array_   = (unsigned *)(base + params.sq_off.array);
+    sq_mask_    = *(unsigned *)(base + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_   = *sq_tail_;
+    sqe_submitted_ = sqe_tail_;
+
+    cq_head_ = (unsigned *)(base + params.cq_off.head);
+    cq_tail_ = (unsigned *)(base + params.cq_off.tail);
+    cqes_    = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+    cq_mask_ = *(unsigned *)(base + params.cq_off.ring_mask);
+
+    return RTP_OK;
+}
+
+struct io_uring_sqe *uvgrtp::uring::get_sqe()
+{
+    /* make room by handing the prepared submissions to the kernel */
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+        (void)submit(0, 0, nullptr, 0);
+
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+        return nullptr;
+
+    unsigned index = sqe_tail_ & sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+
+    return sqe;
+}
+
+int uvgrtp::uring::submit(unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+    unsigned to_submit = sqe_tail_ - sqe_submitted_;
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+
+    int ret = (int)syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, arg, arg_size);
+
+    if (ret > 0)
+        sqe_submitted_ += (unsigned)ret;
+
+    return ret;
+}
+
+void uvgrtp::uring::discard_unsubmitted()
+{
+    /* without SQPOLL, the kernel only reads the submission queue inside io_uring_enter(2) */
+    sqe_tail_ = sqe_submitted_;
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+}
+
+bool uvgrtp::uring::broken() const
+{
+    return broken_;
+}
+
+rtp_error_t uvgrtp::uring::sendmsg(int fd, struct mmsghdr *headers, size_t count, int send_flags, size_t& msgs_sent)
+{
+    int error = 0;
+    msgs_sent = 0;
+
+    if (broken_) {
+        errno = EIO;
+        return RTP_SEND_ERROR;
+    }
+
+    uint64_t generation = (uint64_t)(++send_generation_) << 32;
+
+    while (msgs_sent < count && !error) {
+        unsigned batch = (unsigned)std::min(count - msgs_sent, (size_t)sq_entries_);
+        unsigned batch_start = sqe_submitted_;
+        unsigned queued = 0;
+        struct io_uring_sqe *last = nullptr;
+
+        for (; queued < batch; ++queued) {
+            struct io_uring_sqe *sqe = get_sqe();
+
+            if (!sqe)
+                break;
+
+            sqe->opcode    = IORING_OP_SENDMSG;
+            sqe->fd        = fd;
+            sqe->addr      = (uint64_t)(uintptr_t)&headers[msgs_sent + queued].msg_hdr;
+            sqe->len       = 1;
+            sqe->msg_flags = (uint32_t)send_flags;
+            sqe->user_data = generation | queued;
+
+            /* a failed send cancels the rest of the batch so that no packet overtakes another */
+            sqe->flags = IOSQE_IO_LINK;
+            last = sqe;
+        }
+
+        if (!last) {
+            error = EBUSY;
+            break;
+        }
+        last->flags = 0;
+
+        unsigned completed = 0;
+        unsigned sent      = 0;
+
+        /* Every request given to the kernel must complete before returning because the next call
+         * reuses "headers" */
+        while (completed < queued) {
+            struct io_uring_cqe cqe;
+
+            if (next_completion(cqe)) {
+                /* left behind by an earlier call that could not wait for its requests */
+                if ((cqe.user_data & SEND_GENERATION_MASK) != generation)
+                    continue;
+
+                if (cqe.res >= 0)
+                    ++sent;
+                else if (!error || error == ECANCELED)
+                    error = -cqe.res;
+
+                ++completed;
+                continue;
+            }
+
+            if (submit(queued - completed, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                if (!error)
+                    error = errno;
+
+                if (sqe_tail_ != sqe_submitted_) {
+                    /* the kernel did not take the rest of the batch, only wait for the requests it has */
+                    discard_unsubmitted();
+                    queued = sqe_submitted_ - batch_start;
+                    continue;
+                }
+
+                UVG_LOG_ERROR("Cannot wait for io_uring sends to complete: %s", strerror(errno));
+                broken_ = true;
+                break;
+            }
+        }
+
+        msgs_sent += sent;
+    }
+
+    if (error) {
+        errno = error;
+        return RTP_SEND_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::uring::register_buffer_ring(uint16_t group, unsigned entries)
+{
+    unsigned ring_entries = 1;
+    while (ring_entries < entries)
+        ring_entries <<= 1;
+
+    if (ring_entries > MAX_BUFFER_RING_ENTRIES) {
+        UVG_LOG_WARN("io_uring supports at most %u receive buffers, %u requested", MAX_BUFFER_RING_ENTRIES, entries);
+        return RTP_NOT_SUPPORTED;
+    }
+
+    /* the ring must be page aligned */
+    size_t size = ring_entries * sizeof(struct io_uring_buf);
+    void *ring  = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ring == MAP_FAILED) {
+        UVG_LOG_ERROR("Failed to allocate io_uring buffer ring: %s", strerror(errno));
+        return RTP_MEMORY_ERROR;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+
+    reg.ring_addr    = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = ring_entries;
+    reg.bgid         = group;
+
+    if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        UVG_LOG_WARN("Provided buffer rings are not supported: %s", strerror(errno));
+        munmap(ring, size);
+        return RTP_NOT_SUPPORTED;
+    }
+
+    buf_ring_      = (struct io_uring_buf_ring *)ring;
+    buf_ring_size_ = size;
+    buf_ring_mask_ = ring_entries - 1;
+    buf_ring_tail_ = 0;
+    buf_group_     = group;
+
+    return RTP_OK;
+}
+
+void uvgrtp::uring::unregister_buffer_ring()
+{
+    if (!buf_ring_)
+        return;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = buf_group_;
+
+    (void)syscall(__NR_io_uring_register, fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+    munmap(buf_ring_, buf_ring_size_);
+    buf_ring_ = nullptr;
+}
+
+void uvgrtp::uring::provide_buffer(uint8_t *buf, unsigned len, uint16_t bid)
+{
+    /* In C++, the flexible array of the uapi header starts after an empty struct and
+     * io_uring_buf_ring::bufs does not point to the start of the ring. The ring is just an
+     * array of io_uring_buf whose first entry holds the tail */
+    struct io_uring_buf *entry = (struct io_uring_buf *)buf_ring_ + (buf_ring_tail_ & buf_ring_mask_);
+
+    entry->addr = (uint64_t)(uintptr_t)buf;
+    entry->len  = len;
+    entry->bid  = bid;
+    ++buf_ring_tail_;
+}
+
+void uvgrtp::uring::publish_buffers()
+{
+    __atomic_store_n(&buf_ring_->tail, buf_ring_tail_, __ATOMIC_RELEASE);
+}
+
+rtp_error_t uvgrtp::uring::recv_multishot(int fd, uint16_t group, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    if (!sqe)
+        return RTP_GENERIC_ERROR;
+
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = group;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->user_data = user_data;
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::uring::cancel(uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+
+    if (!sqe)
+        return RTP_GENERIC_ERROR;
+
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = user_data;
+    sqe->user_data = 0;
+
+    return RTP_OK;
+}
+
+rtp_error_t uvgrtp::uring::wait(int timeout_ms)
+{
+    struct __kernel_timespec ts;
+    ts.tv_sec  = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+
+    if (submit(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0) {
+        if (errno == ETIME || errno == EINTR)
+            return RTP_INTERRUPTED;
+
+        UVG_LOG_ERROR("io_uring_enter(2) failed: %s", strerror(errno));
+        return RTP_GENERIC_ERROR;
+    }
+
+    return RTP_OK;
+}
+
+bool uvgrtp::uring::next_completion(struct io_uring_cqe& cqe)
+{
+    unsigned head = *cq_head_;
+
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+        return false;
+
+    cqe = cqes_[head & cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+#endif
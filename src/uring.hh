@@ -0,0 +1,120 @@
+#pragma once
+
+#include "uvgrtp/util.hh"
+
+#ifdef UVGRTP_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+namespace uvgrtp {
+
+    /* Minimal io_uring instance used by socket and reception_flow when RCE_IO_URING is set.
+     *
+     * The rings are set up with the raw system calls so liburing is not needed. An instance
+     * is not thread-safe, it must only be used by one thread at a time */
+    class uring {
+        public:
+            uring();
+            ~uring();
+
+            /* Create the instance with room for "entries" submissions
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the kernel does not support the needed io_uring features */
+            rtp_error_t init(unsigned entries);
+
+            /* Send "count" messages with one linked sendmsg request each so that they leave in order
+             * and wait until all of them have completed. The kernel no longer uses "headers" when this
+             * returns, also on error
+             *
+             * Return RTP_OK on success and write the number of messages sent to "msgs_sent"
+             * Return RTP_SEND_ERROR if a message could not be sent, errno is set accordingly */
+            rtp_error_t sendmsg(int fd, struct mmsghdr *headers, size_t count, int send_flags, size_t& msgs_sent);
+
+            /* Return true if sendmsg() could not wait for its requests. The instance must then be
+             * destroyed, which makes the kernel cancel them */
+            bool broken() const;
+
+            /* Register a ring of provided buffers with room for at least "entries" buffers
+             *
+             * Return RTP_OK on success
+             * Return RTP_NOT_SUPPORTED if the kernel does not support provided buffer rings */
+            rtp_error_t register_buffer_ring(uint16_t group, unsigned entries);
+            void unregister_buffer_ring();
+
+            /* Add one buffer to the end of the provided buffer ring. The kernel sees the
+             * buffers once publish_buffers() has been called */
+            void provide_buffer(uint8_t *buf, unsigned len, uint16_t bid);
+            void publish_buffers();
+
+            /* Queue a multishot receive that fills buffers of "group" until it fails or is cancelled.
+             * Every completion of it carries "user_data" and the id of the used buffer */
+            rtp_error_t recv_multishot(int fd, uint16_t group, uint64_t user_data);
+
+            /* Queue a cancellation of all requests carrying "user_data" */
+            rtp_error_t cancel(uint64_t user_data);
+
+            /* Submit the queued requests and wait at most "timeout_ms" for a completion
+             *
+             * Return RTP_OK if there are completions to read
+             * Return RTP_INTERRUPTED if the wait timed out or was interrupted by a signal
+             * Return RTP_GENERIC_ERROR on error */
+            rtp_error_t wait(int timeout_ms);
+
+            /* Copy the oldest unread completion to "cqe"
+             *
+             * Return false if there are no completions left */
+            bool next_completion(struct io_uring_cqe& cqe);
+
+        private:
+            struct io_uring_sqe *get_sqe();
+            int submit(unsigned min_complete, unsigned flags, void *arg, size_t arg_size);
+
+            /* Take back the prepared submissions that the kernel has not taken yet */
+            void discard_unsubmitted();
+
+            int fd_;
+
+            void *rings_;
+            size_t rings_size_;
+            struct io_uring_sqe *sqes_;
+            size_t sqes_size_;
+
+            unsigned *sq_head_;
+            unsigned *sq_tail_;
+            unsigned *sq_array_;
+            unsigned sq_mask_;
+            unsigned sq_entries_;
+
+            /* submissions that have been prepared but not yet given to the kernel */
+            unsigned sqe_tail_;
+            unsigned sqe_submitted_;
+
+            unsigned *cq_head_;
+            unsigned *cq_tail_;
+            struct io_uring_cqe *cqes_;
+            unsigned cq_mask_;
+
+            struct io_uring_buf_ring *buf_ring_;
+            size_t buf_ring_size_;
+            unsigned buf_ring_mask_;
+            uint16_t buf_ring_tail_;
+            uint16_t buf_group_;
+
+            /* sendmsg() calls are numbered so that a call never counts the completions of another */
+            uint32_t send_generation_;
+            bool broken_;
+    };
+}
+
+#else
+
+namespace uvgrtp {
+    /* io_uring is not available on this platform, an instance is never created */
+    class uring {};
+}
+
+#endif
+
+namespace uvg_rtp = uvgrtp;
@@ -0,0 +1,166 @@
+#include "allocation_counter.hh"
+
+#include <cstdlib>
+#include <new>
+
+static thread_local bool count_allocations = false;
+static thread_local size_t allocations = 0;
+
+void start_counting_allocations()
+{
+    allocations = 0;
+    count_allocations = true;
+}
+
+size_t stop_counting_allocations()
+{
+    count_allocations = false;
+    return allocations;
+}
+
+static void* allocate(std::size_t size) noexcept
+{
+    if (count_allocations)
+        ++allocations;
+
+    return std::malloc(size ? size : 1);
+}
+
+static void* allocate_aligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+    if (count_allocations)
+        ++allocations;
+
+    size = size ? size : 1;
+
+#ifdef _WIN32
+    return _aligned_malloc(size, (std::size_t)alignment);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, (std::size_t)alignment, size) != 0)
+        return nullptr;
+
+    return ptr;
+#endif
+}
+
+static void deallocate_aligned(void* ptr) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* ptr = allocate(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* ptr = allocate(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = allocate_aligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = allocate_aligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    deallocate_aligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    deallocate_aligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    deallocate_aligned(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    deallocate_aligned(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    deallocate_aligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    deallocate_aligned(ptr);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+/* Heap allocation counting of the calling thread.
+ *
+ * allocation_counter.cpp replaces the global allocation functions, so it is only linked to
+ * uvgrtp_allocation_test and the other test suites run with the normal allocator */
+
+// start counting the allocations of the calling thread from zero
+void start_counting_allocations();
+
+// stop counting and return the number of allocations since start_counting_allocations()
+size_t stop_counting_allocations();
@@ -0,0 +1,89 @@
+// Tests the reuse of received RTP frames and their payloads by the frame pool
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test_common.hh"
+
+#include "../src/rtp.hh"
+
+#include <uvgrtp/frame.hh>
+
+constexpr size_t FP_PAYLOAD_SIZE = 1000;
+
+// parses one RTP packet into a frame and deallocates it
+static bool receive_packet(uvgrtp::rtp& rtp, uint8_t* packet, size_t size)
+{
+    uvgrtp::frame::rtp_frame* frame = nullptr;
+
+    bool ok = rtp.packet_handler(nullptr, RCE_NO_FLAGS, packet, size, &frame) == RTP_PKT_MODIFIED;
+    ok = ok && frame->payload_len == FP_PAYLOAD_SIZE && frame->payload[0] == 'a';
+    ok = ok && uvgrtp::frame::dealloc_frame(frame) == RTP_OK;
+
+    return ok;
+}
+
+TEST(FramePoolTests, rtp_frame_reuse)
+{
+    std::cout << "Starting RTP frame pool reuse test" << std::endl;
+
+    auto ssrc = std::make_shared<std::atomic<uint32_t>>(1234);
+    uvgrtp::rtp rtp(RTP_FORMAT_GENERIC, ssrc, false);
+
+    uint8_t packet[12 + FP_PAYLOAD_SIZE] = {};
+    packet[0] = 2 << 6;
+    memset(packet + 12, 'a', FP_PAYLOAD_SIZE);
+
+    EXPECT_TRUE(receive_packet(rtp, packet, sizeof(packet)));
+
+    // once the pool is warm, frames and their payloads don't touch the heap
+    uvgrtp::frame::pool_stats before = uvgrtp::frame::get_pool_stats();
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(receive_packet(rtp, packet, sizeof(packet)));
+    }
+    uvgrtp::frame::pool_stats after = uvgrtp::frame::get_pool_stats();
+    EXPECT_EQ(before.allocations, after.allocations);
+    EXPECT_LE(before.reuses + 200, after.reuses);
+    EXPECT_LT(0u, after.cached_bytes);
+
+    // frames deallocated by another thread are reused by the thread receiving them
+    std::vector<uvgrtp::frame::rtp_frame*> frames;
+    for (int i = 0; i < 50; ++i)
+    {
+        frames.push_back(uvgrtp::frame::alloc_rtp_frame(FP_PAYLOAD_SIZE));
+    }
+    std::thread user([&]() {
+        for (auto& frame : frames)
+        {
+            EXPECT_EQ(RTP_OK, uvgrtp::frame::dealloc_frame(frame));
+        }
+    });
+    user.join();
+
+    before = uvgrtp::frame::get_pool_stats();
+    for (auto& frame : frames)
+    {
+        frame = uvgrtp::frame::alloc_rtp_frame(FP_PAYLOAD_SIZE);
+    }
+    after = uvgrtp::frame::get_pool_stats();
+    EXPECT_EQ(before.allocations, after.allocations);
+
+    for (auto& frame : frames)
+    {
+        EXPECT_EQ(RTP_OK, uvgrtp::frame::dealloc_frame(frame));
+    }
+
+    // without a budget, nothing is kept for a thread that has no cache of its own
+    uvgrtp::frame::set_pool_budget(0);
+    before = uvgrtp::frame::get_pool_stats();
+    std::thread receiver([&]() {
+        EXPECT_TRUE(receive_packet(rtp, packet, sizeof(packet)));
+        EXPECT_TRUE(receive_packet(rtp, packet, sizeof(packet)));
+    });
+    receiver.join();
+    after = uvgrtp::frame::get_pool_stats();
+    EXPECT_LE(before.allocations + 4, after.allocations);
+    uvgrtp::frame::set_pool_budget(16 * 1024 * 1024);
+}
@@ -1,6 +1,14 @@
 #include "test_common.hh"
 
+#include "../src/socket.hh"
+
 #include <numeric>
+#include <atomic>
+#include <mutex>
+
+#ifdef __linux__
+#include <time.h>
+#endif
 
 constexpr uint16_t SEND_PORT = 9100;
 constexpr char LOCAL_ADDRESS[] = "127.0.0.1";
@@ -271,6 +279,480 @@ TEST(FormatTests, h265_fragmentation)
     cleanup_sess(ctx, sess);
 }
 
+/* Return true if "enable" succeeds on a UDP socket of this system. The streams of the tests below
+ * fall back to sending and receiving normally when a feature is not available, so they are skipped
+ * instead of passing without testing anything */
+static bool socket_supports(rtp_error_t (uvgrtp::socket::*enable)())
+{
+    uvgrtp::socket socket(RCE_NO_FLAGS);
+    return socket.init(AF_INET, SOCK_DGRAM, 0) == RTP_OK && (socket.*enable)() == RTP_OK;
+}
+
+TEST(FormatTests, h265_fragmentation_gso)
+{
+    if (!socket_supports(&uvgrtp::socket::enable_gso))
+    {
+        GTEST_SKIP() << "UDP GSO is not supported";
+    }
+
+    std::cout << "Starting h265 fragmentation test with UDP GSO" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_UDP_GSO);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+    }
+
+    // sizes where the last fragment is both shorter than and equal to the others
+    std::vector<size_t> test_sizes = { 1501, 1446 * 2, 1446 * 2 + 1, 10000, 50000, 200000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 10;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+#ifdef __linux__
+/* CPU time the calling thread spends pushing "frames" H265 frames of "size" bytes with "rce_flags".
+ * Nothing reads the packets, the receiving socket only keeps loopback from answering with ICMP */
+static double push_frames_cpu_seconds(int rce_flags, size_t size, int frames)
+{
+    uvgrtp::socket sink(RCE_NO_FLAGS);
+    sockaddr_in sink_addr = uvgrtp::socket::create_sockaddr(AF_INET, LOCAL_ADDRESS, RECEIVE_PORT);
+    EXPECT_EQ(RTP_OK, sink.init(AF_INET, SOCK_DGRAM, 0));
+    EXPECT_EQ(RTP_OK, sink.bind(sink_addr));
+
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+    uvgrtp::media_stream* sender = sess ? sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265,
+        rce_flags | RCE_SEND_ONLY) : nullptr;
+
+    double seconds = 0;
+    if (sender)
+    {
+        std::unique_ptr<uint8_t[]> frame = create_test_packet(RTP_FORMAT_H265, 1, true, size, RTP_NO_FLAGS);
+
+        timespec start = {};
+        timespec end = {};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+
+        for (int i = 0; i < frames; ++i)
+        {
+            EXPECT_EQ(RTP_OK, sender->push_frame(frame.get(), size, RTP_NO_FLAGS));
+        }
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_sess(ctx, sess);
+    return seconds;
+}
+
+TEST(FormatTests, DISABLED_h265_gso_throughput)
+{
+    // Measure the CPU time of sending large frames with and without UDP GSO. Nothing is asserted about the
+    // speed, run with --gtest_also_run_disabled_tests --gtest_filter=*throughput to see the results.
+    // On loopback the kernel also segments the GSO buffers on the sending thread, a NIC would do it in hardware
+    constexpr size_t FRAME_SIZE = 200000;
+    constexpr int FRAMES = 500;
+
+    const std::vector<std::pair<const char*, int>> modes = {
+        { "sendto", RCE_NO_FLAGS },
+        { "sendmmsg", RCE_SYSTEM_CALL_CLUSTERING },
+        { "GSO", RCE_UDP_GSO },
+    };
+
+    for (auto& mode : modes)
+    {
+        if (mode.second == RCE_UDP_GSO && !socket_supports(&uvgrtp::socket::enable_gso))
+        {
+            std::cout << mode.first << " is not supported" << std::endl;
+            continue;
+        }
+
+        double seconds = push_frames_cpu_seconds(mode.second, FRAME_SIZE, FRAMES);
+        std::cout << mode.first << ": " << seconds * 1e6 / FRAMES << " us of CPU per frame, "
+            << (double)FRAME_SIZE * FRAMES * 8 / seconds / 1e9 << " Gbps per core" << std::endl;
+    }
+}
+#endif
+
+TEST(FormatTests, h265_fragmentation_gro)
+{
+    if (!socket_supports(&uvgrtp::socket::enable_gso) || !socket_supports(&uvgrtp::socket::enable_gro))
+    {
+        GTEST_SKIP() << "UDP GSO or GRO is not supported";
+    }
+
+    std::cout << "Starting h265 fragmentation test with UDP GRO" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    // on loopback, GSO buffers of the sender reach the GRO receiver without being segmented
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_UDP_GSO);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_UDP_GRO);
+    }
+
+    std::vector<size_t> test_sizes = { 1000, 1501, 1446 * 2, 1446 * 2 + 1, 10000, 50000, 200000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 10;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+TEST(FormatTests, h265_fragmentation_io_uring)
+{
+    if (!socket_supports(&uvgrtp::socket::enable_io_uring))
+    {
+        GTEST_SKIP() << "io_uring is not supported";
+    }
+
+    std::cout << "Starting h265 fragmentation test with io_uring" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_IO_URING | RCE_SYSTEM_CALL_CLUSTERING);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_IO_URING);
+    }
+
+    // the receiver recreates its ring while the kernel owns the old one
+    if (receiver)
+    {
+        EXPECT_EQ(RTP_OK, receiver->configure_ctx(RCC_RING_BUFFER_SIZE, 8 * 1024 * 1024));
+    }
+
+    std::vector<size_t> test_sizes = { 1000, 1501, 10000, 50000, 200000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 10;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+TEST(FormatTests, h265_parallel_scl)
+{
+    std::cout << "Starting h265 test with parallel start code lookup" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+    }
+
+    if (sender && receiver)
+    {
+        EXPECT_EQ(RTP_INVALID_VALUE, sender->configure_ctx(RCC_SCL_THREADS, -1));
+        EXPECT_EQ(RTP_OK, sender->configure_ctx(RCC_SCL_THREADS, 3));
+        EXPECT_EQ(3, sender->get_configuration_value(RCC_SCL_THREADS));
+
+        receiver->configure_ctx(RCC_UDP_RCV_BUF_SIZE, 40 * 1000 * 1000);
+        receiver->configure_ctx(RCC_RING_BUFFER_SIZE, 40 * 1000 * 1000);
+    }
+
+    // only frames of at least 1 MB are split between the threads
+    std::vector<size_t> test_sizes = { 50000, 1500000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 3;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+static std::atomic<int> zerocopy_deallocs(0);
+
+static void zerocopy_dealloc_hook(void* mem)
+{
+    delete[] (uint8_t*)mem;
+    ++zerocopy_deallocs;
+}
+
+TEST(FormatTests, h265_fragmentation_zerocopy)
+{
+    if (!socket_supports(&uvgrtp::socket::enable_zerocopy))
+    {
+        GTEST_SKIP() << "Zero-copy sending is not supported";
+    }
+
+    std::cout << "Starting h265 fragmentation test with zero-copy sending" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_UDP_ZEROCOPY);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+    }
+
+    std::vector<size_t> test_sizes = { 1000, 1501, 10000, 50000, 200000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 10;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+TEST(FormatTests, h265_zerocopy_dealloc_hook)
+{
+    if (!socket_supports(&uvgrtp::socket::enable_zerocopy))
+    {
+        GTEST_SKIP() << "Zero-copy sending is not supported";
+    }
+
+    std::cout << "Starting h265 zero-copy deallocation hook test" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    aggr_received = 0;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_UDP_ZEROCOPY);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver->install_receive_hook(nullptr, aggr_receive_hook);
+    }
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+
+    // raw frames are owned by uvgRTP and released through the deallocation hook
+    zerocopy_deallocs = 0;
+    int raw_frames = 10;
+
+    if (sender)
+    {
+        EXPECT_EQ(RTP_OK, sender->install_deallocation_hook(zerocopy_dealloc_hook));
+
+        for (int i = 0; i < raw_frames; ++i)
+        {
+            std::unique_ptr<uint8_t[]> frame = create_test_packet(format, nal_type, true, 50000, rtp_flags);
+            EXPECT_EQ(RTP_OK, sender->push_frame(frame.release(), 50000, rtp_flags));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    cleanup_ms(sess, sender);
+    EXPECT_EQ(raw_frames, zerocopy_deallocs.load());
+    EXPECT_EQ(raw_frames, aggr_received);
+
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+TEST(FormatTests, h265_incremental_reconstruction)
+{
+    std::cout << "Starting h265 test with incremental NAL unit reconstruction" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+    }
+
+    if (sender && receiver)
+    {
+        EXPECT_EQ(RTP_INVALID_VALUE, receiver->configure_ctx(RCC_H26X_INCREMENTAL_RECONSTRUCTION, 2));
+        EXPECT_EQ(RTP_OK, receiver->configure_ctx(RCC_H26X_INCREMENTAL_RECONSTRUCTION, 1));
+        EXPECT_EQ(1, receiver->get_configuration_value(RCC_H26X_INCREMENTAL_RECONSTRUCTION));
+
+        receiver->configure_ctx(RCC_UDP_RCV_BUF_SIZE, 40 * 1000 * 1000);
+        receiver->configure_ctx(RCC_RING_BUFFER_SIZE, 40 * 1000 * 1000);
+    }
+
+    // the reconstructed NAL unit has to grow several times for the largest frames
+    std::vector<size_t> test_sizes = { 1501, 50000, 1500000 };
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int test_runs = 3;
+
+    for (auto& size : test_sizes)
+    {
+        std::unique_ptr<uint8_t[]> intra_frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+        test_packet_size(std::move(intra_frame), test_runs, size, sess, sender, receiver, rtp_flags, RTP_FORMAT_H265);
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
+struct nal_list_receiver
+{
+    std::mutex lock;
+    std::vector<std::vector<uint8_t>> nals;
+};
+
+static void nal_list_receive_hook(void* arg, uvgrtp::frame::rtp_frame* frame)
+{
+    nal_list_receiver* receiver = (nal_list_receiver*)arg;
+    {
+        std::lock_guard<std::mutex> guard(receiver->lock);
+        receiver->nals.emplace_back(frame->payload, frame->payload + frame->payload_len);
+    }
+    (void)uvgrtp::frame::dealloc_frame(frame);
+}
+
+TEST(FormatTests, h265_nal_unit_list)
+{
+    // Send NAL units from separate buffers without start code lookup
+    std::cout << "Starting h265 NAL unit list test" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+    nal_list_receiver results;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_H26X_PREPEND_SC);
+    }
+
+    // parameter sets small enough to be aggregated and a slice that must be fragmented
+    std::vector<std::vector<uint8_t>> buffers = {
+        std::vector<uint8_t>(20), std::vector<uint8_t>(30), std::vector<uint8_t>(10), std::vector<uint8_t>(20000)
+    };
+    const uint8_t nal_types[] = { 32, 33, 34, 19 };
+
+    std::vector<uvgrtp::frame::nal_unit> nals;
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        for (size_t j = 0; j < buffers[i].size(); ++j)
+        {
+            buffers[i][j] = (uint8_t)(i + j * 7);
+        }
+        // none of the NAL units contain start codes, which uvgRTP must not look for anyway
+        buffers[i][0] = nal_types[i] << 1;
+        buffers[i][1] = 1;
+
+        uvgrtp::frame::nal_unit nal;
+        nal.data = buffers[i].data();
+        nal.len = buffers[i].size();
+        nals.push_back(nal);
+    }
+
+    if (sender && receiver)
+    {
+        EXPECT_EQ(RTP_OK, receiver->install_receive_hook(&results, nal_list_receive_hook));
+
+        EXPECT_EQ(RTP_INVALID_VALUE, sender->push_frame(nals.data(), 0, RTP_NO_FLAGS));
+        EXPECT_EQ(RTP_INVALID_VALUE, sender->push_frame(nals.data(), nals.size(), RTP_COPY));
+
+        EXPECT_EQ(RTP_OK, sender->push_frame(nals.data(), nals.size(), RTP_NO_FLAGS));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_EQ(RTP_OK, sender->push_frame(nals.data(), nals.size(), 90000, RTP_H26X_DO_NOT_AGGR));
+
+        for (int i = 0; i < 100; ++i)
+        {
+            {
+                std::lock_guard<std::mutex> guard(results.lock);
+                if (results.nals.size() >= 2 * buffers.size())
+                    break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        std::lock_guard<std::mutex> guard(results.lock);
+        ASSERT_EQ(2 * buffers.size(), results.nals.size());
+        for (size_t i = 0; i < results.nals.size(); ++i)
+        {
+            EXPECT_EQ(buffers[i % buffers.size()], results.nals[i]) << "NAL unit " << i;
+        }
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
 TEST(FormatTests, h265_fps)
 {
     std::cout << "Starting h265 test" << std::endl;
@@ -359,6 +841,110 @@ TEST(FormatTests, h265_small_fragment_pacing_fps)
     cleanup_sess(ctx, sess);
 }
 
+static std::mutex txtime_mutex;
+static std::vector<std::chrono::steady_clock::time_point> txtime_receive_times;
+
+static void txtime_receive_hook(void* arg, uvgrtp::frame::rtp_frame* frame)
+{
+    (void)arg;
+    {
+        std::lock_guard<std::mutex> lg(txtime_mutex);
+        txtime_receive_times.push_back(std::chrono::steady_clock::now());
+    }
+    (void)uvgrtp::frame::dealloc_frame(frame);
+}
+
+TEST(FormatTests, h265_txtime_pacing)
+{
+    {
+        // the stream falls back to sleeping when launch times would be ignored, which this test cannot tell apart
+        uvgrtp::socket socket(RCE_NO_FLAGS);
+        sockaddr_in addr = uvgrtp::socket::create_sockaddr(AF_INET, LOCAL_ADDRESS, RECEIVE_PORT);
+        sockaddr_in6 addr6 = {};
+
+        if (socket.init(AF_INET, SOCK_DGRAM, 0) != RTP_OK || socket.enable_txtime(addr, addr6) != RTP_OK)
+        {
+            GTEST_SKIP() << "SO_TXTIME pacing is not supported on the loopback interface";
+        }
+    }
+
+    std::cout << "Starting h265 SO_TXTIME pacing test" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    int framerate = 10;
+    std::chrono::milliseconds frame_interval(1000 / framerate);
+    txtime_receive_times.clear();
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265,
+            RCE_FRAME_RATE | RCE_PACE_FRAGMENT_SENDING | RCE_PACE_TXTIME);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+
+        if (sender && receiver)
+        {
+            sender->configure_ctx(RCC_FPS_NUMERATOR, framerate);
+            sender->configure_ctx(RCC_FPS_DENOMINATOR, 1);
+
+            receiver->install_receive_hook(nullptr, txtime_receive_hook);
+        }
+    }
+
+    int rtp_flags = RTP_NO_FLAGS;
+    int nal_type = 5;
+    rtp_format_t format = RTP_FORMAT_H265;
+    int warmup_frames = 2;
+    int frames = 4;
+    size_t size = 20000;
+
+    if (sender)
+    {
+        // frames pushed on time settle the synchronization point, before that nothing is paced
+        for (int i = 0; i < warmup_frames; ++i)
+        {
+            std::unique_ptr<uint8_t[]> frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+            EXPECT_EQ(RTP_OK, sender->push_frame(std::move(frame), size, rtp_flags));
+            std::this_thread::sleep_for(frame_interval * 7 / 10);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < frames; ++i)
+        {
+            std::unique_ptr<uint8_t[]> frame = create_test_packet(format, nal_type, true, size, rtp_flags);
+            EXPECT_EQ(RTP_OK, sender->push_frame(std::move(frame), size, rtp_flags));
+        }
+
+        // sleeping would take most of a frame interval per frame, the kernel takes them all at once
+        auto push_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        EXPECT_LT(push_time, frame_interval / 2);
+    }
+
+    std::this_thread::sleep_for(frame_interval * (frames + 2));
+
+    {
+        std::lock_guard<std::mutex> lg(txtime_mutex);
+        EXPECT_EQ((size_t)(warmup_frames + frames), txtime_receive_times.size());
+
+        // the frames pushed at once still arrive one frame interval apart
+        for (size_t i = warmup_frames + 1; i < txtime_receive_times.size(); ++i)
+        {
+            auto spacing = std::chrono::duration_cast<std::chrono::milliseconds>(
+                txtime_receive_times[i] - txtime_receive_times[i - 1]);
+            EXPECT_GT(spacing, frame_interval / 2);
+        }
+    }
+
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
 TEST(FormatTests, h266_single_nal_unit)
 {
     std::cout << "Starting H266 Single NAL unit test" << std::endl;
@@ -745,6 +1331,62 @@ TEST(FormatTests, h265_aggregation)
     cleanup_sess(ctx, sess);
 }
 
+TEST(FormatTests, h265_single_flush)
+{
+    std::cout << "Starting h265 single flush test" << std::endl;
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session(LOCAL_ADDRESS);
+
+    uvgrtp::media_stream* sender = nullptr;
+    uvgrtp::media_stream* receiver = nullptr;
+
+    aggr_received = 0;
+    int expected = 6;
+
+    if (sess)
+    {
+        sender = sess->create_stream(SEND_PORT, RECEIVE_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver = sess->create_stream(RECEIVE_PORT, SEND_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+        receiver->install_receive_hook(nullptr, aggr_receive_hook);
+    }
+
+    if (sender)
+    {
+        EXPECT_EQ(RTP_INVALID_VALUE, sender->configure_ctx(RCC_H26X_SINGLE_FLUSH, 2));
+        EXPECT_EQ(RTP_OK, sender->configure_ctx(RCC_H26X_SINGLE_FLUSH, 1));
+        EXPECT_EQ(1, sender->get_configuration_value(RCC_H26X_SINGLE_FLUSH));
+    }
+
+    int rtp_flags = RTP_NO_FLAGS;
+    rtp_format_t format = RTP_FORMAT_H265;
+
+    // aggregated, fragmented and single NAL units in the same access unit
+    std::vector<size_t> test_sizes = { 100, 200, 5000, 300, 7000, 400 };
+
+    size_t total_size = 0;
+    std::unique_ptr<uint8_t[]> test_frame = std::unique_ptr<uint8_t[]>(new uint8_t[13000]);
+
+    for (auto& size : test_sizes)
+    {
+        int nal_type = 8;
+        std::unique_ptr<uint8_t[]> nal_unit = create_test_packet(format, nal_type, true, size, rtp_flags);
+        memcpy(test_frame.get() + total_size, nal_unit.get(), size);
+        total_size += size;
+    }
+
+    if (sender)
+    {
+        EXPECT_EQ(RTP_OK, sender->push_frame(std::move(test_frame), total_size, RTP_NO_FLAGS));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::cout << "H265: Received/expected: " << aggr_received << "/" << expected << std::endl;
+    EXPECT_EQ(expected, aggr_received);
+    cleanup_ms(sess, sender);
+    cleanup_ms(sess, receiver);
+    cleanup_sess(ctx, sess);
+}
+
 TEST(FormatTests, h266_aggregation)
 {
     std::cout << "Starting h266 Aggregation packet test" << std::endl;
@@ -1,13 +1,26 @@
 // Tests H26x Start Code Lookup code with different offsets
 
 #include <iostream>
+#include <chrono>
 #include <cstdint>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "test_common.hh"
 
 #include "../src/formats/h264.hh"
+#include "../src/formats/h265.hh"
 #include "../src/formats/h266.hh"
+#include "../src/formats/start_code.hh"
+#include "../src/rtp.hh"
 
 const int DATA_SIZE = 128;
 const int DATA_VALUE = 128;
@@ -110,4 +123,401 @@ TEST(FormatTests, h266_scl) {
         EXPECT_EQ(4 + offset, (int)out);
         EXPECT_EQ(4, start_len);
     }
-}
\ No newline at end of file
+}
+
+static const uvgrtp::formats::SCL_SCANNER SCANNERS[] = {
+    uvgrtp::formats::SCL_SCANNER::SCALAR,
+    uvgrtp::formats::SCL_SCANNER::SSE2,
+    uvgrtp::formats::SCL_SCANNER::AVX2,
+    uvgrtp::formats::SCL_SCANNER::AVX512
+};
+
+static const char* scanner_name(uvgrtp::formats::SCL_SCANNER scanner)
+{
+    switch (scanner) {
+        case uvgrtp::formats::SCL_SCANNER::SSE2:   return "SSE2";
+        case uvgrtp::formats::SCL_SCANNER::AVX2:   return "AVX2";
+        case uvgrtp::formats::SCL_SCANNER::AVX512: return "AVX-512";
+        default:                                   return "scalar";
+    }
+}
+
+// byte by byte version of the start code lookup that the scanners are compared against
+static ssize_t reference_scl(const uint8_t* data, size_t len, size_t offset, uint8_t& start_len)
+{
+    for (size_t i = offset; i + 3 < len; ++i) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            start_len = (i > offset && data[i - 1] == 0) ? 4 : 3;
+            return i + 3;
+        }
+    }
+    return -1;
+}
+
+// go through all start codes of "data" from every offset like scl() does
+static void compare_scanners(const uint8_t* data, size_t len, int& mismatches)
+{
+    for (auto scanner : SCANNERS) {
+        if (!uvgrtp::formats::start_code::supported(scanner)) {
+            continue;
+        }
+
+        for (size_t offset = 0; offset <= len; ++offset) {
+            uint8_t expected_len = 0;
+            uint8_t start_len = 0;
+            ssize_t expected = reference_scl(data, len, offset, expected_len);
+            ssize_t out = uvgrtp::formats::start_code::find(scanner, data, len, offset, start_len);
+
+            if (out != expected || (out >= 0 && start_len != expected_len)) {
+                if (++mismatches <= 10) {
+                    ADD_FAILURE() << scanner_name(scanner) << ": length " << len << ", offset " << offset
+                        << ", expected " << expected << " got " << out;
+                }
+            }
+        }
+    }
+}
+
+TEST(FormatTests, scl_scanners_exhaustive) {
+    // Compare every scanner against the reference with all short buffers of the bytes 0, 1 and 2
+    // and with random buffers that are long enough for the vector paths
+    std::cout << "Start code lookup uses the " << scanner_name(uvgrtp::formats::start_code::selected())
+        << " scanner" << std::endl;
+
+    int mismatches = 0;
+
+    constexpr size_t MAX_SHORT_LEN = 9;
+    uint8_t short_data[MAX_SHORT_LEN] = {};
+
+    for (size_t len = 1; len <= MAX_SHORT_LEN; ++len) {
+        size_t combinations = 1;
+        for (size_t i = 0; i < len; ++i) {
+            combinations *= 3;
+        }
+
+        for (size_t c = 0; c < combinations; ++c) {
+            size_t value = c;
+            for (size_t i = 0; i < len; ++i) {
+                short_data[i] = (uint8_t)(value % 3);
+                value /= 3;
+            }
+            compare_scanners(short_data, len, mismatches);
+        }
+    }
+
+    // a start code at every position of a buffer, so that it crosses all block boundaries
+    for (size_t len = 4; len <= 200; len += 13) {
+        for (size_t pos = 0; pos + 3 <= len; ++pos) {
+            std::vector<uint8_t> data(len, DATA_VALUE);
+            data[pos] = 0;
+            data[pos + 1] = 0;
+            data[pos + 2] = 1;
+            compare_scanners(data.data(), len, mismatches);
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (int i = 0; i < 300; ++i) {
+        size_t len = 1 + rng() % 300;
+        std::vector<uint8_t> data(len);
+
+        // mostly zeros and ones so that there are plenty of start codes and near misses
+        for (auto& b : data) {
+            int r = byte(rng);
+            b = (r < 96) ? 0 : (r < 128) ? 1 : (uint8_t)byte(rng);
+        }
+        compare_scanners(data.data(), len, mismatches);
+    }
+
+    EXPECT_EQ(0, mismatches);
+}
+
+#ifdef __linux__
+TEST(FormatTests, scl_read_only_buffer) {
+    // The lookup must work on memory that cannot be written, e.g. a memory mapped file
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint8_t* data = (uint8_t*)mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, (void*)data);
+
+    memset(data, DATA_VALUE, page);
+    data[page - 9] = 0;
+    data[page - 8] = 0;
+    data[page - 7] = 0;
+    data[page - 6] = 1;
+    ASSERT_EQ(0, mprotect(data, page, PROT_READ));
+
+    std::shared_ptr<uvgrtp::rtp> rtp_;
+    auto socket_ = std::shared_ptr<uvgrtp::socket>(new uvgrtp::socket(0));
+    auto format_26x = uvgrtp::formats::h264(socket_, rtp_, 0);
+
+    uint8_t start_len = 0;
+    EXPECT_EQ((ssize_t)(page - 5), format_26x.find_h26x_start_code(data, page, 0, start_len));
+    EXPECT_EQ(4, start_len);
+
+    for (auto scanner : SCANNERS) {
+        if (uvgrtp::formats::start_code::supported(scanner)) {
+            start_len = 0;
+            EXPECT_EQ((ssize_t)(page - 5), uvgrtp::formats::start_code::find(scanner, data, page, 0, start_len));
+            EXPECT_EQ(4, start_len);
+            EXPECT_EQ(-1, uvgrtp::formats::start_code::find(scanner, data, page, page - 5, start_len));
+        }
+    }
+
+    munmap(data, page);
+}
+#endif
+
+TEST(FormatTests, scl_parallel) {
+    // Split frames between worker threads and compare the start codes with the serial lookup
+    constexpr size_t FRAME_SIZE = 4 * 1024 * 1024;
+    constexpr size_t BOUNDARY = 64 * 1024;
+
+    std::mt19937 rng(5678);
+    std::vector<uint8_t> data(FRAME_SIZE);
+
+    for (auto& b : data) {
+        int r = rng() % 256;
+        b = (r < 8) ? 0 : (r < 10) ? 1 : (uint8_t)r;
+    }
+
+    // start codes of both lengths crossing the likely chunk boundaries at every alignment
+    for (size_t pos = BOUNDARY; pos + BOUNDARY < FRAME_SIZE; pos += BOUNDARY) {
+        size_t start = pos - 1 - (pos / BOUNDARY) % 4;
+        data[start] = 0;
+        data[start + 1] = 0;
+        data[start + 2] = ((pos / BOUNDARY) % 8 < 4) ? 1 : 0;
+        data[start + 3] = 1;
+    }
+
+    std::vector<uvgrtp::formats::start_code::location> expected;
+    uint8_t start_len = 0;
+    ssize_t offset = uvgrtp::formats::start_code::find(data.data(), FRAME_SIZE, 0, start_len);
+    while (offset > -1) {
+        expected.push_back({ (size_t)offset, start_len });
+        offset = uvgrtp::formats::start_code::find(data.data(), FRAME_SIZE, offset, start_len);
+    }
+    ASSERT_LT(50u, expected.size());
+
+    for (size_t threads : { 1, 3, 7 }) {
+        uvgrtp::formats::start_code::workers workers(threads);
+        EXPECT_EQ(threads, workers.threads());
+
+        for (size_t len : { FRAME_SIZE, FRAME_SIZE - 3, (size_t)1024 * 1024 + 5, (size_t)1000 }) {
+            std::vector<uvgrtp::formats::start_code::location> found;
+            workers.find_all(data.data(), len, found);
+
+            size_t count = 0;
+            while (count < expected.size() && expected[count].offset < len) {
+                ++count;
+            }
+
+            ASSERT_EQ(count, found.size()) << threads << " threads, length " << len;
+            for (size_t i = 0; i < count; ++i) {
+                EXPECT_EQ(expected[i].offset, found[i].offset);
+                EXPECT_EQ(expected[i].start_len, found[i].start_len);
+            }
+        }
+    }
+}
+
+// all start codes of "data" from offset 0 as pairs of offset and length
+static std::vector<std::pair<ssize_t, int>> find_all_start_codes(uvgrtp::formats::SCL_SCANNER scanner,
+    const std::vector<uint8_t>& data)
+{
+    std::vector<std::pair<ssize_t, int>> found;
+    uint8_t start_len = 0;
+    ssize_t offset = uvgrtp::formats::start_code::find(scanner, data.data(), data.size(), 0, start_len);
+
+    while (offset > -1) {
+        found.push_back({ offset, start_len });
+        offset = uvgrtp::formats::start_code::find(scanner, data.data(), data.size(), offset, start_len);
+    }
+    return found;
+}
+
+TEST(FormatTests, scl_scanners_match_scalar) {
+    // Compare the start codes the vector scanners find in a large frame with the scalar scanner.
+    // The start codes cross the blocks of the vector scanners and the 64 KiB boundaries
+    constexpr size_t FRAME_SIZE = 1024 * 1024 + 100;
+    constexpr size_t BLOCK_AREA = 4096;
+    constexpr size_t BOUNDARY = 64 * 1024;
+
+    std::vector<uint8_t> data(FRAME_SIZE);
+    std::mt19937 rng(4321);
+    for (auto& b : data) {
+        b = (uint8_t)rng();
+    }
+
+    // remove the start codes that happen by chance
+    for (size_t i = 2; i < FRAME_SIZE; ++i) {
+        if (data[i] == 1 && data[i - 1] == 0 && data[i - 2] == 0) {
+            data[i] = 2;
+        }
+    }
+
+    std::vector<size_t> boundaries;
+    for (size_t pos = 64; pos < BLOCK_AREA; pos += 64) {
+        boundaries.push_back(pos);
+    }
+    for (size_t pos = BOUNDARY; pos < FRAME_SIZE; pos += BOUNDARY) {
+        boundaries.push_back(pos);
+    }
+
+    // start codes of both lengths beginning 1 to 4 bytes before each boundary
+    for (size_t i = 0; i < boundaries.size(); ++i) {
+        size_t start = boundaries[i] - 1 - i % 4;
+        data[start] = 0;
+        data[start + 1] = 0;
+        data[start + 2] = (i % 8 < 4) ? 1 : 0;
+        data[start + 3] = 1;
+    }
+
+    auto expected = find_all_start_codes(uvgrtp::formats::SCL_SCANNER::SCALAR, data);
+    ASSERT_LE(boundaries.size(), expected.size());
+
+    for (auto scanner : SCANNERS) {
+        if (scanner == uvgrtp::formats::SCL_SCANNER::SCALAR || !uvgrtp::formats::start_code::supported(scanner)) {
+            continue;
+        }
+        EXPECT_EQ(expected, find_all_start_codes(scanner, data)) << scanner_name(scanner);
+    }
+}
+
+TEST(FormatTests, DISABLED_scl_throughput) {
+    // Measure how fast each scanner goes through a large frame. Nothing is asserted about the speed,
+    // run with --gtest_also_run_disabled_tests --gtest_filter=*scl_throughput to see the results
+    constexpr size_t FRAME_SIZE = 16 * 1000 * 1000;
+    constexpr size_t NAL_UNITS = 64;
+    constexpr int ROUNDS = 4;
+
+    std::vector<uint8_t> data(FRAME_SIZE);
+    std::mt19937 rng(4321);
+    for (auto& b : data) {
+        b = (uint8_t)rng();
+    }
+
+    // remove the start codes that happen by chance and add the real ones
+    for (size_t i = 2; i < FRAME_SIZE; ++i) {
+        if (data[i] == 1 && data[i - 1] == 0 && data[i - 2] == 0) {
+            data[i] = 2;
+        }
+    }
+
+    for (size_t i = 0; i < NAL_UNITS; ++i) {
+        size_t pos = i * (FRAME_SIZE / NAL_UNITS);
+        data[pos] = 0;
+        data[pos + 1] = 0;
+        data[pos + 2] = 0;
+        data[pos + 3] = 1;
+    }
+
+    for (auto scanner : SCANNERS) {
+        if (!uvgrtp::formats::start_code::supported(scanner)) {
+            std::cout << scanner_name(scanner) << " is not supported" << std::endl;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int round = 0; round < ROUNDS; ++round) {
+            EXPECT_EQ(NAL_UNITS, find_all_start_codes(scanner, data).size());
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << scanner_name(scanner) << ": " << (double)FRAME_SIZE * ROUNDS / seconds / 1e9
+            << " GB/s" << std::endl;
+    }
+}
+
+// feed shuffled, duplicated and interleaved fragments of several NAL units to the receiver
+// so that the sequence numbers wrap around in the middle
+static void test_fragment_reassembly(bool incremental)
+{
+    const int NAL_UNITS = 4;
+    const int FRAGMENTS_PER_NAL = 6;
+    const size_t FRAGMENT_PAYLOAD = 100;
+    const uint16_t FIRST_SEQ = 65530;
+    const uint8_t NAL_TYPE = 19; // IDR_W_RADL
+
+    auto rtp_ = std::make_shared<uvgrtp::rtp>(RTP_FORMAT_H265, std::make_shared<std::atomic<std::uint32_t>>(1), false);
+    auto socket_ = std::shared_ptr<uvgrtp::socket>(new uvgrtp::socket(0));
+    auto format_265 = uvgrtp::formats::h265(socket_, rtp_, 0);
+    format_265.set_incremental_reconstruction(incremental);
+
+    struct fragment {
+        uint16_t seq;
+        uint32_t ts;
+        int nal;
+        int index;
+    };
+
+    std::vector<fragment> fragments;
+    for (int nal = 0; nal < NAL_UNITS; ++nal) {
+        for (int i = 0; i < FRAGMENTS_PER_NAL; ++i) {
+            // two NAL units in each access unit
+            fragments.push_back({uint16_t(FIRST_SEQ + nal * FRAGMENTS_PER_NAL + i), uint32_t(1000 + (nal / 2) * 3000), nal, i});
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::shuffle(fragments.begin(), fragments.end(), rng);
+    fragments.push_back(fragments[3]);
+    fragments.insert(fragments.begin() + 10, fragments[5]);
+
+    std::vector<std::vector<uint8_t>> received;
+
+    for (auto& f : fragments) {
+        uvgrtp::frame::rtp_frame *frame = uvgrtp::frame::alloc_rtp_frame(3 + FRAGMENT_PAYLOAD);
+        frame->header.seq = f.seq;
+        frame->header.timestamp = f.ts;
+
+        frame->payload[0] = 49 << 1; // FU
+        frame->payload[1] = 1;
+        frame->payload[2] = NAL_TYPE;
+        if (f.index == 0) {
+            frame->payload[2] |= 0x80;
+        }
+        else if (f.index == FRAGMENTS_PER_NAL - 1) {
+            frame->payload[2] |= 0x40;
+        }
+        memset(&frame->payload[3], f.nal * FRAGMENTS_PER_NAL + f.index, FRAGMENT_PAYLOAD);
+
+        uvgrtp::frame::rtp_frame *out = frame;
+        if (format_265.packet_handler(nullptr, 0, nullptr, 0, &out) == RTP_PKT_READY) {
+            ASSERT_NE(nullptr, out);
+            received.emplace_back(out->payload, out->payload + out->payload_len);
+            (void)uvgrtp::frame::dealloc_frame(out);
+        }
+    }
+
+    ASSERT_EQ(NAL_UNITS, (int)received.size());
+
+    std::vector<bool> seen(NAL_UNITS, false);
+    for (auto& nal : received) {
+        // start code, NAL header and the payloads of all fragments in order
+        ASSERT_EQ(4 + 2 + FRAGMENTS_PER_NAL * FRAGMENT_PAYLOAD, nal.size());
+        EXPECT_EQ(1, nal[3]);
+        EXPECT_EQ(NAL_TYPE, (nal[4] >> 1) & 0x3f);
+
+        int index = nal[6] / FRAGMENTS_PER_NAL;
+        ASSERT_LT(index, NAL_UNITS);
+        EXPECT_FALSE(seen[index]);
+        seen[index] = true;
+
+        for (int i = 0; i < FRAGMENTS_PER_NAL; ++i) {
+            for (size_t j = 0; j < FRAGMENT_PAYLOAD; ++j) {
+                ASSERT_EQ(index * FRAGMENTS_PER_NAL + i, nal[6 + i * FRAGMENT_PAYLOAD + j]);
+            }
+        }
+    }
+}
+
+TEST(FormatTests, h265_fragment_reassembly) {
+    test_fragment_reassembly(false);
+}
+
+TEST(FormatTests, h265_fragment_reassembly_incremental) {
+    test_fragment_reassembly(true);
+}
@@ -0,0 +1,242 @@
+// Tests memory reuse of frame queue transactions and of the socket send path
+
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+#include "test_common.hh"
+#include "allocation_counter.hh"
+
+#include "../src/frame_queue.hh"
+#include "../src/rtp.hh"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+// nothing listens on this port, the sent packets are simply dropped
+constexpr uint16_t SINK_PORT = 9702;
+
+constexpr size_t FQ_PAYLOAD_SIZE = 1000;
+
+// builds one transaction the way h26x fragmentation does and returns the number of allocations it made
+static size_t build_transaction(uvgrtp::frame_queue& fqueue, uint8_t* data, size_t packets, bool& ok)
+{
+    start_counting_allocations();
+
+    ok = fqueue.init_transaction(data) == RTP_OK;
+
+    uvgrtp::buf_vec* buffers = fqueue.get_buffer_vector();
+    buffers->push_back({ 2, data });
+    buffers->push_back({ FQ_PAYLOAD_SIZE, data + 2 });
+
+    for (size_t i = 0; i < packets; ++i) {
+        ok = ok && fqueue.enqueue_message(*buffers) == RTP_OK;
+    }
+
+    ok = ok && fqueue.deinit_transaction() == RTP_OK;
+
+    return stop_counting_allocations();
+}
+
+// same as build_transaction() but the transaction is sent through the socket of the frame queue
+static size_t flush_transaction(uvgrtp::frame_queue& fqueue, uint8_t* data, size_t packets,
+    sockaddr_in& addr, sockaddr_in6& addr6, bool& ok)
+{
+    start_counting_allocations();
+
+    ok = fqueue.init_transaction(data) == RTP_OK;
+
+    uvgrtp::buf_vec* buffers = fqueue.get_buffer_vector();
+    buffers->push_back({ 2, data });
+    buffers->push_back({ FQ_PAYLOAD_SIZE, data + 2 });
+
+    for (size_t i = 0; i < packets; ++i) {
+        ok = ok && fqueue.enqueue_message(*buffers) == RTP_OK;
+    }
+
+    ok = ok && fqueue.flush_queue(addr, addr6, 1234) == RTP_OK;
+
+    return stop_counting_allocations();
+}
+
+TEST(FrameQueueTests, transaction_reuse)
+{
+    std::cout << "Starting frame queue transaction reuse test" << std::endl;
+
+    auto ssrc   = std::make_shared<std::atomic<uint32_t>>(1234);
+    auto rtp    = std::make_shared<uvgrtp::rtp>(RTP_FORMAT_H265, ssrc, false);
+    auto socket = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+
+    uvgrtp::frame_queue fqueue(socket, rtp, RCE_NO_FLAGS);
+    std::unique_ptr<uint8_t[]> data = std::unique_ptr<uint8_t[]>(new uint8_t[FQ_PAYLOAD_SIZE + 2]);
+    memset(data.get(), 'a', FQ_PAYLOAD_SIZE + 2);
+
+    bool ok = false;
+
+    // the first transaction allocates the memory, spanning several storage blocks
+    EXPECT_LT(0u, build_transaction(fqueue, data.get(), 3 * PACKET_STORAGE_BLOCK_SIZE, ok));
+    EXPECT_TRUE(ok);
+
+    // transactions that fit in the existing memory don't touch the heap
+    std::vector<size_t> packet_counts = { 1, 10, 3 * PACKET_STORAGE_BLOCK_SIZE, 100, 2 };
+    for (auto& packets : packet_counts)
+    {
+        EXPECT_EQ(0u, build_transaction(fqueue, data.get(), packets, ok));
+        EXPECT_TRUE(ok);
+    }
+
+    // larger transactions grow the memory on demand
+    EXPECT_LT(0u, build_transaction(fqueue, data.get(), 5 * PACKET_STORAGE_BLOCK_SIZE, ok));
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(0u, build_transaction(fqueue, data.get(), 5 * PACKET_STORAGE_BLOCK_SIZE, ok));
+    EXPECT_TRUE(ok);
+}
+
+TEST(FrameQueueTests, flush_reuse)
+{
+    std::cout << "Starting frame queue flush reuse test" << std::endl;
+
+    auto ssrc   = std::make_shared<std::atomic<uint32_t>>(1234);
+    auto rtp    = std::make_shared<uvgrtp::rtp>(RTP_FORMAT_H265, ssrc, false);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(SINK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    std::unique_ptr<uint8_t[]> data = std::unique_ptr<uint8_t[]>(new uint8_t[FQ_PAYLOAD_SIZE + 2]);
+    memset(data.get(), 'a', FQ_PAYLOAD_SIZE + 2);
+
+    // both the normal and the GSO send path must reuse their message arrays
+    for (bool gso : { false, true })
+    {
+        auto socket = std::make_shared<uvgrtp::socket>(RCE_SYSTEM_CALL_CLUSTERING);
+        ASSERT_EQ(RTP_OK, socket->init(AF_INET, SOCK_DGRAM, 0));
+
+        if (gso && socket->enable_gso() != RTP_OK)
+        {
+            std::cout << "UDP GSO not available, skipping the GSO send path" << std::endl;
+            continue;
+        }
+
+        uvgrtp::frame_queue fqueue(socket, rtp, RCE_NO_FLAGS);
+        bool ok = false;
+
+        // the first flush allocates the transaction and the message arrays of the socket
+        EXPECT_LT(0u, flush_transaction(fqueue, data.get(), 100, addr, addr6, ok));
+        EXPECT_TRUE(ok);
+
+        std::vector<size_t> packet_counts = { 1, 10, 100, 50, 2 };
+        for (auto& packets : packet_counts)
+        {
+            EXPECT_EQ(0u, flush_transaction(fqueue, data.get(), packets, addr, addr6, ok));
+            EXPECT_TRUE(ok);
+        }
+    }
+}
+
+TEST(FrameQueueTests, DISABLED_flush_throughput)
+{
+    // Measure the cost of flushing transactions through sendmmsg() when the frame queue and the socket
+    // reuse their memory, compared to a new frame queue for every frame. Nothing is asserted about the
+    // speed, run with --gtest_also_run_disabled_tests --gtest_filter=*throughput to see the results
+    constexpr size_t PACKETS = 64;
+    constexpr int FRAMES = 5000;
+
+    auto ssrc   = std::make_shared<std::atomic<uint32_t>>(1234);
+    auto rtp    = std::make_shared<uvgrtp::rtp>(RTP_FORMAT_H265, ssrc, false);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(SINK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    std::unique_ptr<uint8_t[]> data = std::unique_ptr<uint8_t[]>(new uint8_t[FQ_PAYLOAD_SIZE + 2]);
+    memset(data.get(), 'a', FQ_PAYLOAD_SIZE + 2);
+
+    auto socket = std::make_shared<uvgrtp::socket>(RCE_SYSTEM_CALL_CLUSTERING);
+    ASSERT_EQ(RTP_OK, socket->init(AF_INET, SOCK_DGRAM, 0));
+
+    for (bool reuse : { true, false })
+    {
+        std::unique_ptr<uvgrtp::frame_queue> fqueue(new uvgrtp::frame_queue(socket, rtp, RCE_NO_FLAGS));
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < FRAMES; ++i)
+        {
+            if (!reuse)
+            {
+                fqueue.reset(new uvgrtp::frame_queue(socket, rtp, RCE_NO_FLAGS));
+            }
+
+            ASSERT_EQ(RTP_OK, fqueue->init_transaction(data.get()));
+
+            uvgrtp::buf_vec* buffers = fqueue->get_buffer_vector();
+            buffers->push_back({ 2, data.get() });
+            buffers->push_back({ FQ_PAYLOAD_SIZE, data.get() + 2 });
+
+            for (size_t j = 0; j < PACKETS; ++j)
+            {
+                ASSERT_EQ(RTP_OK, fqueue->enqueue_message(*buffers));
+            }
+            ASSERT_EQ(RTP_OK, fqueue->flush_queue(addr, addr6, 1234));
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (reuse ? "reused frame queue: " : "new frame queue per frame: ")
+            << seconds * 1e9 / ((double)FRAMES * PACKETS) << " ns per packet" << std::endl;
+    }
+}
+
+// pushes one frame through the stream and returns the number of allocations it made
+static size_t push_frame(uvgrtp::media_stream* stream, uint8_t* data, size_t size, bool& ok)
+{
+    start_counting_allocations();
+
+    ok = stream->push_frame(data, size, RTP_NO_FLAGS) == RTP_OK;
+
+    return stop_counting_allocations();
+}
+
+TEST(FrameQueueTests, push_frame_reuse)
+{
+    std::cout << "Starting push_frame allocation test" << std::endl;
+
+    uvgrtp::context ctx;
+    uvgrtp::session* sess = ctx.create_session("127.0.0.1");
+    ASSERT_NE(nullptr, sess);
+
+    uvgrtp::media_stream* sender = sess->create_stream(SINK_PORT + 2, SINK_PORT, RTP_FORMAT_H265, RCE_NO_FLAGS);
+    ASSERT_NE(nullptr, sender);
+
+    // small NAL units that are aggregated and one that is fragmented
+    std::vector<size_t> nal_sizes = { 20, 30, 40, 5000 };
+    std::vector<uint8_t> frame;
+
+    for (auto& nal_size : nal_sizes)
+    {
+        frame.insert(frame.end(), { 0, 0, 0, 1, 1 << 1, 1 });
+        frame.insert(frame.end(), nal_size - 2, 'a');
+    }
+
+    bool ok = false;
+
+    // the first frames allocate the memory of the stream
+    for (int i = 0; i < 3; ++i)
+    {
+        (void)push_frame(sender, frame.data(), frame.size(), ok);
+        EXPECT_TRUE(ok);
+    }
+
+    for (int i = 0; i < 20; ++i)
+    {
+        EXPECT_EQ(0u, push_frame(sender, frame.data(), frame.size(), ok));
+        EXPECT_TRUE(ok);
+    }
+
+    sess->destroy_stream(sender);
+    ctx.destroy_session(sess);
+}
@@ -0,0 +1,287 @@
+// Tests the packet handler dispatch and the zero-copy memory retention of the socket.
+// The disabled benchmarks compare batched reception to reading one packet at a time and
+// io_uring sending to sendmmsg()
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test_common.hh"
+
+#include "../src/socket.hh"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+// nothing listens on this port, the sent packets are simply dropped
+constexpr uint16_t SINK_PORT = 9704;
+
+// the receive benchmark reads its own packets from this port
+constexpr uint16_t BENCHMARK_PORT = 9706;
+
+static rtp_error_t count_handler(void* arg, uvgrtp::buf_vec&)
+{
+    ++*(std::atomic<size_t>*)arg;
+    return RTP_OK;
+}
+
+TEST(SocketTests, handler_dispatch)
+{
+    std::cout << "Starting socket handler dispatch test" << std::endl;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(SINK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    auto socket = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+    ASSERT_EQ(RTP_OK, socket->init(AF_INET, SOCK_DGRAM, 0));
+
+    auto ssrc_a = std::make_shared<std::atomic<uint32_t>>(1000);
+    auto ssrc_b = std::make_shared<std::atomic<uint32_t>>(2000);
+    auto ssrc_c = std::make_shared<std::atomic<uint32_t>>(3000);
+
+    std::atomic<size_t> calls_a(0);
+    std::atomic<size_t> calls_b(0);
+    std::atomic<size_t> calls_c(0);
+
+    EXPECT_EQ(RTP_INVALID_VALUE, socket->install_handler(ssrc_a, &calls_a, nullptr));
+    ASSERT_EQ(RTP_OK, socket->install_handler(ssrc_a, &calls_a, count_handler));
+    ASSERT_EQ(RTP_OK, socket->install_handler(ssrc_b, &calls_b, count_handler));
+
+    uint8_t data[100] = {};
+    uvgrtp::buf_vec buffers = { { sizeof(data), data } };
+
+    // only the handler of the SSRC is called, packets of other SSRCs are sent as they are
+    EXPECT_EQ(RTP_OK, socket->sendto(1000, addr, addr6, buffers, 0));
+    EXPECT_EQ(RTP_OK, socket->sendto(4000, addr, addr6, buffers, 0));
+    EXPECT_EQ(1u, calls_a.load());
+    EXPECT_EQ(0u, calls_b.load());
+
+    // handlers follow the SSRC when it changes
+    *ssrc_a = 1001;
+    socket->update_handlers();
+    EXPECT_EQ(RTP_OK, socket->sendto(1000, addr, addr6, buffers, 0));
+    EXPECT_EQ(RTP_OK, socket->sendto(1001, addr, addr6, buffers, 0));
+    EXPECT_EQ(2u, calls_a.load());
+
+    // senders run while handlers of another SSRC come and go
+    constexpr size_t SENDERS = 4;
+    constexpr size_t PACKETS = 2000;
+
+    std::atomic<bool> sending(true);
+    std::thread installer([&]() {
+        while (sending) {
+            socket->install_handler(ssrc_c, &calls_c, count_handler);
+            socket->remove_handler(ssrc_c);
+        }
+    });
+
+    std::vector<std::thread> senders;
+    for (size_t i = 0; i < SENDERS; ++i) {
+        senders.emplace_back([&, i]() {
+            uint8_t packet[100] = {};
+            uvgrtp::buf_vec packet_buffers = { { sizeof(packet), packet } };
+            uint32_t ssrc = (i % 2) ? 2000 : 1001;
+
+            for (size_t j = 0; j < PACKETS; ++j) {
+                EXPECT_EQ(RTP_OK, socket->sendto(ssrc, addr, addr6, packet_buffers, 0));
+            }
+        });
+    }
+
+    for (auto& sender : senders) {
+        sender.join();
+    }
+    sending = false;
+    installer.join();
+
+    EXPECT_EQ(2u + SENDERS / 2 * PACKETS, calls_a.load());
+    EXPECT_EQ(SENDERS / 2 * PACKETS, calls_b.load());
+    EXPECT_EQ(0u, calls_c.load());
+
+    socket->remove_handler(ssrc_a);
+    EXPECT_EQ(RTP_OK, socket->sendto(1001, addr, addr6, buffers, 0));
+    EXPECT_EQ(2u + SENDERS / 2 * PACKETS, calls_a.load());
+}
+
+TEST(SocketTests, zerocopy_retention)
+{
+    auto socket = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+    ASSERT_EQ(RTP_OK, socket->init(AF_INET, SOCK_DGRAM, 0));
+
+    if (socket->enable_zerocopy() != RTP_OK)
+    {
+        GTEST_SKIP() << "Zero-copy sending is not supported";
+    }
+
+    std::cout << "Starting socket zero-copy retention test" << std::endl;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(SINK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    uint8_t payload[1000] = {};
+    uvgrtp::pkt_vec packets = { { { sizeof(payload), payload } } };
+    uint32_t zerocopy_id = 0;
+
+    ASSERT_EQ(RTP_OK, socket->sendto_zerocopy(1000, addr, addr6, packets, zerocopy_id));
+
+    // memory of a sent packet is released once the kernel reports the send complete
+    std::atomic<bool> sent_released(false);
+    socket->retain_zerocopy(zerocopy_id, [&]() { sent_released = true; });
+
+    for (int i = 0; i < 100 && !sent_released; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        (void)socket->get_zerocopy_completed();
+    }
+    EXPECT_TRUE(sent_released);
+
+    // memory of a send that the kernel has not completed is never released, not even when the socket is closed
+    std::atomic<bool> pending_released(false);
+    socket->retain_zerocopy(zerocopy_id + 1000, [&]() { pending_released = true; });
+
+    (void)socket->get_zerocopy_completed();
+    EXPECT_FALSE(pending_released);
+
+    socket = nullptr;
+    EXPECT_FALSE(pending_released);
+}
+
+#ifdef __linux__
+TEST(SocketTests, DISABLED_recvmmsg_throughput)
+{
+    // Compare reading packets one at a time with recvfrom() to reading them in batches with recvmmsg().
+    // Nothing is asserted about the speed, run with --gtest_also_run_disabled_tests --gtest_filter=*throughput
+    constexpr size_t PACKET_SIZE = 1200;
+    constexpr size_t BURST = 64;
+    constexpr size_t BATCH = 32;
+    constexpr int ROUNDS = 5000;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(BENCHMARK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    auto receiver = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+    ASSERT_EQ(RTP_OK, receiver->init(AF_INET, SOCK_DGRAM, 0));
+    ASSERT_EQ(RTP_OK, receiver->bind(addr));
+
+    int buf_size = 4 * 1024 * 1024;
+    (void)receiver->setsockopt(SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+
+    auto sender = std::make_shared<uvgrtp::socket>(RCE_SYSTEM_CALL_CLUSTERING);
+    ASSERT_EQ(RTP_OK, sender->init(AF_INET, SOCK_DGRAM, 0));
+
+    std::vector<uint8_t> payload(PACKET_SIZE, 0xab);
+    uvgrtp::pkt_vec burst(BURST, { { PACKET_SIZE, payload.data() } });
+
+    std::vector<uint8_t> memory(BATCH * PACKET_SIZE);
+    std::vector<uint8_t*> bufs(BATCH);
+    std::vector<int> lens(BATCH);
+    for (size_t i = 0; i < BATCH; ++i) {
+        bufs[i] = memory.data() + i * PACKET_SIZE;
+    }
+
+    for (bool batched : { false, true }) {
+        size_t packets = 0;
+        size_t calls = 0;
+        std::clock_t cpu = 0;
+
+        for (int round = 0; round < ROUNDS; ++round) {
+            // loopback delivers the burst to the receive buffer before sendto() returns,
+            // so only reading it is measured
+            ASSERT_EQ(RTP_OK, sender->sendto(0, addr, addr6, burst, 0));
+
+            std::clock_t start = std::clock();
+
+            for (;;) {
+                ++calls;
+
+                if (batched) {
+                    int msgs_read = 0;
+                    if (receiver->recvmmsg(bufs.data(), PACKET_SIZE, lens.data(), BATCH, MSG_DONTWAIT, &msgs_read) != RTP_OK ||
+                        msgs_read <= 0) {
+                        break;
+                    }
+                    packets += (size_t)msgs_read;
+                }
+                else {
+                    if (receiver->recvfrom(bufs[0], PACKET_SIZE, MSG_DONTWAIT) != RTP_OK) {
+                        break;
+                    }
+                    ++packets;
+                }
+            }
+            cpu += std::clock() - start;
+        }
+
+        // the last call of each round finds the socket empty
+        double seconds = (double)cpu / CLOCKS_PER_SEC;
+        std::cout << (batched ? "recvmmsg: " : "recvfrom: ") << packets << " packets, "
+            << (double)calls / packets << " system calls per packet, "
+            << seconds * 1e9 / packets << " ns of CPU per packet, "
+            << (double)packets * PACKET_SIZE * 8 / seconds / 1e9 << " Gbps per core" << std::endl;
+    }
+}
+
+TEST(SocketTests, DISABLED_io_uring_throughput)
+{
+    // Compare sending batches of packets with sendmmsg() to sending them as io_uring sendmsg requests.
+    // Nothing is asserted about the speed, run with --gtest_also_run_disabled_tests --gtest_filter=*throughput
+    constexpr size_t PACKET_SIZE = 1200;
+    constexpr size_t BURST = 64;
+    constexpr int ROUNDS = 5000;
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(BENCHMARK_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    sockaddr_in6 addr6 = {};
+
+    // nothing reads the packets, the socket only keeps loopback from answering with ICMP
+    auto sink = std::make_shared<uvgrtp::socket>(RCE_NO_FLAGS);
+    ASSERT_EQ(RTP_OK, sink->init(AF_INET, SOCK_DGRAM, 0));
+    ASSERT_EQ(RTP_OK, sink->bind(addr));
+
+    std::vector<uint8_t> payload(PACKET_SIZE, 0xab);
+    uvgrtp::pkt_vec burst(BURST, { { PACKET_SIZE, payload.data() } });
+
+    for (bool io_uring : { false, true }) {
+        auto sender = std::make_shared<uvgrtp::socket>(RCE_SYSTEM_CALL_CLUSTERING);
+        ASSERT_EQ(RTP_OK, sender->init(AF_INET, SOCK_DGRAM, 0));
+
+        if (io_uring && sender->enable_io_uring() != RTP_OK) {
+            std::cout << "io_uring is not supported" << std::endl;
+            continue;
+        }
+
+        // the first send creates the io_uring instance of this thread
+        ASSERT_EQ(RTP_OK, sender->sendto(0, addr, addr6, burst, 0));
+
+        auto start = std::chrono::steady_clock::now();
+        std::clock_t cpu_start = std::clock();
+
+        for (int round = 0; round < ROUNDS; ++round) {
+            ASSERT_EQ(RTP_OK, sender->sendto(0, addr, addr6, burst, 0));
+        }
+
+        // the CPU time includes the kernel workers of io_uring, they belong to this process
+        double cpu = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double packets = (double)ROUNDS * BURST;
+
+        std::cout << (io_uring ? "io_uring: " : "sendmmsg: ") << packets / seconds / 1e6 << " million packets per second, "
+            << cpu * 1e9 / packets << " ns of CPU per packet" << std::endl;
+    }
+}
+#endif
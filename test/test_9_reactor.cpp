@@ -0,0 +1,152 @@
+// Tests removing the sockets and timers of the reactor from its callbacks
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "test_common.hh"
+
+#include "../src/reactor.hh"
+
+#ifdef __linux__
+TEST(ReactorTests, remove_timer_of_other_thread)
+{
+    std::cout << "Starting reactor cross-thread removal test" << std::endl;
+
+    uvgrtp::reactor reactor(2);
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    int running = 0;
+    int removed = 0;
+    uint64_t timers[2] = {};
+
+    // the timers go to the two threads in turns. Both callbacks remove the timer of the other
+    // thread while it is running, which must not make the threads wait for each other
+    auto callback = [&](int self) {
+        std::unique_lock<std::mutex> lk(mutex);
+        ++running;
+        cond.notify_all();
+        cond.wait_for(lk, std::chrono::seconds(5), [&] { return running == 2 && timers[1] != 0; });
+        uint64_t other = timers[1 - self];
+        lk.unlock();
+
+        reactor.remove_timer(other);
+
+        lk.lock();
+        ++removed;
+        cond.notify_all();
+        return 10;
+    };
+
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+        timers[0] = reactor.add_timer(0, [&]() { return callback(0); });
+        timers[1] = reactor.add_timer(0, [&]() { return callback(1); });
+    }
+    ASSERT_NE(0u, timers[0]);
+    ASSERT_NE(0u, timers[1]);
+
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(cond.wait_for(lk, std::chrono::seconds(5), [&] { return removed >= 2; }));
+    lk.unlock();
+
+    // a timer may run once more if it was due before the other callback removed it, but not after that
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    lk.lock();
+    int calls = running;
+    lk.unlock();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    lk.lock();
+    EXPECT_EQ(calls, running);
+    EXPECT_EQ(calls, removed);
+}
+
+TEST(ReactorTests, destroy_owner_after_removal_from_other_thread)
+{
+    std::cout << "Starting reactor owner lifetime test" << std::endl;
+
+    struct target {
+        std::atomic<bool> running{false};
+        std::atomic<bool> *destroyed_while_running;
+        std::atomic<bool> *destroyed;
+        int calls = 0;
+
+        ~target()
+        {
+            *destroyed_while_running = running.load();
+            *destroyed = true;
+        }
+    };
+
+    std::atomic<bool> destroyed_while_running(false);
+    std::atomic<bool> destroyed(false);
+
+    std::shared_ptr<target> owner = std::make_shared<target>();
+    owner->destroyed_while_running = &destroyed_while_running;
+    owner->destroyed = &destroyed;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool target_running = false;
+    bool released = false;
+    uint64_t target_timer = 0;
+
+    uvgrtp::reactor reactor(2);
+
+    // the timers go to the two threads in turns. The first one removes the timer of the other
+    // thread while its callback runs and releases the object that the callback uses, the way
+    // a receive hook destroying a stream served by another thread would
+    target *t = owner.get();
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+
+        (void)reactor.add_timer(0, [&]() {
+            std::unique_lock<std::mutex> lk(mutex);
+            if (!cond.wait_for(lk, std::chrono::seconds(5), [&] { return target_running; }) || released)
+                return -1;
+            lk.unlock();
+
+            reactor.remove_timer(target_timer);
+            owner.reset();
+
+            lk.lock();
+            released = true;
+            cond.notify_all();
+            return -1;
+        });
+
+        target_timer = reactor.add_timer(0, [&, t]() {
+            t->running = true;
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                target_running = true;
+                cond.notify_all();
+                cond.wait_for(lk, std::chrono::seconds(5), [&] { return released; });
+            }
+
+            // the object must still be alive although it was released during the call
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            ++t->calls;
+            t->running = false;
+            return 10;
+        }, owner);
+    }
+    ASSERT_NE(0u, target_timer);
+
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(cond.wait_for(lk, std::chrono::seconds(5), [&] { return released; }));
+    lk.unlock();
+
+    for (int i = 0; i < 100 && !destroyed; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    EXPECT_TRUE(destroyed);
+    EXPECT_FALSE(destroyed_while_running);
+}
+#endif